@@ -0,0 +1,249 @@
+/**
+ *  @file   larpandora/LArPandoraAnalysis/PFParticleComparison_module.cc
+ *
+ *  @brief  Analysis module comparing the particles written by two pandora producers, run on the same hits, by their shared hits
+ *
+ */
+
+#include "art/Framework/Core/ModuleMacros.h"
+#include "art/Framework/Core/EDAnalyzer.h"
+
+#include "larpandora/LArPandoraInterface/LArPandoraHelper.h"
+
+#include "TTree.h"
+
+#include <string>
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+namespace lar_pandora
+{
+
+/**
+ *  @brief  PFParticleComparison class
+ *
+ *  Intended to validate an alternative reconstruction path, e.g. per-drift-volume daughter instances, against the standard path: both
+ *  producers are run in the same job on the same hit collection. Each final-state particle of the reference producer (daughters absorbed)
+ *  is matched to the final-state test particle with which it shares most hits.
+ */
+class PFParticleComparison : public art::EDAnalyzer
+{
+public:
+    /**
+     *  @brief  Constructor
+     *
+     *  @param  pset the parameter set
+     */
+     PFParticleComparison(fhicl::ParameterSet const &pset);
+
+    /**
+     *  @brief  Destructor
+     */
+     virtual ~PFParticleComparison();
+
+     void beginJob();
+     void endJob();
+     void analyze(const art::Event &evt);
+     void reconfigure(fhicl::ParameterSet const &pset);
+
+private:
+    /**
+     *  @brief  Collect the final-state particles of a producer, each with its hits and those of its daughters
+     *
+     *  @param  evt the art event
+     *  @param  label the producer label
+     *  @param  particlesToHits to receive the mapping from final-state particles to hits
+     *  @param  hitsToParticles to receive the mapping from hits to final-state particles
+     *  @param  nNeutrinos to receive the number of reconstructed neutrinos
+     */
+    void CollectFinalStateParticles(const art::Event &evt, const std::string &label, PFParticlesToHits &particlesToHits,
+        HitsToPFParticles &hitsToParticles, int &nNeutrinos) const;
+
+    TTree          *m_pEventTree;               ///< The event-level output tree
+    TTree          *m_pParticleTree;            ///< The output tree with one entry per reference final-state particle
+
+    int             m_run;                      ///< The run number
+    int             m_event;                    ///< The event number
+    int             m_nReferenceParticles;      ///< The number of reference final-state particles
+    int             m_nTestParticles;           ///< The number of test final-state particles
+    int             m_nReferenceNeutrinos;      ///< The number of reference neutrinos
+    int             m_nTestNeutrinos;           ///< The number of test neutrinos
+    int             m_nReferenceHits;           ///< The number of hits in reference final-state particles
+    int             m_nTestHits;                ///< The number of hits in test final-state particles
+    int             m_nSharedHits;              ///< The number of hits in both a reference and a test final-state particle
+
+    int             m_index;                    ///< The index of the reference particle in the event
+    int             m_pdgCode;                  ///< The pdg code of the reference particle
+    int             m_isNeutrinoDaughter;       ///< Whether the reference particle is a neutrino daughter
+    int             m_nParticleHits;            ///< The number of hits in the reference particle
+    int             m_nMatchedParticles;        ///< The number of test particles sharing hits with the reference particle
+    int             m_nBestMatchHits;           ///< The number of hits in the best-matched test particle
+    int             m_nBestMatchSharedHits;     ///< The number of hits shared with the best-matched test particle
+    double          m_completeness;             ///< The fraction of the reference hits in the best-matched test particle
+    double          m_purity;                   ///< The fraction of the best-matched test hits in the reference particle
+
+    std::string     m_referenceModuleLabel;     ///< The label of the reference pandora producer
+    std::string     m_testModuleLabel;          ///< The label of the test pandora producer
+};
+
+DEFINE_ART_MODULE(PFParticleComparison)
+
+} // namespace lar_pandora
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+// implementation follows
+
+#include "art/Framework/Principal/Event.h"
+#include "fhiclcpp/ParameterSet.h"
+#include "art/Framework/Services/Registry/ServiceHandle.h"
+#include "art/Framework/Services/Optional/TFileService.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+#include <map>
+
+namespace lar_pandora
+{
+
+PFParticleComparison::PFParticleComparison(fhicl::ParameterSet const &pset) : art::EDAnalyzer(pset),
+    m_pEventTree(nullptr),
+    m_pParticleTree(nullptr)
+{
+    this->reconfigure(pset);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+PFParticleComparison::~PFParticleComparison()
+{
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void PFParticleComparison::reconfigure(fhicl::ParameterSet const &pset)
+{
+    m_referenceModuleLabel = pset.get<std::string>("ReferenceModule");
+    m_testModuleLabel = pset.get<std::string>("TestModule");
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void PFParticleComparison::beginJob()
+{
+    art::ServiceHandle<art::TFileService> tfs;
+
+    m_pEventTree = tfs->make<TTree>("events", "PFParticle comparison, per event");
+    m_pEventTree->Branch("run",                 &m_run,                 "run/I");
+    m_pEventTree->Branch("event",               &m_event,               "event/I");
+    m_pEventTree->Branch("nReferenceParticles", &m_nReferenceParticles, "nReferenceParticles/I");
+    m_pEventTree->Branch("nTestParticles",      &m_nTestParticles,      "nTestParticles/I");
+    m_pEventTree->Branch("nReferenceNeutrinos", &m_nReferenceNeutrinos, "nReferenceNeutrinos/I");
+    m_pEventTree->Branch("nTestNeutrinos",      &m_nTestNeutrinos,      "nTestNeutrinos/I");
+    m_pEventTree->Branch("nReferenceHits",      &m_nReferenceHits,      "nReferenceHits/I");
+    m_pEventTree->Branch("nTestHits",           &m_nTestHits,           "nTestHits/I");
+    m_pEventTree->Branch("nSharedHits",         &m_nSharedHits,         "nSharedHits/I");
+
+    m_pParticleTree = tfs->make<TTree>("particles", "PFParticle comparison, per reference final-state particle");
+    m_pParticleTree->Branch("run",                  &m_run,                  "run/I");
+    m_pParticleTree->Branch("event",                &m_event,                "event/I");
+    m_pParticleTree->Branch("index",                &m_index,                "index/I");
+    m_pParticleTree->Branch("pdgCode",              &m_pdgCode,              "pdgCode/I");
+    m_pParticleTree->Branch("isNeutrinoDaughter",   &m_isNeutrinoDaughter,   "isNeutrinoDaughter/I");
+    m_pParticleTree->Branch("nHits",                &m_nParticleHits,        "nHits/I");
+    m_pParticleTree->Branch("nMatchedParticles",    &m_nMatchedParticles,    "nMatchedParticles/I");
+    m_pParticleTree->Branch("nBestMatchHits",       &m_nBestMatchHits,       "nBestMatchHits/I");
+    m_pParticleTree->Branch("nBestMatchSharedHits", &m_nBestMatchSharedHits, "nBestMatchSharedHits/I");
+    m_pParticleTree->Branch("completeness",         &m_completeness,         "completeness/D");
+    m_pParticleTree->Branch("purity",               &m_purity,               "purity/D");
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void PFParticleComparison::endJob()
+{
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void PFParticleComparison::analyze(const art::Event &evt)
+{
+    m_run = evt.run();
+    m_event = evt.id().event();
+
+    PFParticlesToHits referenceParticlesToHits, testParticlesToHits;
+    HitsToPFParticles referenceHitsToParticles, testHitsToParticles;
+    this->CollectFinalStateParticles(evt, m_referenceModuleLabel, referenceParticlesToHits, referenceHitsToParticles, m_nReferenceNeutrinos);
+    this->CollectFinalStateParticles(evt, m_testModuleLabel, testParticlesToHits, testHitsToParticles, m_nTestNeutrinos);
+
+    m_nReferenceParticles = referenceParticlesToHits.size();
+    m_nTestParticles = testParticlesToHits.size();
+    m_nReferenceHits = referenceHitsToParticles.size();
+    m_nTestHits = testHitsToParticles.size();
+    m_nSharedHits = 0;
+
+    m_index = 0;
+
+    for (const PFParticlesToHits::value_type &referenceEntry : referenceParticlesToHits)
+    {
+        const art::Ptr<recob::PFParticle> referenceParticle(referenceEntry.first);
+        std::map<art::Ptr<recob::PFParticle>, int> testParticleToSharedHits;
+
+        for (const art::Ptr<recob::Hit> &hit : referenceEntry.second)
+        {
+            HitsToPFParticles::const_iterator testIter(testHitsToParticles.find(hit));
+
+            if (testHitsToParticles.end() != testIter)
+                ++testParticleToSharedHits[testIter->second];
+        }
+
+        m_pdgCode = referenceParticle->PdgCode();
+        m_isNeutrinoDaughter = (referenceParticle->IsPrimary() ? 0 : 1);
+        m_nParticleHits = referenceEntry.second.size();
+        m_nMatchedParticles = testParticleToSharedHits.size();
+        m_nBestMatchHits = 0;
+        m_nBestMatchSharedHits = 0;
+
+        for (const auto &testEntry : testParticleToSharedHits)
+        {
+            m_nSharedHits += testEntry.second;
+
+            if (testEntry.second > m_nBestMatchSharedHits)
+            {
+                m_nBestMatchSharedHits = testEntry.second;
+                m_nBestMatchHits = testParticlesToHits.at(testEntry.first).size();
+            }
+        }
+
+        m_completeness = ((m_nParticleHits > 0) ? static_cast<double>(m_nBestMatchSharedHits) / static_cast<double>(m_nParticleHits) : 0.);
+        m_purity = ((m_nBestMatchHits > 0) ? static_cast<double>(m_nBestMatchSharedHits) / static_cast<double>(m_nBestMatchHits) : 0.);
+
+        m_pParticleTree->Fill();
+        ++m_index;
+    }
+
+    m_pEventTree->Fill();
+
+    mf::LogDebug("LArPandora") << " PFParticleComparison::analyze - " << m_nReferenceParticles << " reference and " << m_nTestParticles
+                               << " test particles, " << m_nReferenceNeutrinos << " reference and " << m_nTestNeutrinos << " test neutrinos, "
+                               << m_nSharedHits << " of " << m_nReferenceHits << " reference hits shared " << std::endl;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void PFParticleComparison::CollectFinalStateParticles(const art::Event &evt, const std::string &label, PFParticlesToHits &particlesToHits,
+    HitsToPFParticles &hitsToParticles, int &nNeutrinos) const
+{
+    LArPandoraHelper::BuildPFParticleHitMaps(evt, label, particlesToHits, hitsToParticles, LArPandoraHelper::kAddDaughters);
+
+    PFParticleVector particleVector;
+    LArPandoraHelper::CollectPFParticles(evt, label, particleVector);
+
+    nNeutrinos = 0;
+
+    for (const art::Ptr<recob::PFParticle> &particle : particleVector)
+    {
+        if (particle->IsPrimary() && LArPandoraHelper::IsNeutrino(particle))
+            ++nNeutrinos;
+    }
+}
+
+} // namespace lar_pandora
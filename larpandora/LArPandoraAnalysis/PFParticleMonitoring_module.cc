@@ -11,6 +11,7 @@
 #include "TTree.h"
 
 #include "larpandora/LArPandoraInterface/LArPandoraHelper.h"
+#include "larpandora/LArPandoraInterface/LArPandoraTPCIndex.h"
 
 #include <string>
 
@@ -239,6 +240,8 @@ private:
 
      bool         m_recursiveMatching;      ///<
      bool         m_printDebug;             ///< switch for print statements (TODO: use message service!)
+
+     LArPandoraTPCIndex m_tpcIndex;         ///< the tpc bounding box index, for classifying true trajectory points
 };
 
 DEFINE_ART_MODULE(PFParticleMonitoring)
@@ -314,6 +317,8 @@ void PFParticleMonitoring::beginJob()
 {
     mf::LogDebug("LArPandora") << " *** PFParticleMonitoring::beginJob() *** " << std::endl;
 
+    m_tpcIndex.Build();
+
     //
     art::ServiceHandle<art::TFileService> tfs;
 
@@ -1328,36 +1333,8 @@ int PFParticleMonitoring::CountHitsByType(const int view, const HitVector &hitVe
 
 void PFParticleMonitoring::GetStartAndEndPoints(const art::Ptr<simb::MCParticle> particle, int &startT, int &endT) const
 {
-    art::ServiceHandle<geo::Geometry> theGeometry;
-
-    bool foundStartPosition(false);
-
-    const int numTrajectoryPoints(static_cast<int>(particle->NumberTrajectoryPoints()));
-
-    for (int nt = 0; nt < numTrajectoryPoints; ++nt)
-    {
-        try
-        {
-            double pos[3] = {particle->Vx(nt), particle->Vy(nt), particle->Vz(nt)};
-            unsigned int which_tpc(std::numeric_limits<unsigned int>::max());
-            unsigned int which_cstat(std::numeric_limits<unsigned int>::max());
-            theGeometry->PositionToTPC(pos, which_tpc, which_cstat);
-
-            // TODO: Apply fiducial cut due to readout window
-
-            endT = nt;
-            if (!foundStartPosition)
-            {
-                startT = endT;
-                foundStartPosition = true;
-            }
-        }
-        catch (cet::exception &e){
-            continue;
-        }
-    }
-
-    if (!foundStartPosition)
+    // TODO: Apply fiducial cut due to readout window
+    if (!m_tpcIndex.GetStartAndEndPoints(*particle, startT, endT))
         throw cet::exception("LArPandora");
 }
 
@@ -37,23 +37,9 @@ public:
     void produce(art::Event &evt) override;
 
 private:
-    /**
-     *  @brief  Build a recob::Shower object
-     *
-     *  @param  larShowerPCA the lar shower pca parameters extracted from pandora
-     *  @param  vertexPosition the shower vertex position
-     */
-    recob::Shower BuildShower(const lar_content::LArShowerPCA &larShowerPCA, const pandora::CartesianVector &vertexPosition) const;
-
-    /**
-     *  @brief  Build a recob::PCAxis object
-     *
-     *  @param  larShowerPCA the lar shower pca parameters extracted from pandora
-     */
-    recob::PCAxis BuildPCAxis(const lar_content::LArShowerPCA &larShowerPCA) const;
-
     std::string     m_pfParticleLabel;              ///< The pf particle label
     bool            m_useAllParticles;              ///< Build a recob::Track for every recob::PFParticle
+    bool            m_useCompactSpacePoints;        ///< Read the spacepoints from the compact spacepoint product, rather than recob::SpacePoints
 
     // TODO When implementation lived in LArPandoraOutput, it contained key building blocks for calculation of shower energies per plane.
     // Now functionality has moved to separate module, will require reimplementation (was deeply embedded in LArPandoraOutput structure).
@@ -89,7 +75,10 @@ DEFINE_ART_MODULE(LArPandoraShowerCreation)
 
 #include "larpandoracontent/LArHelpers/LArPfoHelper.h"
 
+#include "larpandora/LArPandoraObjects/LArCompactSpacePoints.h"
+
 #include "larpandora/LArPandoraInterface/LArPandoraHelper.h"
+#include "larpandora/LArPandoraInterface/LArPandoraOutput.h"
 
 #include <iostream>
 
@@ -98,7 +87,8 @@ namespace lar_pandora
 
 LArPandoraShowerCreation::LArPandoraShowerCreation(fhicl::ParameterSet const &pset) :
     m_pfParticleLabel(pset.get<std::string>("PFParticleLabel")),
-    m_useAllParticles(pset.get<bool>("UseAllParticles", false))
+    m_useAllParticles(pset.get<bool>("UseAllParticles", false)),
+    m_useCompactSpacePoints(pset.get<bool>("UseCompactSpacePoints", false))
 {
     produces< std::vector<recob::Shower> >();
     produces< std::vector<recob::PCAxis> >();
@@ -125,7 +115,20 @@ void LArPandoraShowerCreation::produce(art::Event &evt)
     // Organise inputs
     PFParticleVector pfParticleVector;
     PFParticlesToSpacePoints pfParticlesToSpacePoints;
-    LArPandoraHelper::CollectPFParticles(evt, m_pfParticleLabel, pfParticleVector, pfParticlesToSpacePoints);
+    art::Handle<LArCompactSpacePoints> compactSpacePointHandle;
+
+    if (m_useCompactSpacePoints)
+    {
+        LArPandoraHelper::CollectPFParticles(evt, m_pfParticleLabel, pfParticleVector);
+        evt.getByLabel(m_pfParticleLabel, compactSpacePointHandle);
+
+        if (!compactSpacePointHandle.isValid())
+            throw cet::exception("LArPandoraShowerCreation") << "Unable to find compact spacepoints with label " << m_pfParticleLabel;
+    }
+    else
+    {
+        LArPandoraHelper::CollectPFParticles(evt, m_pfParticleLabel, pfParticleVector, pfParticlesToSpacePoints);
+    }
 
     VertexVector vertexVector;
     PFParticlesToVertices pfParticlesToVertices;
@@ -139,8 +142,12 @@ void LArPandoraShowerCreation::produce(art::Event &evt)
 
         // Obtain associated spacepoints
         PFParticlesToSpacePoints::const_iterator particleToSpacePointIter(pfParticlesToSpacePoints.find(pPFParticle));
+        unsigned int firstSpacePoint(0), endSpacePoint(0);
+
+        if (m_useCompactSpacePoints)
+            compactSpacePointHandle->GetPFParticleSpacePoints(pPFParticle.key(), firstSpacePoint, endSpacePoint);
 
-        if (pfParticlesToSpacePoints.end() == particleToSpacePointIter)
+        if (m_useCompactSpacePoints ? (firstSpacePoint == endSpacePoint) : (pfParticlesToSpacePoints.end() == particleToSpacePointIter))
         {
             mf::LogDebug("LArPandoraShowerCreation") << "No spacepoints associated to particle ";
             continue;
@@ -157,8 +164,21 @@ void LArPandoraShowerCreation::produce(art::Event &evt)
 
         // Copy information into expected pandora form
         pandora::CartesianPointVector cartesianPointVector;
-        for (const art::Ptr<recob::SpacePoint> spacePoint : particleToSpacePointIter->second)
-            cartesianPointVector.emplace_back(pandora::CartesianVector(spacePoint->XYZ()[0], spacePoint->XYZ()[1], spacePoint->XYZ()[2]));
+        if (m_useCompactSpacePoints)
+        {
+            const LArCompactSpacePoints &compactSpacePoints(*compactSpacePointHandle);
+
+            for (unsigned int spacePointIndex = firstSpacePoint; spacePointIndex < endSpacePoint; ++spacePointIndex)
+            {
+                cartesianPointVector.emplace_back(pandora::CartesianVector(compactSpacePoints.GetX()[spacePointIndex], compactSpacePoints.GetY()[spacePointIndex],
+                    compactSpacePoints.GetZ()[spacePointIndex]));
+            }
+        }
+        else
+        {
+            for (const art::Ptr<recob::SpacePoint> spacePoint : particleToSpacePointIter->second)
+                cartesianPointVector.emplace_back(pandora::CartesianVector(spacePoint->XYZ()[0], spacePoint->XYZ()[1], spacePoint->XYZ()[2]));
+        }
 
         double vertexXYZ[3] = {0., 0., 0.};
         particleToVertexIter->second.front()->XYZ(vertexXYZ);
@@ -169,8 +189,8 @@ void LArPandoraShowerCreation::produce(art::Event &evt)
         {
             // Ensure successful creation of all structures before placing results in output containers
             const lar_content::LArShowerPCA larShowerPCA(lar_content::LArPfoHelper::GetPrincipalComponents(cartesianPointVector, vertexPosition));
-            const recob::Shower shower(LArPandoraShowerCreation::BuildShower(larShowerPCA, vertexPosition));
-            const recob::PCAxis pcAxis(LArPandoraShowerCreation::BuildPCAxis(larShowerPCA));
+            const recob::Shower shower(LArPandoraOutput::BuildShower(larShowerPCA, vertexPosition));
+            const recob::PCAxis pcAxis(LArPandoraOutput::BuildPCAxis(larShowerPCA));
             outputShowers->emplace_back(shower);
             outputPCAxes->emplace_back(pcAxis);
         }
@@ -185,7 +205,14 @@ void LArPandoraShowerCreation::produce(art::Event &evt)
         art::Ptr<recob::PCAxis> pPCAxis(makePCAxisPtr(outputPCAxes->size() - 1));
 
         HitVector hitsInParticle;
-        LArPandoraHelper::GetAssociatedHits(evt, m_pfParticleLabel, particleToSpacePointIter->second, hitsInParticle);
+        if (m_useCompactSpacePoints)
+        {
+            LArPandoraHelper::GetAssociatedHits(evt, *compactSpacePointHandle, firstSpacePoint, endSpacePoint, hitsInParticle);
+        }
+        else
+        {
+            LArPandoraHelper::GetAssociatedHits(evt, m_pfParticleLabel, particleToSpacePointIter->second, hitsInParticle);
+        }
 
         // Output associations, after output objects are in place
         util::CreateAssn(*this, evt, pShower, pPFParticle, *(outputParticlesToShowers.get()));
@@ -205,56 +232,4 @@ void LArPandoraShowerCreation::produce(art::Event &evt)
     evt.put(std::move(outputShowersToPCAxes));
 }
 
-//------------------------------------------------------------------------------------------------------------------------------------------
-
-recob::Shower LArPandoraShowerCreation::BuildShower(const lar_content::LArShowerPCA &larShowerPCA, const pandora::CartesianVector &vertexPosition) const
-{
-    const pandora::CartesianVector &showerLength(larShowerPCA.GetAxisLengths());
-    const pandora::CartesianVector &showerDirection(larShowerPCA.GetPrimaryAxis());
-
-    const float length(showerLength.GetX());
-    const float openingAngle(larShowerPCA.GetPrimaryLength() > 0.f ? std::atan(larShowerPCA.GetSecondaryLength() / larShowerPCA.GetPrimaryLength()) : 0.f);
-    const TVector3 direction(showerDirection.GetX(), showerDirection.GetY(), showerDirection.GetZ());
-    const TVector3 vertex(vertexPosition.GetX(), vertexPosition.GetY(), vertexPosition.GetZ());
-
-    // TODO
-    const TVector3 directionErr;
-    const TVector3 vertexErr;
-    const std::vector<double> totalEnergyErr;
-    const std::vector<double> dEdx;
-    const std::vector<double> dEdxErr;
-    const std::vector<double> totalEnergy;
-    const int bestplane(0);
-
-    return recob::Shower(direction, directionErr, vertex, vertexErr, totalEnergy, totalEnergyErr, dEdx, dEdxErr, bestplane, util::kBogusI, length, openingAngle);
-}
-
-//------------------------------------------------------------------------------------------------------------------------------------------
-
-recob::PCAxis LArPandoraShowerCreation::BuildPCAxis(const lar_content::LArShowerPCA &larShowerPCA) const
-{
-    const pandora::CartesianVector &showerCentroid(larShowerPCA.GetCentroid());
-    const pandora::CartesianVector &showerDirection(larShowerPCA.GetPrimaryAxis());
-    const pandora::CartesianVector &showerSecondaryVector(larShowerPCA.GetSecondaryAxis());
-    const pandora::CartesianVector &showerTertiaryVector(larShowerPCA.GetTertiaryAxis());
-    const pandora::CartesianVector &showerEigenValues(larShowerPCA.GetEigenValues());
-
-    const bool svdOK(true); ///< SVD Decomposition was successful
-    const double eigenValues[3] = {showerEigenValues.GetX(), showerEigenValues.GetY(), showerEigenValues.GetZ()}; ///< Eigen values from SVD decomposition
-    const double avePosition[3] = {showerCentroid.GetX(), showerCentroid.GetY(), showerCentroid.GetZ()}; ///< Average position of hits fed to PCA
-
-    std::vector< std::vector<double> > eigenVecs = { /// The three principle axes
-        { showerDirection.GetX(), showerDirection.GetY(), showerDirection.GetZ() },
-        { showerSecondaryVector.GetX(), showerSecondaryVector.GetY(), showerSecondaryVector.GetZ() },
-        { showerTertiaryVector.GetX(), showerTertiaryVector.GetY(), showerTertiaryVector.GetZ() }
-    };
-
-    // TODO
-    const int numHitsUsed(100); ///< Number of hits in the decomposition, not yet ready
-    const double aveHitDoca(0.); ///< Average doca of hits used in PCA, not ready yet
-    const size_t iD(util::kBogusI); ///< Axis ID, not ready yet
-
-    return recob::PCAxis(svdOK, numHitsUsed, eigenValues, eigenVecs, avePosition, aveHitDoca, iD);
-}
-
 } // namespace lar_pandora
@@ -35,18 +35,11 @@ public:
     void produce(art::Event &evt) override;
 
 private:
-    /**
-     *  @brief Build a recob::Track object
-     *
-     *  @param id the id code for the track
-     *  @param trackStateVector the vector of trajectory points for this track
-     */
-    recob::Track BuildTrack(const int id, const lar_content::LArTrackStateVector &trackStateVector) const;
-
     std::string     m_pfParticleLabel;              ///< The pf particle label
     unsigned int    m_minTrajectoryPoints;          ///< The minimum number of trajectory points
     unsigned int    m_slidingFitHalfWindow;         ///< The sliding fit half window
     bool            m_useAllParticles;              ///< Build a recob::Track for every recob::PFParticle
+    bool            m_useCompactSpacePoints;        ///< Read the spacepoints from the compact spacepoint product, rather than recob::SpacePoints
 };
 
 DEFINE_ART_MODULE(LArPandoraTrackCreation)
@@ -77,7 +70,10 @@ DEFINE_ART_MODULE(LArPandoraTrackCreation)
 
 #include "larpandoracontent/LArHelpers/LArPfoHelper.h"
 
+#include "larpandora/LArPandoraObjects/LArCompactSpacePoints.h"
+
 #include "larpandora/LArPandoraInterface/LArPandoraHelper.h"
+#include "larpandora/LArPandoraInterface/LArPandoraOutput.h"
 
 #include <iostream>
 
@@ -88,7 +84,8 @@ LArPandoraTrackCreation::LArPandoraTrackCreation(fhicl::ParameterSet const &pset
     m_pfParticleLabel(pset.get<std::string>("PFParticleLabel")),
     m_minTrajectoryPoints(pset.get<unsigned int>("MinTrajectoryPoints", 2)),
     m_slidingFitHalfWindow(pset.get<unsigned int>("SlidingFitHalfWindow", 20)),
-    m_useAllParticles(pset.get<bool>("UseAllParticles", false))
+    m_useAllParticles(pset.get<bool>("UseAllParticles", false)),
+    m_useCompactSpacePoints(pset.get<bool>("UseCompactSpacePoints", false))
 {
     produces< std::vector<recob::Track> >();
     produces< art::Assns<recob::PFParticle, recob::Track> >();
@@ -117,7 +114,20 @@ void LArPandoraTrackCreation::produce(art::Event &evt)
     // Organise inputs
     PFParticleVector pfParticleVector;
     PFParticlesToSpacePoints pfParticlesToSpacePoints;
-    LArPandoraHelper::CollectPFParticles(evt, m_pfParticleLabel, pfParticleVector, pfParticlesToSpacePoints);
+    art::Handle<LArCompactSpacePoints> compactSpacePointHandle;
+
+    if (m_useCompactSpacePoints)
+    {
+        LArPandoraHelper::CollectPFParticles(evt, m_pfParticleLabel, pfParticleVector);
+        evt.getByLabel(m_pfParticleLabel, compactSpacePointHandle);
+
+        if (!compactSpacePointHandle.isValid())
+            throw cet::exception("LArPandoraTrackCreation") << "Unable to find compact spacepoints with label " << m_pfParticleLabel;
+    }
+    else
+    {
+        LArPandoraHelper::CollectPFParticles(evt, m_pfParticleLabel, pfParticleVector, pfParticlesToSpacePoints);
+    }
 
     VertexVector vertexVector;
     PFParticlesToVertices pfParticlesToVertices;
@@ -131,8 +141,12 @@ void LArPandoraTrackCreation::produce(art::Event &evt)
 
         // Obtain associated spacepoints
         PFParticlesToSpacePoints::const_iterator particleToSpacePointIter(pfParticlesToSpacePoints.find(pPFParticle));
+        unsigned int firstSpacePoint(0), endSpacePoint(0);
 
-        if (pfParticlesToSpacePoints.end() == particleToSpacePointIter)
+        if (m_useCompactSpacePoints)
+            compactSpacePointHandle->GetPFParticleSpacePoints(pPFParticle.key(), firstSpacePoint, endSpacePoint);
+
+        if (m_useCompactSpacePoints ? (firstSpacePoint == endSpacePoint) : (pfParticlesToSpacePoints.end() == particleToSpacePointIter))
         {
             mf::LogDebug("LArPandoraTrackCreation") << "No spacepoints associated to particle ";
             continue;
@@ -149,8 +163,21 @@ void LArPandoraTrackCreation::produce(art::Event &evt)
 
         // Copy information into expected pandora form
         pandora::CartesianPointVector cartesianPointVector;
-        for (const art::Ptr<recob::SpacePoint> spacePoint : particleToSpacePointIter->second)
-            cartesianPointVector.emplace_back(pandora::CartesianVector(spacePoint->XYZ()[0], spacePoint->XYZ()[1], spacePoint->XYZ()[2]));
+        if (m_useCompactSpacePoints)
+        {
+            const LArCompactSpacePoints &compactSpacePoints(*compactSpacePointHandle);
+
+            for (unsigned int spacePointIndex = firstSpacePoint; spacePointIndex < endSpacePoint; ++spacePointIndex)
+            {
+                cartesianPointVector.emplace_back(pandora::CartesianVector(compactSpacePoints.GetX()[spacePointIndex], compactSpacePoints.GetY()[spacePointIndex],
+                    compactSpacePoints.GetZ()[spacePointIndex]));
+            }
+        }
+        else
+        {
+            for (const art::Ptr<recob::SpacePoint> spacePoint : particleToSpacePointIter->second)
+                cartesianPointVector.emplace_back(pandora::CartesianVector(spacePoint->XYZ()[0], spacePoint->XYZ()[1], spacePoint->XYZ()[2]));
+        }
 
         double vertexXYZ[3] = {0., 0., 0.};
         particleToVertexIter->second.front()->XYZ(vertexXYZ);
@@ -176,7 +203,14 @@ void LArPandoraTrackCreation::produce(art::Event &evt)
         }
 
         HitVector hitsInParticle;
-        LArPandoraHelper::GetAssociatedHits(evt, m_pfParticleLabel, particleToSpacePointIter->second, hitsInParticle, &indexVector);
+        if (m_useCompactSpacePoints)
+        {
+            LArPandoraHelper::GetAssociatedHits(evt, *compactSpacePointHandle, firstSpacePoint, endSpacePoint, hitsInParticle, &indexVector);
+        }
+        else
+        {
+            LArPandoraHelper::GetAssociatedHits(evt, m_pfParticleLabel, particleToSpacePointIter->second, hitsInParticle, &indexVector);
+        }
 
         // Add invalid points at the end of the vector, so that the number of the trajectory points is the same as the number of hits
         if (trackStateVector.size()>hitsInParticle.size())
@@ -190,7 +224,7 @@ void LArPandoraTrackCreation::produce(art::Event &evt)
         }
 
         // Output objects
-        outputTracks->emplace_back(LArPandoraTrackCreation::BuildTrack(trackCounter++, trackStateVector));
+        outputTracks->emplace_back(LArPandoraOutput::BuildTrack(trackCounter++, trackStateVector));
         art::Ptr<recob::Track> pTrack(makeTrackPtr(outputTracks->size() - 1));
 
         // Output associations, after output objects are in place
@@ -213,35 +247,4 @@ void LArPandoraTrackCreation::produce(art::Event &evt)
     evt.put(std::move(outputParticlesToTracks));
 }
 
-//------------------------------------------------------------------------------------------------------------------------------------------
-
-recob::Track LArPandoraTrackCreation::BuildTrack(const int id, const lar_content::LArTrackStateVector &trackStateVector) const
-{
-    if (trackStateVector.empty())
-        throw cet::exception("LArPandoraTrackCreation") << "BuildTrack - No input trajectory points provided ";
-
-    recob::tracking::Positions_t xyz;
-    recob::tracking::Momenta_t pxpypz;
-    recob::TrackTrajectory::Flags_t flags;
-
-    for (const lar_content::LArTrackState &trackState : trackStateVector)
-    {
-        xyz.emplace_back(recob::tracking::Point_t(trackState.GetPosition().GetX(), trackState.GetPosition().GetY(), trackState.GetPosition().GetZ()));
-        pxpypz.emplace_back(recob::tracking::Vector_t(trackState.GetDirection().GetX(), trackState.GetDirection().GetY(), trackState.GetDirection().GetZ()));
-        // Set flag NoPoint if point has bogus coordinates, otherwise use clean flag set
-        if (std::fabs(trackState.GetPosition().GetX()-util::kBogusF)<std::numeric_limits<float>::epsilon() &&
-            std::fabs(trackState.GetPosition().GetY()-util::kBogusF)<std::numeric_limits<float>::epsilon() &&
-            std::fabs(trackState.GetPosition().GetZ()-util::kBogusF)<std::numeric_limits<float>::epsilon())
-        {
-            flags.emplace_back(recob::TrajectoryPointFlags(recob::TrajectoryPointFlags::InvalidHitIndex, recob::TrajectoryPointFlagTraits::NoPoint));
-        } else {
-            flags.emplace_back(recob::TrajectoryPointFlags());
-        }
-    }
-
-    // note from gc: eventually we should produce a TrackTrajectory, not a Track with empty covariance matrix and bogus chi2, etc.
-    return recob::Track(recob::TrackTrajectory(std::move(xyz), std::move(pxpypz), std::move(flags), false),
-                        util::kBogusI, util::kBogusF, util::kBogusI, recob::tracking::SMatrixSym55(), recob::tracking::SMatrixSym55(), id);
-}
-
 } // namespace lar_pandora
@@ -9,7 +9,8 @@
 
 #include "art/Framework/Core/EDProducer.h"
 
-namespace recob {class Hit;}
+#include "larpandora/LArPandoraInterface/LArHitRegistry.h"
+
 namespace pandora {class Pandora;}
 
 //------------------------------------------------------------------------------------------------------------------------------------------
@@ -17,7 +18,7 @@ namespace pandora {class Pandora;}
 namespace lar_pandora
 {
 
-typedef std::map< int, art::Ptr<recob::Hit> > IdToHitMap;
+typedef std::map< unsigned int, const pandora::Pandora* > VolumeIdToPandoraMap;
 
 /**
  *  @brief  ILArPandora class
@@ -57,17 +58,17 @@ protected:
      *  @brief  Create pandora input hits, mc particles etc.
      *
      *  @param  evt the art event
-     *  @param  idToHitMap to receive the populated pandora hit id to art hit map
+     *  @param  hitRegistry to receive the populated registry of art hits, by pandora hit id
      */
-    virtual void CreatePandoraInput(art::Event &evt, IdToHitMap &idToHitMap) = 0;
+    virtual void CreatePandoraInput(art::Event &evt, LArHitRegistry &hitRegistry) = 0;
 
     /**
      *  @brief  Process pandora output particle flow objects
      *
      *  @param  evt the art event
-     *  @param  idToHitMap the pandora hit id to art hit map
+     *  @param  hitRegistry the registry of art hits, by pandora hit id
      */
-    virtual void ProcessPandoraOutput(art::Event &evt, const IdToHitMap &idToHitMap) = 0;
+    virtual void ProcessPandoraOutput(art::Event &evt, const LArHitRegistry &hitRegistry) = 0;
 
     /**
      *  @brief  Run all associated pandora instances
@@ -80,6 +81,7 @@ protected:
     virtual void ResetPandoraInstances() = 0;
 
     const pandora::Pandora     *m_pPrimaryPandora;          ///< The address of the primary pandora instance
+    VolumeIdToPandoraMap        m_daughterPandoraInstances; ///< The daughter pandora instances, one per drift volume (if in use)
 };
 
 //------------------------------------------------------------------------------------------------------------------------------------------
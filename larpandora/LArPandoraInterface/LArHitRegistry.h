@@ -0,0 +1,239 @@
+/**
+ *  @file   larpandora/LArPandoraInterface/LArHitRegistry.h
+ *
+ *  @brief  Dense, index-addressed registry of the ART hits passed to pandora, keyed by pandora hit id
+ */
+
+#ifndef LAR_HIT_REGISTRY_H
+#define LAR_HIT_REGISTRY_H 1
+
+#include "canvas/Persistency/Common/Ptr.h"
+#include "cetlib/exception.h"
+
+#include "lardataobj/RecoBase/Hit.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace lar_pandora
+{
+
+/**
+ *  @brief  LArHitRegistry class. Pandora hit ids are contiguous integers from one, so the hits for each id are stored contiguously,
+ *          with an offset per id - 1 and empty ranges for ids that were used but not registered. Each id usually has a single ART hit,
+ *          but a pandora hit made by coalescing several ART hits has them all, with the representative hit first.
+ */
+class LArHitRegistry
+{
+public:
+    typedef std::vector< art::Ptr<recob::Hit> > HitPtrVector;
+
+    /**
+     *  @brief  Default constructor
+     */
+    LArHitRegistry();
+
+    /**
+     *  @brief  Register an ART hit
+     *
+     *  @param  id the pandora hit id, which must exceed the largest id registered so far
+     *  @param  hit the ART hit
+     */
+    void AddHit(const int id, const art::Ptr<recob::Hit> &hit);
+
+    /**
+     *  @brief  Register the ART hits coalesced into a single pandora hit
+     *
+     *  @param  id the pandora hit id, which must exceed the largest id registered so far
+     *  @param  begin the representative ART hit, followed by the other coalesced hits
+     *  @param  end one past the last coalesced ART hit
+     */
+    void AddHits(const int id, const HitPtrVector::const_iterator begin, const HitPtrVector::const_iterator end);
+
+    /**
+     *  @brief  Whether an ART hit is registered for a given pandora hit id
+     *
+     *  @param  id the pandora hit id
+     */
+    bool HasHit(const int id) const;
+
+    /**
+     *  @brief  Get the (representative) ART hit registered for a given pandora hit id, throwing if there is none
+     *
+     *  @param  id the pandora hit id
+     */
+    const art::Ptr<recob::Hit> &GetHit(const int id) const;
+
+    /**
+     *  @brief  Get the (representative) ART hit registered for a given pandora hit parent address, throwing if there is none
+     *
+     *  @param  pParentAddress the pandora hit parent address
+     */
+    const art::Ptr<recob::Hit> &GetHit(const void *const pParentAddress) const;
+
+    /**
+     *  @brief  Get the first of the ART hits registered for a given pandora hit id (the representative hit)
+     *
+     *  @param  id the pandora hit id
+     */
+    HitPtrVector::const_iterator Begin(const int id) const;
+
+    /**
+     *  @brief  Get one past the last of the ART hits registered for a given pandora hit id
+     *
+     *  @param  id the pandora hit id
+     */
+    HitPtrVector::const_iterator End(const int id) const;
+
+    /**
+     *  @brief  Get the largest registered pandora hit id (zero if the registry is empty)
+     */
+    int GetMaxId() const;
+
+    /**
+     *  @brief  Get the number of registered pandora hits
+     */
+    unsigned int GetNHits() const;
+
+    /**
+     *  @brief  Get the number of registered ART hits, which exceeds the number of pandora hits if any hits were coalesced
+     */
+    unsigned int GetNArtHits() const;
+
+    /**
+     *  @brief  Whether the registry is empty
+     */
+    bool IsEmpty() const;
+
+    /**
+     *  @brief  Reserve storage for a number of hit ids
+     *
+     *  @param  nIds the number of hit ids
+     *  @param  nArtHits the number of ART hits (if zero, one per hit id)
+     */
+    void Reserve(const unsigned int nIds, const unsigned int nArtHits = 0);
+
+private:
+    HitPtrVector                m_hits;         ///< The registered hits, contiguous per pandora hit id
+    std::vector<unsigned int>   m_offsets;      ///< The index of the first hit for each pandora hit id - 1, with a final entry for the total
+    unsigned int                m_nHits;        ///< The number of registered pandora hits
+};
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline LArHitRegistry::LArHitRegistry() :
+    m_offsets(1, 0),
+    m_nHits(0)
+{
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline void LArHitRegistry::AddHit(const int id, const art::Ptr<recob::Hit> &hit)
+{
+    if ((id <= this->GetMaxId()) || hit.isNull())
+        throw cet::exception("LArPandora") << " LArHitRegistry::AddHit --- hit ids must be registered in increasing order, with non-null hits (id " << id << ") ";
+
+    m_offsets.resize(id, m_hits.size());
+    m_hits.push_back(hit);
+    m_offsets.push_back(m_hits.size());
+    ++m_nHits;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline void LArHitRegistry::AddHits(const int id, const HitPtrVector::const_iterator begin, const HitPtrVector::const_iterator end)
+{
+    if ((id <= this->GetMaxId()) || (begin == end))
+        throw cet::exception("LArPandora") << " LArHitRegistry::AddHits --- hit ids must be registered in increasing order, with non-null hits (id " << id << ") ";
+
+    for (HitPtrVector::const_iterator iter = begin; iter != end; ++iter)
+    {
+        if (iter->isNull())
+            throw cet::exception("LArPandora") << " LArHitRegistry::AddHits --- hit ids must be registered in increasing order, with non-null hits (id " << id << ") ";
+    }
+
+    m_offsets.resize(id, m_hits.size());
+    m_hits.insert(m_hits.end(), begin, end);
+    m_offsets.push_back(m_hits.size());
+    ++m_nHits;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline bool LArHitRegistry::HasHit(const int id) const
+{
+    return ((id > 0) && (id <= this->GetMaxId()) && (m_offsets[id] > m_offsets[id - 1]));
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline const art::Ptr<recob::Hit> &LArHitRegistry::GetHit(const int id) const
+{
+    if (!this->HasHit(id))
+        throw cet::exception("LArPandora") << " LArHitRegistry::GetHit --- found a Pandora hit without a parent ART hit ";
+
+    return m_hits[m_offsets[id - 1]];
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline const art::Ptr<recob::Hit> &LArHitRegistry::GetHit(const void *const pParentAddress) const
+{
+    const intptr_t hitID_temp((intptr_t)(pParentAddress));
+    return this->GetHit((int)(hitID_temp));
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline LArHitRegistry::HitPtrVector::const_iterator LArHitRegistry::Begin(const int id) const
+{
+    return (m_hits.begin() + (((id > 0) && (id <= this->GetMaxId())) ? m_offsets[id - 1] : m_hits.size()));
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline LArHitRegistry::HitPtrVector::const_iterator LArHitRegistry::End(const int id) const
+{
+    return (m_hits.begin() + (((id > 0) && (id <= this->GetMaxId())) ? m_offsets[id] : m_hits.size()));
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline int LArHitRegistry::GetMaxId() const
+{
+    return static_cast<int>(m_offsets.size() - 1);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline unsigned int LArHitRegistry::GetNHits() const
+{
+    return m_nHits;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline unsigned int LArHitRegistry::GetNArtHits() const
+{
+    return m_hits.size();
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline bool LArHitRegistry::IsEmpty() const
+{
+    return (0 == m_nHits);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline void LArHitRegistry::Reserve(const unsigned int nIds, const unsigned int nArtHits)
+{
+    m_offsets.reserve(nIds + 1);
+    m_hits.reserve((nArtHits > 0) ? nArtHits : nIds);
+}
+
+} // namespace lar_pandora
+
+#endif // #ifndef LAR_HIT_REGISTRY_H
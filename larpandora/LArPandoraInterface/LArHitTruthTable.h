@@ -0,0 +1,194 @@
+/**
+ *  @file   larpandora/LArPandoraInterface/LArHitTruthTable.h
+ *
+ *  @brief  Flat (compressed sparse row) table of the true energy deposits of ART hits, indexed by hit key
+ */
+
+#ifndef LAR_HIT_TRUTH_TABLE_H
+#define LAR_HIT_TRUTH_TABLE_H 1
+
+#include "cetlib/exception.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace lar_pandora
+{
+
+/**
+ *  @brief  LArHitTruthTable class. The true energy deposits of all hits are stored contiguously, with an offset per hit key, so that
+ *          the deposits of a hit are found without a map lookup and the whole table is built with a handful of allocations. All hits
+ *          must belong to a single hit collection, so that hit keys are unique.
+ */
+class LArHitTruthTable
+{
+public:
+    /**
+     *  @brief  Entry class, a single true energy deposit
+     */
+    class Entry
+    {
+    public:
+        /**
+         *  @brief  Constructor
+         *
+         *  @param  trackID the G4 track id
+         *  @param  energy the deposited energy
+         *  @param  energyFrac the fraction of the hit energy deposited by this track
+         */
+        Entry(const int trackID, const float energy, const float energyFrac);
+
+        int     m_trackID;      ///< The G4 track id
+        float   m_energy;       ///< The deposited energy
+        float   m_energyFrac;   ///< The fraction of the hit energy deposited by this track
+    };
+
+    typedef std::vector<Entry> EntryList;
+
+    /**
+     *  @brief  Default constructor
+     */
+    LArHitTruthTable();
+
+    /**
+     *  @brief  Add the true energy deposits of a hit
+     *
+     *  @param  hitKey the hit key, which must exceed the largest hit key added so far
+     *  @param  begin the first energy deposit
+     *  @param  end one past the last energy deposit
+     */
+    void AddHit(const std::size_t hitKey, const EntryList::const_iterator begin, const EntryList::const_iterator end);
+
+    /**
+     *  @brief  Get the first true energy deposit of a hit
+     *
+     *  @param  hitKey the hit key
+     */
+    EntryList::const_iterator Begin(const std::size_t hitKey) const;
+
+    /**
+     *  @brief  Get one past the last true energy deposit of a hit
+     *
+     *  @param  hitKey the hit key
+     */
+    EntryList::const_iterator End(const std::size_t hitKey) const;
+
+    /**
+     *  @brief  Get the number of true energy deposits of a hit (zero for hits without truth information)
+     *
+     *  @param  hitKey the hit key
+     */
+    unsigned int GetNEntries(const std::size_t hitKey) const;
+
+    /**
+     *  @brief  Get the true energy deposits of all hits, in order of hit key
+     */
+    const EntryList &GetEntries() const;
+
+    /**
+     *  @brief  Get one past the largest hit key added
+     */
+    std::size_t GetHitKeyEnd() const;
+
+    /**
+     *  @brief  Reserve storage
+     *
+     *  @param  nHitKeys the number of hit keys
+     *  @param  nEntries the number of true energy deposits
+     */
+    void Reserve(const std::size_t nHitKeys, const std::size_t nEntries);
+
+    /**
+     *  @brief  Clear the table
+     */
+    void Clear();
+
+private:
+    std::vector<unsigned int>   m_offsets;      ///< The index of the first energy deposit of each hit key, with a final entry for the total
+    EntryList                   m_entries;      ///< The true energy deposits of all hits, contiguous per hit key
+};
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline LArHitTruthTable::Entry::Entry(const int trackID, const float energy, const float energyFrac) :
+    m_trackID(trackID),
+    m_energy(energy),
+    m_energyFrac(energyFrac)
+{
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline LArHitTruthTable::LArHitTruthTable() :
+    m_offsets(1, 0)
+{
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline void LArHitTruthTable::AddHit(const std::size_t hitKey, const EntryList::const_iterator begin, const EntryList::const_iterator end)
+{
+    if (hitKey < this->GetHitKeyEnd())
+        throw cet::exception("LArPandora") << " LArHitTruthTable::AddHit --- hit keys must be added in increasing order (key " << hitKey << ") ";
+
+    // Hit keys without truth information are given empty ranges
+    m_offsets.resize(hitKey + 1, m_entries.size());
+    m_entries.insert(m_entries.end(), begin, end);
+    m_offsets.push_back(m_entries.size());
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline LArHitTruthTable::EntryList::const_iterator LArHitTruthTable::Begin(const std::size_t hitKey) const
+{
+    return (m_entries.begin() + ((hitKey < this->GetHitKeyEnd()) ? m_offsets[hitKey] : m_entries.size()));
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline LArHitTruthTable::EntryList::const_iterator LArHitTruthTable::End(const std::size_t hitKey) const
+{
+    return (m_entries.begin() + ((hitKey < this->GetHitKeyEnd()) ? m_offsets[hitKey + 1] : m_entries.size()));
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline unsigned int LArHitTruthTable::GetNEntries(const std::size_t hitKey) const
+{
+    return ((hitKey < this->GetHitKeyEnd()) ? (m_offsets[hitKey + 1] - m_offsets[hitKey]) : 0);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline const LArHitTruthTable::EntryList &LArHitTruthTable::GetEntries() const
+{
+    return m_entries;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline std::size_t LArHitTruthTable::GetHitKeyEnd() const
+{
+    return (m_offsets.size() - 1);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline void LArHitTruthTable::Reserve(const std::size_t nHitKeys, const std::size_t nEntries)
+{
+    m_offsets.reserve(nHitKeys + 1);
+    m_entries.reserve(nEntries);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline void LArHitTruthTable::Clear()
+{
+    m_offsets.assign(1, 0);
+    m_entries.clear();
+}
+
+} // namespace lar_pandora
+
+#endif // #ifndef LAR_HIT_TRUTH_TABLE_H
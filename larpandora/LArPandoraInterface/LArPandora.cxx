@@ -6,8 +6,10 @@
  */
 
 #include "art/Framework/Principal/Event.h"
+#include "art/Framework/Principal/Run.h"
 #include "art/Framework/Services/Optional/TFileService.h"
 #include "cetlib/cpu_timer.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
 
 #include "lardata/DetectorInfoServices/DetectorPropertiesService.h"
 #include "lardata/DetectorInfoServices/DetectorClocksService.h"
@@ -22,6 +24,7 @@
 #include "lardataobj/RecoBase/Shower.h"
 #include "lardataobj/RecoBase/SpacePoint.h"
 #include "lardataobj/RecoBase/Track.h"
+#include "lardataobj/RecoBase/TrackHitMeta.h"
 #include "lardataobj/RecoBase/Vertex.h"
 
 #include "nusimdata/SimulationBase/MCParticle.h"
@@ -31,12 +34,19 @@
 #include "larpandoracontent/LArContent.h"
 #include "larpandoracontent/LArHelpers/LArPfoHelper.h"
 
+#include "larpandora/LArPandoraObjects/LArCompactSpacePoints.h"
+#include "larpandora/LArPandoraObjects/LArHitOwnership.h"
+#include "larpandora/LArPandoraObjects/LArRejectedHits.h"
+
 #include "larpandora/LArPandoraInterface/LArPandora.h"
 #include "larpandora/LArPandoraInterface/LArPandoraHelper.h"
 #include "larpandora/LArPandoraInterface/LArPandoraInput.h"
 #include "larpandora/LArPandoraInterface/LArPandoraOutput.h"
+#include "larpandora/LArPandoraInterface/LArPandoraParallel.h"
 
+#include <algorithm>
 #include <iostream>
+#include <iterator>
 #include <limits>
 
 namespace lar_pandora
@@ -53,14 +63,24 @@ LArPandora::LArPandora(fhicl::ParameterSet const &pset) :
     m_shouldRunCosmicRecoOption(pset.get<bool>("ShouldRunCosmicRecoOption")),
     m_shouldPerformSliceId(pset.get<bool>("ShouldPerformSliceId")),
     m_printOverallRecoStatus(pset.get<bool>("PrintOverallRecoStatus", false)),
+    m_shouldRunDriftVolumesInParallel(pset.get<bool>("ShouldRunDriftVolumesInParallel", false)),
+    m_driftVolumeConfigFile(pset.get<std::string>("DriftVolumeConfigFile", "")),
+    m_shouldProcessDriftVolumesConcurrently(pset.get<bool>("ShouldProcessDriftVolumesConcurrently", false)),
+    m_nThreads(pset.get<unsigned int>("NThreads", 1)),
+    m_hitCoalescenceThreshold(pset.get<unsigned int>("HitCoalescenceThreshold", 0)),
     m_generatorModuleLabel(pset.get<std::string>("GeneratorModuleLabel", "")),
     m_geantModuleLabel(pset.get<std::string>("GeantModuleLabel", "largeant")),
     m_hitfinderModuleLabel(pset.get<std::string>("HitFinderModuleLabel")),
     m_backtrackerModuleLabel(pset.get<std::string>("BackTrackerModuleLabel","")),
+    m_readoutGapCacheFile(pset.get<std::string>("ReadoutGapCacheFile", "")),
     m_enableProduction(pset.get<bool>("EnableProduction", true)),
     m_enableDetectorGaps(pset.get<bool>("EnableLineGaps", true)),
     m_enableMCParticles(pset.get<bool>("EnableMCParticles", false)),
-    m_lineGapsCreated(false)
+    m_enableHitMCParticlesOnly(pset.get<bool>("EnableHitMCParticlesOnly", false)),
+    m_readoutGapsStale(true),
+    m_readoutGapsCreated(false),
+    m_readoutGapKey(0),
+    m_instrumentation(pset.get<bool>("EnableInstrumentation", false))
 {
     m_inputSettings.m_useHitWidths = pset.get<bool>("UseHitWidths", true);
     m_inputSettings.m_uidOffset = pset.get<int>("UidOffset", 100000000);
@@ -71,48 +91,150 @@ LArPandora::LArPandora(fhicl::ParameterSet const &pset) :
     m_inputSettings.m_dEdX_mip = pset.get<double>("dEdXmip", 2.);
     m_inputSettings.m_mips_to_gev = pset.get<double>("MipsToGeV", 3.5e-4);
     m_inputSettings.m_recombination_factor = pset.get<double>("RecombinationFactor", 0.63);
+    m_inputSettings.m_nThreads = LArPandoraParallel::GetNThreads(m_nThreads);
+    m_inputSettings.m_hitCoalescenceTimeGap = pset.get<double>("HitCoalescenceTimeGap", 0.);
+    m_inputSettings.m_hitCoalescenceMaxSpan = pset.get<double>("HitCoalescenceMaxSpan", 0.);
+    m_inputSettings.m_hitCoalescenceMaxHits = pset.get<unsigned int>("HitCoalescenceMaxHits", 0);
+    m_hitFilterSettings.m_enableHitFilter = pset.get<bool>("EnableHitFilter", false);
+    m_hitFilterSettings.m_minHitCharge = pset.get<double>("HitFilterMinCharge", m_hitFilterSettings.m_minHitCharge);
+    m_hitFilterSettings.m_minHitPeakTime = pset.get<double>("HitFilterMinPeakTime", m_hitFilterSettings.m_minHitPeakTime);
+    m_hitFilterSettings.m_maxHitPeakTime = pset.get<double>("HitFilterMaxPeakTime", m_hitFilterSettings.m_maxHitPeakTime);
+    m_hitFilterSettings.m_rejectNoisyChannels = pset.get<bool>("HitFilterRejectNoisyChannels", false);
+    m_hitFilterSettings.m_minNeighbourHits = pset.get<unsigned int>("HitFilterMinNeighbourHits", 0);
+    m_hitFilterSettings.m_neighbourWireWindow = pset.get<unsigned int>("HitFilterNeighbourWireWindow", m_hitFilterSettings.m_neighbourWireWindow);
+    m_hitFilterSettings.m_neighbourTimeWindow = pset.get<double>("HitFilterNeighbourTimeWindow", m_hitFilterSettings.m_neighbourTimeWindow);
     m_outputSettings.m_pProducer = this;
     m_outputSettings.m_shouldRunStitching = m_shouldRunStitching;
+    m_outputSettings.m_nThreads = m_inputSettings.m_nThreads;
+    m_outputSettings.m_outputTier = LArPandoraOutput::GetOutputTier(pset.get<std::string>("OutputTier", "full"));
+    m_outputSettings.m_shouldProduceCompactSpacePoints = pset.get<bool>("ShouldProduceCompactSpacePoints", false);
+    m_outputSettings.m_shouldProduceHitOwnership = pset.get<bool>("ShouldProduceHitOwnership", false);
+    m_outputSettings.m_shouldProduceParticleSummaries = pset.get<bool>("ShouldProduceParticleSummaries", false);
+    m_outputSettings.m_shouldProduceTracksAndShowers = pset.get<bool>("ShouldProduceTracksAndShowers", false);
+    m_outputSettings.m_minTrajectoryPoints = pset.get<unsigned int>("MinTrajectoryPoints", m_outputSettings.m_minTrajectoryPoints);
+    m_outputSettings.m_slidingFitHalfWindow = pset.get<unsigned int>("SlidingFitHalfWindow", m_outputSettings.m_slidingFitHalfWindow);
+    m_outputSettings.m_useAllParticles = pset.get<bool>("UseAllParticles", m_outputSettings.m_useAllParticles);
+    m_outputSettings.m_stitchingMaxDisplacement = pset.get<double>("DaughterStitchingMaxDisplacement", m_outputSettings.m_stitchingMaxDisplacement);
+    m_outputSettings.m_stitchingMinCosRelativeAngle = pset.get<double>("DaughterStitchingMinCosRelativeAngle", m_outputSettings.m_stitchingMinCosRelativeAngle);
+    m_outputSettings.m_stitchingMinHits = pset.get<unsigned int>("DaughterStitchingMinHits", m_outputSettings.m_stitchingMinHits);
+
+    if (m_outputSettings.m_minTrajectoryPoints < 2)
+        throw cet::exception("LArPandora") << " LArPandora::LArPandora - MinTrajectoryPoints should not be smaller than 2 " << std::endl;
+
+    if ((LArPandoraOutput::MinimalTier == m_outputSettings.m_outputTier) && m_outputSettings.m_shouldProduceCompactSpacePoints)
+        throw cet::exception("LArPandora") << " LArPandora::LArPandora - ShouldProduceCompactSpacePoints requires an OutputTier other than minimal " << std::endl;
+
+    // ATTN When running drift volumes in parallel, the daughter instance outputs are stitched by LArPandoraOutput, rather than by the LArMaster algorithm
+    if (m_shouldRunDriftVolumesInParallel && m_driftVolumeConfigFile.empty())
+        throw cet::exception("LArPandora") << " LArPandora::LArPandora - DriftVolumeConfigFile must be set when running drift volumes in parallel " << std::endl;
+
+    if (m_shouldProcessDriftVolumesConcurrently && !m_shouldRunDriftVolumesInParallel)
+        throw cet::exception("LArPandora") << " LArPandora::LArPandora - ShouldProcessDriftVolumesConcurrently requires ShouldRunDriftVolumesInParallel " << std::endl;
 
     if (m_enableProduction)
     {
         produces< std::vector<recob::PFParticle> >();
-        produces< std::vector<recob::SpacePoint> >();
         produces< std::vector<recob::Cluster> >();
         produces< std::vector<recob::Vertex> >();
 
-        produces< art::Assns<recob::PFParticle, recob::SpacePoint> >();
         produces< art::Assns<recob::PFParticle, recob::Cluster> >();
         produces< art::Assns<recob::PFParticle, recob::Vertex> >();
-        produces< art::Assns<recob::SpacePoint, recob::Hit> >();
         produces< art::Assns<recob::Cluster, recob::Hit> >();
 
+        if ((LArPandoraOutput::MinimalTier != m_outputSettings.m_outputTier) && m_outputSettings.m_shouldProduceCompactSpacePoints)
+        {
+            produces< LArCompactSpacePoints >();
+        }
+        else if (LArPandoraOutput::MinimalTier != m_outputSettings.m_outputTier)
+        {
+            produces< std::vector<recob::SpacePoint> >();
+            produces< art::Assns<recob::PFParticle, recob::SpacePoint> >();
+            produces< art::Assns<recob::SpacePoint, recob::Hit> >();
+        }
+
+        if (m_outputSettings.m_shouldProduceHitOwnership)
+        {
+            produces< LArHitOwnership >();
+        }
+
+        if (m_hitFilterSettings.m_enableHitFilter)
+        {
+            produces< LArRejectedHits >();
+        }
+
+        if (m_outputSettings.m_shouldProduceParticleSummaries)
+        {
+            produces< LArPFParticleSummaryVector >();
+        }
+
         if (m_outputSettings.m_shouldRunStitching)
         {
             produces< std::vector<anab::T0> >();
             produces< art::Assns<recob::PFParticle, anab::T0> >();
         }
+
+        if (m_outputSettings.m_shouldProduceTracksAndShowers)
+        {
+            produces< std::vector<recob::Track> >();
+            produces< std::vector<recob::Shower> >();
+            produces< std::vector<recob::PCAxis> >();
+
+            produces< art::Assns<recob::PFParticle, recob::Track> >();
+            produces< art::Assns<recob::Track, recob::Hit> >();
+            produces< art::Assns<recob::Track, recob::Hit, recob::TrackHitMeta> >();
+            produces< art::Assns<recob::PFParticle, recob::Shower> >();
+            produces< art::Assns<recob::PFParticle, recob::PCAxis> >();
+            produces< art::Assns<recob::Shower, recob::Hit> >();
+            produces< art::Assns<recob::Shower, recob::PCAxis> >();
+        }
     }
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
 void LArPandora::beginJob()
+{
+    this->InitializePandoraInstances();
+
+    m_tpcIndex.Build();
+    m_inputSettings.m_pTPCIndex = &m_tpcIndex;
+
+    m_instrumentation.BeginJob();
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void LArPandora::InitializePandoraInstances()
 {
     LArDriftVolumeList driftVolumeList;
+    m_driftVolumeMap.clear();
     LArPandoraGeometry::LoadGeometry(driftVolumeList, m_driftVolumeMap);
 
     this->CreatePandoraInstances();
 
     if (!m_pPrimaryPandora)
-        throw cet::exception("LArPandora") << " LArPandora::beginJob - failed to create primary Pandora instance " << std::endl;
+        throw cet::exception("LArPandora") << " LArPandora::InitializePandoraInstances - failed to create primary Pandora instance " << std::endl;
 
     m_inputSettings.m_pPrimaryPandora = m_pPrimaryPandora;
     m_outputSettings.m_pPrimaryPandora = m_pPrimaryPandora;
+    m_outputSettings.m_daughterPandoraInstances = m_daughterPandoraInstances;
 
     // Pass basic LArTPC information to pandora instances
     LArPandoraInput::CreatePandoraLArTPCs(m_inputSettings, driftVolumeList);
 
+    // Each daughter pandora instance receives only the LArTPC describing its own drift volume
+    for (const LArDriftVolume &driftVolume : driftVolumeList)
+    {
+        VolumeIdToPandoraMap::const_iterator daughterIter(m_daughterPandoraInstances.find(driftVolume.GetVolumeID()));
+
+        if (m_daughterPandoraInstances.end() == daughterIter)
+            continue;
+
+        LArPandoraInput::Settings daughterSettings(m_inputSettings);
+        daughterSettings.m_pPrimaryPandora = daughterIter->second;
+        LArPandoraInput::CreatePandoraLArTPCs(daughterSettings, LArDriftVolumeList(1, driftVolume));
+    }
+
     // If using global drift volume approach, pass details of gaps between daughter volumes to the pandora instance
     if (m_enableDetectorGaps)
     {
@@ -123,33 +245,80 @@ void LArPandora::beginJob()
 
     // Parse Pandora settings xml files
     this->ConfigurePandoraInstances();
+
+    // ATTN Wire coordinates use the transformation plugin, which is only initialized when the settings have been read
+    this->BuildGeometryTable();
+    m_inputSettings.m_pGeometryTable = &m_geometryTable;
+    m_outputSettings.m_pGeometryTable = &m_geometryTable;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void LArPandora::beginRun(art::Run &/*run*/)
+{
+    // Refresh the geometry table, as detector properties (e.g. tick offsets) may change between runs
+    this->BuildGeometryTable();
+    m_tpcIndex.Build();
+
+    // ATTN The channel status may change between runs, but is only updated for the first event of the run
+    m_readoutGapsStale = true;
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
 void LArPandora::produce(art::Event &evt)
 {
-    IdToHitMap idToHitMap;
-    this->CreatePandoraInput(evt, idToHitMap);
+    m_instrumentation.BeginEvent(evt);
+    LArHitRegistry hitRegistry;
+    m_instrumentation.StartStage(LArPandoraInstrumentation::InputStage);
+    this->CreatePandoraInput(evt, hitRegistry);
+    m_instrumentation.StopStage(LArPandoraInstrumentation::InputStage);
+
+    m_instrumentation.StartStage(LArPandoraInstrumentation::RunStage);
     this->RunPandoraInstances();
-    this->ProcessPandoraOutput(evt, idToHitMap);
+    m_instrumentation.StopStage(LArPandoraInstrumentation::RunStage);
+
+    m_instrumentation.StartStage(LArPandoraInstrumentation::OutputStage);
+    this->ProcessPandoraOutput(evt, hitRegistry);
+    m_instrumentation.StopStage(LArPandoraInstrumentation::OutputStage);
+
+    m_instrumentation.StartStage(LArPandoraInstrumentation::ResetStage);
     this->ResetPandoraInstances();
+    m_instrumentation.StopStage(LArPandoraInstrumentation::ResetStage);
+    m_instrumentation.EndEvent();
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void LArPandora::endJob()
+{
+    if (m_hitFilterSettings.m_enableHitFilter)
+    {
+        mf::LogInfo("LArPandora") << " LArPandora::endJob - hit filter rejected " << m_hitFilterStatistics.GetNRejectedHits() << " of "
+                                  << m_hitFilterStatistics.m_nInputHits << " hits (charge: " << m_hitFilterStatistics.m_nChargeRejected
+                                  << ", time: " << m_hitFilterStatistics.m_nTimeRejected << ", noisy channel: " << m_hitFilterStatistics.m_nNoisyChannelRejected
+                                  << ", isolation: " << m_hitFilterStatistics.m_nIsolationRejected << ")" << std::endl;
+    }
+
+    m_instrumentation.EndJob();
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
-void LArPandora::CreatePandoraInput(art::Event &evt, IdToHitMap &idToHitMap)
+void LArPandora::CreatePandoraInput(art::Event &evt, LArHitRegistry &hitRegistry)
 {
-    // ATTN Should complete gap creation in begin job callback, but channel status service functionality unavailable at that point
-    if (!m_lineGapsCreated && m_enableDetectorGaps)
+    // ATTN Should complete gap creation in begin run callback, but channel status service functionality unavailable at that point
+    if (m_readoutGapsStale && m_enableDetectorGaps)
     {
-        LArPandoraInput::CreatePandoraReadoutGaps(m_inputSettings, m_driftVolumeMap);
-        m_lineGapsCreated = true;
+        m_instrumentation.StartStage(LArPandoraInstrumentation::ReadoutGapsStage);
+        this->RefreshReadoutGaps();
+        m_readoutGapsStale = false;
+        m_instrumentation.StopStage(LArPandoraInstrumentation::ReadoutGapsStage);
     }
 
     HitVector artHits;
     SimChannelVector artSimChannels;
-    HitsToTrackIDEs artHitsToTrackIDEs;
+    LArHitTruthTable artHitTruthTable;
     MCParticleVector artMCParticleVector;
     RawMCParticleVector generatorArtMCParticleVector;
     MCTruthToMCParticles artMCTruthToMCParticles;
@@ -157,6 +326,48 @@ void LArPandora::CreatePandoraInput(art::Event &evt, IdToHitMap &idToHitMap)
 
     LArPandoraHelper::CollectHits(evt, m_hitfinderModuleLabel, artHits);
 
+    if (m_hitFilterSettings.m_enableHitFilter)
+    {
+        // ATTN Hits keep their keys in the input hit collection, so the truth table below, built for the selected hits only, is indexed consistently
+        m_instrumentation.StartStage(LArPandoraInstrumentation::HitFilterStage);
+        HitVector selectedArtHits, rejectedArtHits;
+        LArPandoraInput::HitFilterStatistics hitFilterStatistics;
+        LArPandoraInput::FilterHits(m_hitFilterSettings, artHits, selectedArtHits, rejectedArtHits, hitFilterStatistics);
+        m_hitFilterStatistics.Add(hitFilterStatistics);
+
+        if (m_enableProduction)
+        {
+            std::unique_ptr<LArRejectedHits> outputRejectedHits(new LArRejectedHits);
+
+            if (!artHits.empty())
+                outputRejectedHits->SetHitProductId(artHits.front().id());
+
+            std::vector<unsigned int> rejectedHitKeys;
+
+            for (const art::Ptr<recob::Hit> &hit : rejectedArtHits)
+                rejectedHitKeys.push_back(hit.key());
+
+            std::sort(rejectedHitKeys.begin(), rejectedHitKeys.end());
+
+            for (const unsigned int hitKey : rejectedHitKeys)
+                outputRejectedHits->AddHit(hitKey);
+
+            evt.put(std::move(outputRejectedHits));
+        }
+
+        artHits.swap(selectedArtHits);
+
+        m_instrumentation.StopStage(LArPandoraInstrumentation::HitFilterStage);
+
+        mf::LogDebug("LArPandora") << " LArPandora::CreatePandoraInput - hit filter rejected " << rejectedArtHits.size() << " of "
+                                   << hitFilterStatistics.m_nInputHits << " hits (charge: " << hitFilterStatistics.m_nChargeRejected
+                                   << ", time: " << hitFilterStatistics.m_nTimeRejected << ", noisy channel: " << hitFilterStatistics.m_nNoisyChannelRejected
+                                   << ", isolation: " << hitFilterStatistics.m_nIsolationRejected << ")" << std::endl;
+    }
+
+    // ATTN Coalescing hits bounds the cost of very busy events, so is only worthwhile above the configured number of hits
+    m_inputSettings.m_coalesceHits = ((m_hitCoalescenceThreshold > 0) && (artHits.size() > m_hitCoalescenceThreshold));
+
     if (m_enableMCParticles && !evt.isRealData())
     {
         LArPandoraHelper::CollectMCParticles(evt, m_geantModuleLabel, artMCParticleVector);
@@ -169,32 +380,187 @@ void LArPandora::CreatePandoraInput(art::Event &evt, IdToHitMap &idToHitMap)
         LArPandoraHelper::CollectSimChannels(evt, m_geantModuleLabel, artSimChannels);
         if (!artSimChannels.empty())
         {
-            LArPandoraHelper::BuildMCParticleHitMaps(artHits, artSimChannels, artHitsToTrackIDEs);
+            LArPandoraHelper::BuildHitTruthTable(artHits, artSimChannels, artHitTruthTable, m_inputSettings.m_nThreads);
         }
         else
         {
             if (m_backtrackerModuleLabel.empty())
               throw cet::exception("LArPandora") << " LArPandora::CreatePandoraInput - no sim channels found, backtracker module must be set in FHiCL " << std::endl;
 
-            LArPandoraHelper::BuildMCParticleHitMaps(evt, m_hitfinderModuleLabel, m_backtrackerModuleLabel, artHitsToTrackIDEs);
+            LArPandoraHelper::BuildHitTruthTable(evt, artHits, m_backtrackerModuleLabel, artHitTruthTable);
+        }
+
+        if (m_enableHitMCParticlesOnly)
+        {
+            MCTruthToMCParticles selectedMCTruthToMCParticles;
+            MCParticlesToMCTruth selectedMCParticlesToMCTruth;
+            LArPandoraInput::SelectMCParticlesWithHits(artHitTruthTable, artMCTruthToMCParticles, artMCParticlesToMCTruth,
+                selectedMCTruthToMCParticles, selectedMCParticlesToMCTruth);
+
+            artMCTruthToMCParticles.swap(selectedMCTruthToMCParticles);
+            artMCParticlesToMCTruth.swap(selectedMCParticlesToMCTruth);
         }
     }
 
-    LArPandoraInput::CreatePandoraHits2D(m_inputSettings, m_driftVolumeMap, artHits, idToHitMap);
+    if (!m_daughterPandoraInstances.empty())
+    {
+        this->CreateDaughterPandoraInput(artHits, artMCTruthToMCParticles, artMCParticlesToMCTruth, generatorArtMCParticleVector, artHitTruthTable,
+            m_enableMCParticles && !evt.isRealData(), hitRegistry);
+        return;
+    }
+
+    m_instrumentation.StartStage(LArPandoraInstrumentation::HitsStage);
+    LArPandoraInput::CreatePandoraHits2D(m_inputSettings, m_driftVolumeMap, artHits, hitRegistry);
+    m_instrumentation.StopStage(LArPandoraInstrumentation::HitsStage);
 
     if (m_enableMCParticles && !evt.isRealData())
     {
+        m_instrumentation.StartStage(LArPandoraInstrumentation::MCParticlesStage);
         LArPandoraInput::CreatePandoraMCParticles(m_inputSettings, artMCTruthToMCParticles, artMCParticlesToMCTruth, generatorArtMCParticleVector);
-        LArPandoraInput::CreatePandoraMCLinks2D(m_inputSettings, idToHitMap, artHitsToTrackIDEs);
+        m_instrumentation.StopStage(LArPandoraInstrumentation::MCParticlesStage);
+
+        m_instrumentation.StartStage(LArPandoraInstrumentation::MCLinksStage);
+        LArPandoraInput::CreatePandoraMCLinks2D(m_inputSettings, hitRegistry, artHitTruthTable);
+        m_instrumentation.StopStage(LArPandoraInstrumentation::MCLinksStage);
     }
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
-void LArPandora::ProcessPandoraOutput(art::Event &evt, const IdToHitMap &idToHitMap)
+void LArPandora::CreateDaughterPandoraInput(const HitVector &hitVector, const MCTruthToMCParticles &truthToParticles, const MCParticlesToMCTruth &particlesToTruth,
+    const RawMCParticleVector &generatorMCParticleVector, const LArHitTruthTable &hitTruthTable, const bool createMCInput, LArHitRegistry &hitRegistry)
 {
-    if (m_enableProduction)
-        LArPandoraOutput::ProduceArtOutput(m_outputSettings, idToHitMap, evt);
+    std::map<unsigned int, HitVector> volumeIdToHitVector;
+
+    for (const art::Ptr<recob::Hit> &hit : hitVector)
+    {
+        const geo::WireID hit_WireID(hit->WireID());
+        volumeIdToHitVector[LArPandoraGeometry::GetVolumeID(m_driftVolumeMap, hit_WireID.Cryostat, hit_WireID.TPC)].push_back(hit);
+    }
+
+    for (const VolumeIdToPandoraMap::value_type &daughterEntry : m_daughterPandoraInstances)
+    {
+        LArPandoraInput::Settings daughterSettings(m_inputSettings);
+        daughterSettings.m_pPrimaryPandora = daughterEntry.second;
+
+        // ATTN Hit ids continue from those already assigned, so remain unique across all daughter instances
+        const int lastHitId(hitRegistry.GetMaxId());
+        std::map<unsigned int, HitVector>::const_iterator hitIter(volumeIdToHitVector.find(daughterEntry.first));
+
+        m_instrumentation.StartStage(LArPandoraInstrumentation::HitsStage);
+
+        if (volumeIdToHitVector.end() != hitIter)
+            LArPandoraInput::CreatePandoraHits2D(daughterSettings, m_driftVolumeMap, hitIter->second, hitRegistry);
+
+        m_instrumentation.StopStage(LArPandoraInstrumentation::HitsStage);
+
+        if (createMCInput)
+        {
+            LArHitRegistry daughterHitRegistry;
+            std::vector<std::size_t> daughterHitKeys;
+
+            for (int hitId = lastHitId + 1; hitId <= hitRegistry.GetMaxId(); ++hitId)
+            {
+                if (!hitRegistry.HasHit(hitId))
+                    continue;
+
+                daughterHitRegistry.AddHits(hitId, hitRegistry.Begin(hitId), hitRegistry.End(hitId));
+
+                for (LArHitRegistry::HitPtrVector::const_iterator hitIter = hitRegistry.Begin(hitId); hitIter != hitRegistry.End(hitId); ++hitIter)
+                    daughterHitKeys.push_back(hitIter->key());
+            }
+
+            // Each daughter instance receives only the mc particles (with their ancestors) that deposit energy in its own hits
+            m_instrumentation.StartStage(LArPandoraInstrumentation::MCParticlesStage);
+            std::sort(daughterHitKeys.begin(), daughterHitKeys.end());
+            daughterHitKeys.erase(std::unique(daughterHitKeys.begin(), daughterHitKeys.end()), daughterHitKeys.end());
+
+            LArHitTruthTable daughterHitTruthTable;
+
+            for (const std::size_t hitKey : daughterHitKeys)
+                daughterHitTruthTable.AddHit(hitKey, hitTruthTable.Begin(hitKey), hitTruthTable.End(hitKey));
+
+            MCTruthToMCParticles daughterTruthToParticles;
+            MCParticlesToMCTruth daughterParticlesToTruth;
+            LArPandoraInput::SelectMCParticlesWithHits(daughterHitTruthTable, truthToParticles, particlesToTruth, daughterTruthToParticles, daughterParticlesToTruth);
+            LArPandoraInput::CreatePandoraMCParticles(daughterSettings, daughterTruthToParticles, daughterParticlesToTruth, generatorMCParticleVector);
+            m_instrumentation.StopStage(LArPandoraInstrumentation::MCParticlesStage);
+
+            m_instrumentation.StartStage(LArPandoraInstrumentation::MCLinksStage);
+            LArPandoraInput::CreatePandoraMCLinks2D(daughterSettings, daughterHitRegistry, hitTruthTable);
+            m_instrumentation.StopStage(LArPandoraInstrumentation::MCLinksStage);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void LArPandora::BuildGeometryTable()
+{
+    // ATTN When drift volumes run in parallel, the primary instance is never configured, so a daughter defines the wire coordinates
+    const pandora::Pandora *const pPandora(m_daughterPandoraInstances.empty() ? m_pPrimaryPandora : m_daughterPandoraInstances.begin()->second);
+    m_geometryTable.Build(m_driftVolumeMap, *pPandora);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void LArPandora::RefreshReadoutGaps()
+{
+    const std::uint64_t readoutGapKey(LArPandoraInput::GetReadoutGapKey(m_driftVolumeMap));
+
+    if (m_readoutGapsCreated && (readoutGapKey == m_readoutGapKey))
+        return;
+
+    // ATTN Pandora line gaps cannot be removed, so gaps created for a previous key are discarded along with the instances holding them
+    if (m_readoutGapsCreated)
+    {
+        mf::LogInfo("LArPandora") << " LArPandora::RefreshReadoutGaps - readout gap key changed, recreating the pandora instances " << std::endl;
+        this->DeletePandoraInstances();
+        this->InitializePandoraInstances();
+        m_readoutGaps.clear();
+    }
+
+    // ATTN As for the geometry table, a single configured instance defines the wire coordinates used for all instances
+    LArPandoraInput::Settings settings(m_inputSettings);
+    settings.m_pPrimaryPandora = m_daughterPandoraInstances.empty() ? m_pPrimaryPandora : m_daughterPandoraInstances.begin()->second;
+
+    LArPandoraInput::ReadoutGapList readoutGaps;
+
+    if (m_readoutGapCacheFile.empty() || !LArPandoraInput::ReadReadoutGaps(m_readoutGapCacheFile, readoutGapKey, readoutGaps))
+    {
+        LArPandoraInput::LoadReadoutGaps(settings, m_driftVolumeMap, readoutGaps);
+
+        if (!m_readoutGapCacheFile.empty())
+            LArPandoraInput::WriteReadoutGaps(m_readoutGapCacheFile, readoutGapKey, readoutGaps);
+    }
+
+    std::sort(readoutGaps.begin(), readoutGaps.end());
+    readoutGaps.erase(std::unique(readoutGaps.begin(), readoutGaps.end(),
+        [](const LArPandoraInput::ReadoutGap &lhs, const LArPandoraInput::ReadoutGap &rhs) { return !(lhs < rhs) && !(rhs < lhs); }), readoutGaps.end());
+
+    m_readoutGapsCreated = true;
+    m_readoutGapKey = readoutGapKey;
+    m_readoutGaps.swap(readoutGaps);
+
+    if (m_readoutGaps.empty())
+        return;
+
+    LArPandoraInput::CreatePandoraReadoutGaps(m_inputSettings, m_readoutGaps);
+
+    for (const VolumeIdToPandoraMap::value_type &daughterEntry : m_daughterPandoraInstances)
+    {
+        LArPandoraInput::Settings daughterSettings(m_inputSettings);
+        daughterSettings.m_pPrimaryPandora = daughterEntry.second;
+        LArPandoraInput::CreatePandoraReadoutGaps(daughterSettings, m_readoutGaps);
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void LArPandora::ProcessPandoraOutput(art::Event &evt, const LArHitRegistry &hitRegistry)
+{
+    const unsigned int nOutputParticles(m_enableProduction ? LArPandoraOutput::ProduceArtOutput(m_outputSettings, hitRegistry, evt) : 0);
+    m_instrumentation.SetEventSize(hitRegistry.GetNArtHits(), nOutputParticles);
 }
 
 } // namespace lar_pandora
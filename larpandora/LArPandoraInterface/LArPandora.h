@@ -12,7 +12,11 @@
 #include "larpandora/LArPandoraInterface/LArPandoraInput.h"
 #include "larpandora/LArPandoraInterface/LArPandoraOutput.h"
 #include "larpandora/LArPandoraInterface/LArPandoraGeometry.h"
+#include "larpandora/LArPandoraInterface/LArPandoraGeometryTable.h"
+#include "larpandora/LArPandoraInterface/LArPandoraInstrumentation.h"
+#include "larpandora/LArPandoraInterface/LArPandoraTPCIndex.h"
 
+#include <cstdint>
 #include <string>
 #include <memory> // std::unique_ptr<>
 
@@ -33,7 +37,9 @@ public:
     LArPandora(fhicl::ParameterSet const &pset);
 
     void beginJob();
+    void beginRun(art::Run &run);
     void produce(art::Event &evt);
+    void endJob();
 
 protected:
     std::string                     m_configFile;                   ///< The config file
@@ -47,24 +53,72 @@ protected:
     bool                            m_shouldPerformSliceId;         ///< Steering: whether to identify slices and select most appropriate pfos
     bool                            m_printOverallRecoStatus;       ///< Steering: whether to print current operation status messages
 
+    bool                            m_shouldRunDriftVolumesInParallel; ///< Whether to reconstruct each drift volume in its own daughter pandora instance
+    std::string                     m_driftVolumeConfigFile;        ///< The config file for the per-drift-volume daughter pandora instances
+    bool                            m_shouldProcessDriftVolumesConcurrently; ///< Whether the daughter pandora instances process each event concurrently, not in turn
+    unsigned int                    m_nThreads;                     ///< The number of threads for parallel stages, e.g. daughter instances and hit creation (default one; zero means one per core)
+    unsigned int                    m_hitCoalescenceThreshold;      ///< The number of hits above which overlapping hits on each wire are coalesced (zero disables)
+
+    LArDriftVolumeMap               m_driftVolumeMap;               ///< The map from volume id to drift volume
+
 private:        
-    void CreatePandoraInput(art::Event &evt, IdToHitMap &idToHitMap);
-    void ProcessPandoraOutput(art::Event &evt, const IdToHitMap &idToHitMap);
+    void CreatePandoraInput(art::Event &evt, LArHitRegistry &hitRegistry);
+    void ProcessPandoraOutput(art::Event &evt, const LArHitRegistry &hitRegistry);
+
+    /**
+     *  @brief  Build the geometry lookup table used for hit creation, from the current geometry and detector properties
+     */
+    void BuildGeometryTable();
+
+    /**
+     *  @brief  Create and configure the pandora instances, passing them the detector geometry, and build the geometry table
+     */
+    void InitializePandoraInstances();
+
+    /**
+     *  @brief  Create pandora line gaps for any bad channels, if the readout gap key has changed since the readout gaps were last created.
+     *          Pandora line gaps cannot be removed, so if the key changes the pandora instances are recreated before the gaps are created.
+     */
+    void RefreshReadoutGaps();
+
+    /**
+     *  @brief  Create pandora input hits, mc particles and mc links separately for each daughter pandora instance
+     *
+     *  @param  hitVector the input list of ART hits for this event
+     *  @param  truthToParticles mapping from MC truth to MC particles
+     *  @param  particlesToTruth mapping from MC particles to MC truth
+     *  @param  generatorMCParticleVector the generator MC particles
+     *  @param  hitTruthTable the true energy deposits of the ART hits, by hit key
+     *  @param  createMCInput whether to create mc particles and links
+     *  @param  hitRegistry to receive the populated registry of art hits, by pandora hit id
+     */
+    void CreateDaughterPandoraInput(const HitVector &hitVector, const MCTruthToMCParticles &truthToParticles, const MCParticlesToMCTruth &particlesToTruth,
+        const RawMCParticleVector &generatorMCParticleVector, const LArHitTruthTable &hitTruthTable, const bool createMCInput, LArHitRegistry &hitRegistry);
 
     std::string                     m_generatorModuleLabel;         ///< The generator module label
     std::string                     m_geantModuleLabel;             ///< The geant module label
     std::string                     m_hitfinderModuleLabel;         ///< The hit finder module label
     std::string                     m_backtrackerModuleLabel;       ///< The back tracker module label
+    std::string                     m_readoutGapCacheFile;          ///< The file in which to cache readout gaps between jobs (empty means no file cache)
 
     bool                            m_enableProduction;             ///< Whether to persist output products
     bool                            m_enableDetectorGaps;           ///< Whether to pass detector gap information to Pandora instances
     bool                            m_enableMCParticles;            ///< Whether to pass mc information to Pandora instances to aid development
-    bool                            m_lineGapsCreated;              ///< Book-keeping: whether line gap creation has been called
+    bool                            m_enableHitMCParticlesOnly;     ///< Whether to create only mc particles with hits (and their ancestors)
+    bool                            m_readoutGapsStale;             ///< Book-keeping: whether the readout gaps must be checked against the bad channel list
+    bool                            m_readoutGapsCreated;           ///< Book-keeping: whether readout gap creation has been called
+    std::uint64_t                   m_readoutGapKey;                ///< Book-keeping: the readout gap key for which the readout gaps were created
 
     LArPandoraInput::Settings       m_inputSettings;                ///< The lar pandora input settings
     LArPandoraOutput::Settings      m_outputSettings;               ///< The lar pandora output settings
+    LArPandoraInput::HitFilterSettings m_hitFilterSettings;         ///< The hit filter settings
+    LArPandoraInput::HitFilterStatistics m_hitFilterStatistics;     ///< The hit filter statistics, accumulated over the job
 
-    LArDriftVolumeMap               m_driftVolumeMap;               ///< The map from volume id to drift volume
+    LArPandoraGeometryTable         m_geometryTable;                ///< The precomputed per-plane and per-wire geometry lookup table
+    LArPandoraTPCIndex              m_tpcIndex;                     ///< The tpc bounding box index, for classifying mc trajectory points
+    LArPandoraInput::ReadoutGapList m_readoutGaps;                  ///< The readout gaps already created in the pandora instances
+
+    LArPandoraInstrumentation       m_instrumentation;              ///< The stage timing and memory instrumentation
 };
 
 } // namespace lar_pandora
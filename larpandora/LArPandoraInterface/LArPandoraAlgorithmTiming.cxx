@@ -0,0 +1,199 @@
+/**
+ *  @file   larpandora/LArPandoraInterface/LArPandoraAlgorithmTiming.cxx
+ *
+ *  @brief  Per-algorithm wall time accounting for the algorithms run by pandora instances
+ */
+
+#include "art/Framework/Services/Optional/TFileService.h"
+#include "art/Framework/Services/Registry/ServiceHandle.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+#include "TH1D.h"
+
+#include "Api/PandoraApi.h"
+#include "Api/PandoraContentApi.h"
+#include "Xml/tinyxml.h"
+
+#include "larpandora/LArPandoraInterface/LArPandoraAlgorithmTiming.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+namespace lar_pandora
+{
+
+LArPandoraAlgorithmTiming::LArPandoraAlgorithmTiming(const bool isEnabled, const double maxTime) :
+    m_isEnabled(isEnabled),
+    m_maxTime(maxTime)
+{
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void LArPandoraAlgorithmTiming::Register(const pandora::Pandora &pandora)
+{
+    PANDORA_THROW_RESULT_IF(pandora::STATUS_CODE_SUCCESS, !=, PandoraApi::RegisterAlgorithmFactory(pandora, "LArPandoraTiming",
+        new LArPandoraTimingAlgorithm::Factory(this)));
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void LArPandoraAlgorithmTiming::BeginEvent()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_eventTimeMap.clear();
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void LArPandoraAlgorithmTiming::AddTime(const std::string &name, const double wallTime)
+{
+    if (!m_isEnabled)
+        return;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Timing &timing(m_timingMap[name]);
+    ++timing.m_nCalls;
+    timing.m_totalTime += wallTime;
+    timing.m_maxTime = std::max(timing.m_maxTime, wallTime);
+    m_eventTimeMap[name] += wallTime;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void LArPandoraAlgorithmTiming::EndEvent()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_eventTimeMap.empty())
+        return;
+
+    art::ServiceHandle<art::TFileService> tfs;
+
+    for (const TimeMap::value_type &timeEntry : m_eventTimeMap)
+    {
+        TH1D *&pHistogram(m_histogramMap[timeEntry.first]);
+
+        if (!pHistogram)
+        {
+            pHistogram = tfs->make<TH1D>(("algorithmTime_" + timeEntry.first).c_str(),
+                (timeEntry.first + " wall time per event;time [s];events").c_str(), 1000, 0., m_maxTime);
+        }
+
+        pHistogram->Fill(timeEntry.second);
+    }
+
+    m_eventTimeMap.clear();
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void LArPandoraAlgorithmTiming::Report() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_timingMap.empty())
+        return;
+
+    std::vector<TimingMap::const_iterator> timingIters;
+
+    for (TimingMap::const_iterator iter = m_timingMap.begin(), iterEnd = m_timingMap.end(); iter != iterEnd; ++iter)
+        timingIters.push_back(iter);
+
+    std::sort(timingIters.begin(), timingIters.end(), [](const TimingMap::const_iterator &lhs, const TimingMap::const_iterator &rhs)
+    {
+        if (lhs->second.m_totalTime != rhs->second.m_totalTime)
+            return (lhs->second.m_totalTime > rhs->second.m_totalTime);
+
+        return (lhs->first < rhs->first);
+    });
+
+    std::ostringstream summary;
+    summary << " *** LArPandoraAlgorithmTiming summary *** " << std::endl
+            << std::setw(40) << "Algorithm" << std::setw(12) << "Calls" << std::setw(16) << "TotalWall[s]" << std::setw(16) << "MeanWall[s]"
+            << std::setw(16) << "MaxWall[s]" << std::endl;
+
+    for (const TimingMap::const_iterator &iter : timingIters)
+    {
+        const Timing &timing(iter->second);
+        summary << std::setw(40) << iter->first
+                << std::setw(12) << timing.m_nCalls
+                << std::setw(16) << timing.m_totalTime
+                << std::setw(16) << (timing.m_nCalls > 0 ? timing.m_totalTime / timing.m_nCalls : 0.)
+                << std::setw(16) << timing.m_maxTime << std::endl;
+    }
+
+    mf::LogInfo("LArPandora") << summary.str();
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+LArPandoraAlgorithmTiming::Timing::Timing() :
+    m_nCalls(0),
+    m_totalTime(0.),
+    m_maxTime(0.)
+{
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+LArPandoraTimingAlgorithm::Factory::Factory(LArPandoraAlgorithmTiming *const pAlgorithmTiming) :
+    m_pAlgorithmTiming(pAlgorithmTiming)
+{
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+pandora::Algorithm *LArPandoraTimingAlgorithm::Factory::CreateAlgorithm() const
+{
+    return new LArPandoraTimingAlgorithm(m_pAlgorithmTiming);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+LArPandoraTimingAlgorithm::LArPandoraTimingAlgorithm(LArPandoraAlgorithmTiming *const pAlgorithmTiming) :
+    m_pAlgorithmTiming(pAlgorithmTiming)
+{
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+pandora::StatusCode LArPandoraTimingAlgorithm::Run()
+{
+    for (unsigned int index = 0; index < m_algorithmNames.size(); ++index)
+    {
+        const std::chrono::steady_clock::time_point startTime(std::chrono::steady_clock::now());
+        const pandora::StatusCode statusCode(PandoraContentApi::RunDaughterAlgorithm(*this, m_algorithmNames.at(index)));
+        m_pAlgorithmTiming->AddTime(m_algorithmTypes.at(index), std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count());
+
+        if (pandora::STATUS_CODE_SUCCESS != statusCode)
+            return statusCode;
+    }
+
+    return pandora::STATUS_CODE_SUCCESS;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+pandora::StatusCode LArPandoraTimingAlgorithm::ReadSettings(const pandora::TiXmlHandle xmlHandle)
+{
+    for (pandora::TiXmlElement *pXmlElement = xmlHandle.FirstChild("algorithm").Element(); nullptr != pXmlElement;
+        pXmlElement = pXmlElement->NextSiblingElement("algorithm"))
+    {
+        const char *const pAlgorithmType(pXmlElement->Attribute("type"));
+        std::string algorithmName;
+        PANDORA_RETURN_RESULT_IF(pandora::STATUS_CODE_SUCCESS, !=, PandoraContentApi::CreateDaughterAlgorithm(*this, pXmlElement, algorithmName));
+
+        m_algorithmNames.push_back(algorithmName);
+        m_algorithmTypes.push_back(pAlgorithmType ? std::string(pAlgorithmType) : algorithmName);
+    }
+
+    return pandora::STATUS_CODE_SUCCESS;
+}
+
+} // namespace lar_pandora
@@ -0,0 +1,149 @@
+/**
+ *  @file   larpandora/LArPandoraInterface/LArPandoraAlgorithmTiming.h
+ *
+ *  @brief  Per-algorithm wall time accounting for the algorithms run by pandora instances
+ */
+
+#ifndef LAR_PANDORA_ALGORITHM_TIMING_H
+#define LAR_PANDORA_ALGORITHM_TIMING_H 1
+
+#include "Pandora/Algorithm.h"
+
+#include <map>
+#include <mutex>
+#include <string>
+
+class TH1D;
+
+namespace lar_pandora
+{
+
+/**
+ *  @brief  LArPandoraAlgorithmTiming class
+ *
+ *  Pandora has no hook around the running of an algorithm, so timing is provided by a delegating algorithm, registered as
+ *  "LArPandoraTiming", which creates the algorithms nested within its own xml element as daughters and times each call to them.
+ *  Algorithms are timed by wrapping them in this way in the settings file, e.g. wrapping LArMaster times the whole master chain.
+ *  The worker instances created by LArMaster register only lar content, so the algorithms they run cannot be wrapped and are
+ *  included in the time of LArMaster; timing within the workers needs a registration hook in larpandoracontent. Algorithm tools
+ *  are called directly by their parent algorithms, so their time is included in that of the parent.
+ *
+ *  Times may also be added directly, e.g. for the ProcessEvent call of each pandora instance. The time for each name is summed
+ *  over each event and filled into its own histogram, booked via the TFileService when the name is first seen.
+ */
+class LArPandoraAlgorithmTiming
+{
+public:
+    /**
+     *  @brief  Constructor
+     *
+     *  @param  isEnabled whether to record times
+     *  @param  maxTime the upper edge of the per-event time histograms, in seconds
+     */
+    LArPandoraAlgorithmTiming(const bool isEnabled, const double maxTime);
+
+    /**
+     *  @brief  Register the timing algorithm with a pandora instance, reporting to this accumulator
+     *
+     *  @param  pandora the pandora instance
+     */
+    void Register(const pandora::Pandora &pandora);
+
+    /**
+     *  @brief  Clear the times recorded for the current event
+     */
+    void BeginEvent();
+
+    /**
+     *  @brief  Add a call to an algorithm (thread-safe, as daughter instances may run concurrently)
+     *
+     *  @param  name the algorithm type, or other name under which to record the time
+     *  @param  wallTime the wall time taken, in seconds
+     */
+    void AddTime(const std::string &name, const double wallTime);
+
+    /**
+     *  @brief  Fill the per-event time histograms, on the module thread
+     */
+    void EndEvent();
+
+    /**
+     *  @brief  Report the accumulated times, sorted by decreasing total time
+     */
+    void Report() const;
+
+private:
+    /**
+     *  @brief  Timing class, the accumulated time for one algorithm type
+     */
+    class Timing
+    {
+    public:
+        /**
+         *  @brief  Default constructor
+         */
+        Timing();
+
+        unsigned int    m_nCalls;           ///< The number of calls
+        double          m_totalTime;        ///< The total wall time, in seconds
+        double          m_maxTime;          ///< The maximum wall time for a single call, in seconds
+    };
+
+    typedef std::map<std::string, Timing> TimingMap;
+    typedef std::map<std::string, double> TimeMap;
+    typedef std::map<std::string, TH1D*> HistogramMap;
+
+    const bool          m_isEnabled;        ///< Whether to record times
+    const double        m_maxTime;          ///< The upper edge of the per-event time histograms, in seconds
+    TimingMap           m_timingMap;        ///< The accumulated time for each name, over the job
+    TimeMap             m_eventTimeMap;     ///< The summed time for each name in the current event
+    HistogramMap        m_histogramMap;     ///< The per-event time histogram for each name
+    mutable std::mutex  m_mutex;            ///< The mutex guarding the accumulated times
+};
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+/**
+ *  @brief  LArPandoraTimingAlgorithm class, runs its daughter algorithms in turn and records the time taken by each
+ */
+class LArPandoraTimingAlgorithm : public pandora::Algorithm
+{
+public:
+    /**
+     *  @brief  Factory class for instantiating algorithm
+     */
+    class Factory : public pandora::AlgorithmFactory
+    {
+    public:
+        /**
+         *  @brief  Constructor
+         *
+         *  @param  pAlgorithmTiming the address of the accumulator to which times are reported
+         */
+        Factory(LArPandoraAlgorithmTiming *const pAlgorithmTiming);
+
+        pandora::Algorithm *CreateAlgorithm() const;
+
+    private:
+        LArPandoraAlgorithmTiming *const    m_pAlgorithmTiming;     ///< The address of the accumulator
+    };
+
+    /**
+     *  @brief  Constructor
+     *
+     *  @param  pAlgorithmTiming the address of the accumulator to which times are reported
+     */
+    LArPandoraTimingAlgorithm(LArPandoraAlgorithmTiming *const pAlgorithmTiming);
+
+private:
+    pandora::StatusCode Run();
+    pandora::StatusCode ReadSettings(const pandora::TiXmlHandle xmlHandle);
+
+    LArPandoraAlgorithmTiming *const    m_pAlgorithmTiming;         ///< The address of the accumulator
+    pandora::StringVector               m_algorithmNames;           ///< The names of the daughter algorithm instances
+    pandora::StringVector               m_algorithmTypes;           ///< The types of the daughter algorithms
+};
+
+} // namespace lar_pandora
+
+#endif // #ifndef LAR_PANDORA_ALGORITHM_TIMING_H
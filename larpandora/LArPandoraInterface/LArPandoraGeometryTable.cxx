@@ -0,0 +1,163 @@
+/**
+ *  @file   larpandora/LArPandoraInterface/LArPandoraGeometryTable.cxx
+ *
+ *  @brief  Precomputed per-plane and per-wire geometry lookup table, for fast conversion of hits to pandora coordinates
+ */
+
+#include "cetlib/exception.h"
+
+#include "larcore/Geometry/Geometry.h"
+#include "larcorealg/Geometry/CryostatGeo.h"
+#include "larcorealg/Geometry/TPCGeo.h"
+#include "larcorealg/Geometry/PlaneGeo.h"
+#include "larcorealg/Geometry/WireGeo.h"
+
+#include "lardata/DetectorInfoServices/DetectorPropertiesService.h"
+
+#include "Api/PandoraApi.h"
+#include "Managers/PluginManager.h"
+#include "Plugins/LArTransformationPlugin.h"
+
+#include "larpandora/LArPandoraInterface/LArPandoraGeometryTable.h"
+
+namespace lar_pandora
+{
+
+unsigned int LArPlaneGeometry::GetVolumeId() const
+{
+    if (!m_hasVolumeId)
+        throw cet::exception("LArPandora") << " LArPandoraGeometry::GetVolumeID --- found a TPC that doesn't belong to a drift volume";
+
+    return m_volumeId;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+geo::View_t LArPlaneGeometry::GetGlobalView() const
+{
+    if (geo::kUnknown == m_globalView)
+        throw cet::exception("LArPandora") << " LArPandoraGeometry::GetGlobalView --- found an unknown plane view (not U, V or W) ";
+
+    return m_globalView;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+LArPandoraGeometryTable::LArPandoraGeometryTable()
+{
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void LArPandoraGeometryTable::Build(const LArDriftVolumeMap &driftVolumeMap, const pandora::Pandora &pandora)
+{
+    m_cryostatTpcOffsets.clear();
+    m_tpcPlaneOffsets.clear();
+    m_planes.clear();
+    m_wireCoordinates.clear();
+
+    art::ServiceHandle<geo::Geometry> theGeometry;
+    auto const* theDetector = lar::providerFrom<detinfo::DetectorPropertiesService>();
+    const pandora::LArTransformationPlugin *const pTransformationPlugin(pandora.GetPlugins()->GetLArTransformationPlugin());
+
+    // The ingredients for the T0 calculation, which are the same for every plane apart from the drift direction
+    const double cm_per_tick(theDetector->GetXTicksCoefficient());
+    const double ns_per_tick(theDetector->SamplingRate());
+
+    for (unsigned int icstat = 0; icstat < theGeometry->Ncryostats(); ++icstat)
+    {
+        m_cryostatTpcOffsets.push_back(m_tpcPlaneOffsets.size());
+        const geo::CryostatGeo &cryostat(theGeometry->Cryostat(icstat));
+
+        for (unsigned int itpc = 0; itpc < cryostat.NTPC(); ++itpc)
+        {
+            m_tpcPlaneOffsets.push_back(m_planes.size());
+            const geo::TPCGeo &tpc(cryostat.TPC(itpc));
+            const double dir((tpc.DriftDirection() == geo::kNegX) ? 1.0 : -1.0);
+
+            // ATTN A tpc outside the drift volume map is only an error if it has hits, so record this rather than throwing here
+            bool hasVolumeId(false);
+            unsigned int volumeId(0);
+
+            try
+            {
+                volumeId = LArPandoraGeometry::GetVolumeID(driftVolumeMap, icstat, itpc);
+                hasVolumeId = true;
+            }
+            catch (const cet::exception &)
+            {
+            }
+
+            for (unsigned int iplane = 0; iplane < tpc.Nplanes(); ++iplane)
+            {
+                const geo::PlaneGeo &plane(tpc.Plane(iplane));
+                const geo::View_t view(plane.View());
+                const bool isKnownView((geo::kU == view) || (geo::kV == view) || (geo::kW == view));
+                const geo::View_t globalView(isKnownView ? LArPandoraGeometry::GetGlobalView(icstat, itpc, view) : geo::kUnknown);
+
+                m_planes.push_back(LArPlaneGeometry(hasVolumeId, volumeId, globalView, isKnownView ? theGeometry->WirePitch(view) : 0.,
+                    theDetector->GetXTicksOffset(iplane, itpc, icstat), theDetector->GetXTicksCoefficient(itpc, icstat), - dir * ns_per_tick / cm_per_tick,
+                    m_wireCoordinates.size(), plane.Nwires()));
+
+                for (unsigned int iwire = 0; iwire < plane.Nwires(); ++iwire)
+                {
+                    double xyz[3];
+                    plane.Wire(iwire).GetCenter(xyz);
+
+                    if (geo::kW == globalView)
+                    {
+                        m_wireCoordinates.push_back(xyz[2]);
+                    }
+                    else if (geo::kU == globalView)
+                    {
+                        m_wireCoordinates.push_back(pTransformationPlugin->YZtoU(xyz[1], xyz[2]));
+                    }
+                    else if (geo::kV == globalView)
+                    {
+                        m_wireCoordinates.push_back(pTransformationPlugin->YZtoV(xyz[1], xyz[2]));
+                    }
+                    else
+                    {
+                        m_wireCoordinates.push_back(0.);
+                    }
+                }
+            }
+        }
+    }
+
+    m_cryostatTpcOffsets.push_back(m_tpcPlaneOffsets.size());
+    m_tpcPlaneOffsets.push_back(m_planes.size());
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+const LArPlaneGeometry &LArPandoraGeometryTable::GetPlane(const geo::WireID &wireID) const
+{
+    if (wireID.Cryostat + 1 >= m_cryostatTpcOffsets.size())
+        throw cet::exception("LArPandora") << " LArPandoraGeometryTable::GetPlane --- cryostat " << wireID.Cryostat << " is not in the geometry table ";
+
+    const unsigned int tpcIndex(m_cryostatTpcOffsets[wireID.Cryostat] + wireID.TPC);
+
+    if (tpcIndex >= m_cryostatTpcOffsets[wireID.Cryostat + 1])
+        throw cet::exception("LArPandora") << " LArPandoraGeometryTable::GetPlane --- tpc " << wireID.TPC << " is not in the geometry table ";
+
+    const unsigned int planeIndex(m_tpcPlaneOffsets[tpcIndex] + wireID.Plane);
+
+    if (planeIndex >= m_tpcPlaneOffsets[tpcIndex + 1])
+        throw cet::exception("LArPandora") << " LArPandoraGeometryTable::GetPlane --- plane " << wireID.Plane << " is not in the geometry table ";
+
+    return m_planes[planeIndex];
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+double LArPandoraGeometryTable::GetWireCoordinate(const LArPlaneGeometry &plane, const unsigned int wire) const
+{
+    if (wire >= plane.GetNWires())
+        throw cet::exception("LArPandora") << " LArPandoraGeometryTable::GetWireCoordinate --- wire " << wire << " is not in the geometry table ";
+
+    return m_wireCoordinates[plane.GetFirstWireIndex() + wire];
+}
+
+} // namespace lar_pandora
@@ -0,0 +1,217 @@
+/**
+ *  @file   larpandora/LArPandoraInterface/LArPandoraGeometryTable.h
+ *
+ *  @brief  Precomputed per-plane and per-wire geometry lookup table, for fast conversion of hits to pandora coordinates
+ */
+
+#ifndef LAR_PANDORA_GEOMETRY_TABLE_H
+#define LAR_PANDORA_GEOMETRY_TABLE_H 1
+
+#include "larcoreobj/SimpleTypesAndConstants/geo_types.h"
+
+#include "larpandora/LArPandoraInterface/LArPandoraGeometry.h"
+
+#include <vector>
+
+namespace pandora {class Pandora;}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+namespace lar_pandora
+{
+
+/**
+ *  @brief  LArPlaneGeometry class, holding the properties of a single readout plane
+ */
+class LArPlaneGeometry
+{
+public:
+    /**
+     *  @brief  Constructor
+     *
+     *  @param  hasVolumeId whether the plane belongs to a drift volume
+     *  @param  volumeId the drift volume id
+     *  @param  globalView the view in the pandora global coordinate system (geo::kUnknown if not U, V or W)
+     *  @param  wirePitch the wire pitch, in cm
+     *  @param  xTicksOffset the tick offset for the linear tick to x conversion
+     *  @param  xTicksCoefficient the cm per tick for the linear tick to x conversion
+     *  @param  t0Coefficient the ns per cm for the conversion of an x shift, along the drift direction of the tpc, to a T0
+     *  @param  firstWireIndex the index of the first wire of this plane in the table wire coordinate array
+     *  @param  nWires the number of wires in this plane
+     */
+    LArPlaneGeometry(const bool hasVolumeId, const unsigned int volumeId, const geo::View_t globalView, const double wirePitch,
+        const double xTicksOffset, const double xTicksCoefficient, const double t0Coefficient, const unsigned int firstWireIndex, const unsigned int nWires);
+
+    /**
+     *  @brief  Return the drift volume id, throwing if the plane does not belong to a drift volume
+     */
+    unsigned int GetVolumeId() const;
+
+    /**
+     *  @brief  Return the view in the pandora global coordinate system, throwing if the view is not U, V or W
+     */
+    geo::View_t GetGlobalView() const;
+
+    /**
+     *  @brief  Return the wire pitch, in cm
+     */
+    double GetWirePitch() const;
+
+    /**
+     *  @brief  Convert a time in ticks to an x coordinate, identical to DetectorProperties::ConvertTicksToX for this plane
+     *
+     *  @param  ticks the time in ticks
+     *
+     *  @return the x coordinate, in cm
+     */
+    double ConvertTicksToX(const double ticks) const;
+
+    /**
+     *  @brief  Convert a shift in x position of a hit on this plane into a T0, identical to the calculation in LArPandoraOutput::CalculateT0
+     *
+     *  @param  xShift the shift in x position, in cm
+     *
+     *  @return the T0, in nanoseconds
+     */
+    double ConvertXShiftToT0(const double xShift) const;
+
+    /**
+     *  @brief  Return the index of the first wire of this plane in the table wire coordinate array
+     */
+    unsigned int GetFirstWireIndex() const;
+
+    /**
+     *  @brief  Return the number of wires in this plane
+     */
+    unsigned int GetNWires() const;
+
+private:
+    bool            m_hasVolumeId;          ///< Whether the plane belongs to a drift volume
+    unsigned int    m_volumeId;             ///< The drift volume id
+    geo::View_t     m_globalView;           ///< The view in the pandora global coordinate system
+    double          m_wirePitch;            ///< The wire pitch, in cm
+    double          m_xTicksOffset;         ///< The tick offset for the linear tick to x conversion
+    double          m_xTicksCoefficient;    ///< The cm per tick for the linear tick to x conversion
+    double          m_t0Coefficient;        ///< The ns per cm for the conversion of an x shift to a T0
+    unsigned int    m_firstWireIndex;       ///< The index of the first wire of this plane in the table wire coordinate array
+    unsigned int    m_nWires;               ///< The number of wires in this plane
+};
+
+typedef std::vector<LArPlaneGeometry> LArPlaneGeometryList;
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+/**
+ *  @brief  LArPandoraGeometryTable class
+ */
+class LArPandoraGeometryTable
+{
+public:
+    /**
+     *  @brief  Default constructor
+     */
+    LArPandoraGeometryTable();
+
+    /**
+     *  @brief  Build (or rebuild) the table from the current geometry and detector properties
+     *
+     *  @param  driftVolumeMap the mapping from cryostat/tpc to drift volume
+     *  @param  pandora the pandora instance whose transformation plugin defines the U and V wire coordinates
+     */
+    void Build(const LArDriftVolumeMap &driftVolumeMap, const pandora::Pandora &pandora);
+
+    /**
+     *  @brief  Whether the table has been built
+     */
+    bool IsBuilt() const;
+
+    /**
+     *  @brief  Get the plane properties for a given wire id
+     *
+     *  @param  wireID the wire id
+     *
+     *  @return the plane properties
+     */
+    const LArPlaneGeometry &GetPlane(const geo::WireID &wireID) const;
+
+    /**
+     *  @brief  Get the pandora wire coordinate (U, V or W, in the global view of the plane) of the centre of a wire
+     *
+     *  @param  plane the plane properties
+     *  @param  wire the wire number within the plane
+     *
+     *  @return the wire coordinate, in cm
+     */
+    double GetWireCoordinate(const LArPlaneGeometry &plane, const unsigned int wire) const;
+
+private:
+    std::vector<unsigned int>   m_cryostatTpcOffsets;   ///< The index of the first tpc of each cryostat, with a final entry for the total
+    std::vector<unsigned int>   m_tpcPlaneOffsets;      ///< The index of the first plane of each tpc, with a final entry for the total
+    LArPlaneGeometryList        m_planes;               ///< The properties of each plane
+    std::vector<double>         m_wireCoordinates;      ///< The pandora wire coordinate of each wire centre, contiguous per plane
+};
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline LArPlaneGeometry::LArPlaneGeometry(const bool hasVolumeId, const unsigned int volumeId, const geo::View_t globalView, const double wirePitch,
+        const double xTicksOffset, const double xTicksCoefficient, const double t0Coefficient, const unsigned int firstWireIndex, const unsigned int nWires) :
+    m_hasVolumeId(hasVolumeId),
+    m_volumeId(volumeId),
+    m_globalView(globalView),
+    m_wirePitch(wirePitch),
+    m_xTicksOffset(xTicksOffset),
+    m_xTicksCoefficient(xTicksCoefficient),
+    m_t0Coefficient(t0Coefficient),
+    m_firstWireIndex(firstWireIndex),
+    m_nWires(nWires)
+{
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline double LArPlaneGeometry::GetWirePitch() const
+{
+    return m_wirePitch;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline double LArPlaneGeometry::ConvertTicksToX(const double ticks) const
+{
+    return ((ticks - m_xTicksOffset) * m_xTicksCoefficient);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline double LArPlaneGeometry::ConvertXShiftToT0(const double xShift) const
+{
+    return (xShift * m_t0Coefficient);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline unsigned int LArPlaneGeometry::GetFirstWireIndex() const
+{
+    return m_firstWireIndex;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline unsigned int LArPlaneGeometry::GetNWires() const
+{
+    return m_nWires;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline bool LArPandoraGeometryTable::IsBuilt() const
+{
+    return !m_planes.empty();
+}
+
+} // namespace lar_pandora
+
+#endif // #ifndef LAR_PANDORA_GEOMETRY_TABLE_H
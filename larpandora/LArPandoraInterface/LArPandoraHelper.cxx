@@ -34,10 +34,17 @@
 #include "Pandora/PdgTable.h"
 #include "Pandora/PandoraInternal.h"
 
+#include "larpandora/LArPandoraObjects/LArCompactSpacePoints.h"
+#include "larpandora/LArPandoraObjects/LArHitOwnership.h"
+#include "larpandora/LArPandoraObjects/LArPFParticleSummary.h"
+
 #include "larpandora/LArPandoraInterface/LArPandoraHelper.h"
+#include "larpandora/LArPandoraInterface/LArPandoraParallel.h"
 
+#include <algorithm>
 #include <limits>
 #include <iostream>
+#include <unordered_map>
 
 namespace lar_pandora
 {
@@ -618,6 +625,54 @@ void LArPandoraHelper::BuildPFParticleHitMaps(const art::Event &evt, const std::
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
+bool LArPandoraHelper::BuildPFParticleHitMapsFromHitOwnership(const art::Event &evt, const std::string &label, PFParticlesToHits &particlesToHits,
+    HitsToPFParticles &hitsToParticles, const DaughterMode daughterMode)
+{
+    art::Handle< LArHitOwnership > theHitOwnership;
+    evt.getByLabel(label, theHitOwnership);
+
+    if (!theHitOwnership.isValid())
+    {
+        mf::LogDebug("LArPandora") << "  Failed to find hit ownership... " << std::endl;
+        return false;
+    }
+
+    art::Handle< std::vector<recob::PFParticle> > theParticles;
+    evt.getByLabel(label, theParticles);
+
+    if (!theParticles.isValid() || (theParticles->size() != theHitOwnership->GetNPFParticles()))
+        throw cet::exception("LArPandora") << " LArPandoraHelper::BuildPFParticleHitMapsFromHitOwnership --- hit ownership does not match the PFParticles ";
+
+    const art::ProductID &hitProductId(theHitOwnership->GetHitProductId());
+    const art::EDProductGetter *const pProductGetter(evt.productGetter(hitProductId));
+    const unsigned int nHitKeys(theHitOwnership->GetPFParticleIndices().size());
+
+    for (unsigned int hitKey = 0; hitKey < nHitKeys; ++hitKey)
+    {
+        const unsigned int pfParticleIndex(theHitOwnership->GetPFParticleIndex(hitKey));
+
+        if (LArHitOwnership::InvalidIndex == pfParticleIndex)
+            continue;
+
+        // ATTN As in the cluster-based maps, daughters are absorbed into their final-state parent, or ignored, according to the daughter mode
+        const unsigned int finalStateIndex(theHitOwnership->GetFinalStatePFParticleIndex(hitKey));
+        const art::Ptr<recob::PFParticle> thisParticle(theParticles, pfParticleIndex);
+
+        if ((kIgnoreDaughters == daughterMode) && ((finalStateIndex != pfParticleIndex) || LArPandoraHelper::IsNeutrino(thisParticle)))
+            continue;
+
+        const art::Ptr<recob::PFParticle> particle((kAddDaughters == daughterMode) ? art::Ptr<recob::PFParticle>(theParticles, finalStateIndex) :
+            thisParticle);
+        const art::Ptr<recob::Hit> hit(hitProductId, hitKey, pProductGetter);
+        particlesToHits[particle].push_back(hit);
+        hitsToParticles[hit] = particle;
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
 void LArPandoraHelper::SelectNeutrinoPFParticles(const PFParticleVector &inputParticles, PFParticleVector &outputParticles)
 {
     for (PFParticleVector::const_iterator iter = inputParticles.begin(), iterEnd = inputParticles.end(); iter != iterEnd; ++iter)
@@ -820,24 +875,78 @@ void LArPandoraHelper::CollectMCParticles(const art::Event &evt, const std::stri
 
 
 void LArPandoraHelper::BuildMCParticleHitMaps(const HitVector &hitVector, const SimChannelVector &simChannelVector,
-    HitsToTrackIDEs &hitsToTrackIDEs)
+    HitsToTrackIDEs &hitsToTrackIDEs, const unsigned int nThreads)
+{
+    LArHitTruthTable hitTruthTable;
+    LArPandoraHelper::BuildHitTruthTable(hitVector, simChannelVector, hitTruthTable, nThreads);
+    LArPandoraHelper::BuildMCParticleHitMaps(hitVector, hitTruthTable, hitsToTrackIDEs);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void LArPandoraHelper::BuildMCParticleHitMaps(const HitVector &hitVector, const SimChannelVector &simChannelVector,
+    HitIndexToTrackIDEs &hitIndexToTrackIDEs, const unsigned int nThreads)
+{
+    LArHitTruthTable hitTruthTable;
+    LArPandoraHelper::BuildHitTruthTable(hitVector, simChannelVector, hitTruthTable, nThreads);
+
+    hitIndexToTrackIDEs.assign(hitVector.size(), TrackIDEVector());
+
+    for (unsigned int iHit = 0, nHits = hitVector.size(); iHit < nHits; ++iHit)
+    {
+        const size_t hitKey(hitVector[iHit].key());
+
+        for (LArHitTruthTable::EntryList::const_iterator iter = hitTruthTable.Begin(hitKey), iterEnd = hitTruthTable.End(hitKey); iter != iterEnd; ++iter)
+            hitIndexToTrackIDEs[iHit].push_back(LArPandoraHelper::GetTrackIDE(*iter));
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void LArPandoraHelper::BuildMCParticleHitMaps(const HitVector &hitVector, const LArHitTruthTable &hitTruthTable, HitsToTrackIDEs &hitsToTrackIDEs)
+{
+    for (HitVector::const_iterator iter = hitVector.begin(), iterEnd = hitVector.end(); iter != iterEnd; ++iter)
+    {
+        const art::Ptr<recob::Hit> hit = *iter;
+
+        if (0 == hitTruthTable.GetNEntries(hit.key()))
+            continue; // Hit has no truth information [continue]
+
+        TrackIDEVector &trackCollection(hitsToTrackIDEs[hit]);
+
+        for (LArHitTruthTable::EntryList::const_iterator iterE = hitTruthTable.Begin(hit.key()), iterEndE = hitTruthTable.End(hit.key()); iterE != iterEndE; ++iterE)
+            trackCollection.push_back(LArPandoraHelper::GetTrackIDE(*iterE));
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void LArPandoraHelper::BuildHitTruthTable(const HitVector &hitVector, const SimChannelVector &simChannelVector, LArHitTruthTable &hitTruthTable,
+    const unsigned int nThreads)
 {
     auto const* ts = lar::providerFrom<detinfo::DetectorClocksService>();
 
-    SimChannelMap simChannelMap;
+    // Resolve the SimChannels serially, keeping the first SimChannel for each channel
+    std::unordered_map<raw::ChannelID_t, unsigned int> channelToGroup;
+    std::vector<const sim::SimChannel*> groupSimChannels;
 
     for (SimChannelVector::const_iterator iter = simChannelVector.begin(), iterEnd = simChannelVector.end(); iter != iterEnd; ++iter)
     {
         const art::Ptr<sim::SimChannel> simChannel = *iter;
-        simChannelMap.insert(SimChannelMap::value_type(simChannel->Channel(), simChannel));
+
+        if (channelToGroup.emplace(simChannel->Channel(), groupSimChannels.size()).second)
+            groupSimChannels.push_back(simChannel.get());
     }
 
-    for (HitVector::const_iterator iter = hitVector.begin(), iterEnd = hitVector.end(); iter != iterEnd; ++iter)
+    // Group the hit time windows by channel
+    std::vector< std::vector<HitTimeWindow> > groupHitWindows(groupSimChannels.size());
+
+    for (unsigned int iHit = 0, nHits = hitVector.size(); iHit < nHits; ++iHit)
     {
-        const art::Ptr<recob::Hit> hit = *iter;
+        const art::Ptr<recob::Hit> hit = hitVector[iHit];
 
-        SimChannelMap::const_iterator sIter = simChannelMap.find(hit->Channel());
-        if (simChannelMap.end() == sIter)
+        std::unordered_map<raw::ChannelID_t, unsigned int>::const_iterator gIter = channelToGroup.find(hit->Channel());
+        if (channelToGroup.end() == gIter)
             continue; // Hit has no truth information [continue]
 
         // ATTN: Need to convert TDCtick (integer) to TDC (unsigned integer) before passing to simChannel
@@ -849,17 +958,138 @@ void LArPandoraHelper::BuildMCParticleHitMaps(const HitVector &hitVector, const
         if (start_tdc > end_tdc)
             continue; // Hit undershoots the readout window [continue]
 
-        const art::Ptr<sim::SimChannel> simChannel = sIter->second;
-        const TrackIDEVector trackCollection(simChannel->TrackIDEs(start_tdc, end_tdc));
+        groupHitWindows[gIter->second].push_back(HitTimeWindow(iHit, start_tdc, end_tdc));
+    }
 
-        if (trackCollection.empty())
-            continue; // Hit has no truth information [continue]
+    // Sweep each SimChannel once, with its hits in order of start time, filling flat per-channel buffers
+    std::vector<LArHitTruthTable::EntryList> groupEntries(groupSimChannels.size());
+    std::vector< std::vector<unsigned int> > groupOffsets(groupSimChannels.size());
+
+    LArPandoraParallel::ForEach(groupSimChannels.size(), nThreads, [&](const unsigned int iGroup)
+    {
+        std::vector<HitTimeWindow> &hitWindows(groupHitWindows[iGroup]);
+
+        if (hitWindows.empty())
+            return;
+
+        std::stable_sort(hitWindows.begin(), hitWindows.end(), [](const HitTimeWindow &lhs, const HitTimeWindow &rhs)
+        {
+            return (lhs.m_startTDC < rhs.m_startTDC);
+        });
+
+        LArHitTruthTable::EntryList &entries(groupEntries[iGroup]);
+        std::vector<unsigned int> &offsets(groupOffsets[iGroup]);
+        offsets.reserve(hitWindows.size() + 1);
+
+        const auto &tdcIDEMap(groupSimChannels[iGroup]->TDCIDEMap());
+        auto firstIter(tdcIDEMap.begin());
+        std::map<int, float> trackIdToEnergy;
 
-        for (unsigned int iTrack = 0, iTrackEnd = trackCollection.size(); iTrack < iTrackEnd; ++iTrack)
+        for (const HitTimeWindow &hitWindow : hitWindows)
         {
-            const sim::TrackIDE trackIDE = trackCollection.at(iTrack);
-            hitsToTrackIDEs[hit].push_back(trackIDE);
+            offsets.push_back(entries.size());
+
+            while ((tdcIDEMap.end() != firstIter) && (firstIter->first < hitWindow.m_startTDC))
+                ++firstIter;
+
+            // ATTN Energy fractions are calculated exactly as in SimChannel::TrackIDEs
+            trackIdToEnergy.clear();
+            float totalEnergy(0.f);
+
+            for (auto iter = firstIter; (tdcIDEMap.end() != iter) && (iter->first <= hitWindow.m_endTDC); ++iter)
+            {
+                for (const sim::IDE &ide : iter->second)
+                {
+                    totalEnergy += ide.energy;
+                    trackIdToEnergy[ide.trackID] += ide.energy;
+                }
+            }
+
+            if (totalEnergy < 1.e-5f)
+                totalEnergy = 1.f;
+
+            for (const std::map<int, float>::value_type &trackIdEnergy : trackIdToEnergy)
+                entries.push_back(LArHitTruthTable::Entry(trackIdEnergy.first, trackIdEnergy.second, trackIdEnergy.second / totalEnergy));
         }
+
+        offsets.push_back(entries.size());
+    });
+
+    // Locate the buffered deposits of each hit, then pack them into the table in order of hit key
+    const unsigned int invalidIndex(std::numeric_limits<unsigned int>::max());
+    std::vector< std::pair<unsigned int, unsigned int> > hitLocations(hitVector.size(), std::make_pair(invalidIndex, invalidIndex));
+    size_t nEntries(0);
+
+    for (unsigned int iGroup = 0, nGroups = groupHitWindows.size(); iGroup < nGroups; ++iGroup)
+    {
+        for (unsigned int iWindow = 0, nWindows = groupHitWindows[iGroup].size(); iWindow < nWindows; ++iWindow)
+            hitLocations[groupHitWindows[iGroup][iWindow].m_hitIndex] = std::make_pair(iGroup, iWindow);
+
+        nEntries += groupEntries[iGroup].size();
+    }
+
+    std::vector<unsigned int> hitIndices;
+    LArPandoraHelper::GetHitIndicesByKey(hitVector, hitIndices);
+
+    hitTruthTable.Clear();
+    hitTruthTable.Reserve(hitVector.empty() ? 0 : hitVector[hitIndices.back()].key() + 1, nEntries);
+
+    for (const unsigned int iHit : hitIndices)
+    {
+        const size_t hitKey(hitVector[iHit].key());
+        const std::pair<unsigned int, unsigned int> &location(hitLocations[iHit]);
+
+        // ATTN A hit appearing more than once in the input vector is only added once
+        if ((invalidIndex == location.first) || (hitKey < hitTruthTable.GetHitKeyEnd()))
+            continue;
+
+        const LArHitTruthTable::EntryList &entries(groupEntries[location.first]);
+        const std::vector<unsigned int> &offsets(groupOffsets[location.first]);
+        hitTruthTable.AddHit(hitKey, entries.begin() + offsets[location.second], entries.begin() + offsets[location.second + 1]);
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void LArPandoraHelper::BuildHitTruthTable(const art::Event &evt, const HitVector &hitVector, const std::string &backtrackLabel,
+    LArHitTruthTable &hitTruthTable)
+{
+    hitTruthTable.Clear();
+
+    art::FindManyP<simb::MCParticle, anab::BackTrackerHitMatchingData> particles_per_hit(hitVector, evt, backtrackLabel);
+
+    if (!particles_per_hit.isValid())
+    {
+        mf::LogDebug("LArPandora") << "  Failed to find reco-truth matching... " << std::endl;
+        return;
+    }
+
+    std::vector<unsigned int> hitIndices;
+    LArPandoraHelper::GetHitIndicesByKey(hitVector, hitIndices);
+
+    std::vector<anab::BackTrackerHitMatchingData const*> backtrackerVector;
+    MCParticleVector particleVector;
+    LArHitTruthTable::EntryList entries;
+
+    // Now loop over the hits and build a collection of IDEs
+    for (const unsigned int iHit : hitIndices)
+    {
+        const size_t hitKey(hitVector[iHit].key());
+
+        if (hitKey < hitTruthTable.GetHitKeyEnd())
+            continue;
+
+        particleVector.clear(); backtrackerVector.clear(); entries.clear();
+        particles_per_hit.get(iHit, particleVector, backtrackerVector);
+
+        for (unsigned int j = 0; j < particleVector.size(); ++j)
+        {
+            const art::Ptr<simb::MCParticle> particle = particleVector[j];
+            entries.push_back(LArHitTruthTable::Entry(particle->TrackId(), backtrackerVector[j]->energy, backtrackerVector[j]->ideFraction));
+        }
+
+        if (!entries.empty())
+            hitTruthTable.AddHit(hitKey, entries.begin(), entries.end());
     }
 }
 
@@ -903,31 +1133,52 @@ void LArPandoraHelper::BuildMCParticleHitMaps(const HitsToTrackIDEs &hitsToTrack
             }
         }
 
-        if (bestTrackID >= 0)
+        LArPandoraHelper::AddMCParticleHitLink(particleMap, hit, bestTrackID, particlesToHits, hitsToParticles, daughterMode);
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void LArPandoraHelper::BuildMCParticleHitMaps(const HitVector &hitVector, const LArHitTruthTable &hitTruthTable,
+    const MCTruthToMCParticles &truthToParticles, MCParticlesToHits &particlesToHits, HitsToMCParticles &hitsToParticles,
+    const DaughterMode daughterMode)
+{
+    // Build mapping between particles and track IDs for parent/daughter navigation
+    MCParticleMap particleMap;
+
+    for (MCTruthToMCParticles::const_iterator iter1 = truthToParticles.begin(), iterEnd1 = truthToParticles.end(); iter1 != iterEnd1; ++iter1)
+    {
+        const MCParticleVector &particleVector = iter1->second;
+        for (MCParticleVector::const_iterator iter2 = particleVector.begin(), iterEnd2 = particleVector.end(); iter2 != iterEnd2; ++iter2)
         {
-            MCParticleMap::const_iterator iter3 = particleMap.find(bestTrackID);
-            if (particleMap.end() == iter3)
-                throw cet::exception("LArPandora") << " PandoraCollector::BuildMCParticleHitMaps --- Found a track ID without an MC Particle ";
+            const art::Ptr<simb::MCParticle> particle = *iter2;
+            particleMap[particle->TrackId()] = particle;
+        }
+    }
 
-            try
-            {
-                const art::Ptr<simb::MCParticle> thisParticle = iter3->second;
-                const art::Ptr<simb::MCParticle> primaryParticle(LArPandoraHelper::GetFinalStateMCParticle(particleMap, thisParticle));
-                const art::Ptr<simb::MCParticle> selectedParticle((kAddDaughters == daughterMode) ? primaryParticle : thisParticle);
+    // Loop over hits, in order of hit key, and build mapping between reconstructed hits and true particles
+    std::vector<unsigned int> hitIndices;
+    LArPandoraHelper::GetHitIndicesByKey(hitVector, hitIndices);
 
-                if ((kIgnoreDaughters == daughterMode) && (selectedParticle != primaryParticle))
-                    continue;
+    for (const unsigned int iHit : hitIndices)
+    {
+        const art::Ptr<recob::Hit> hit = hitVector[iHit];
 
-                if (!(LArPandoraHelper::IsVisible(selectedParticle)))
-                    continue;
+        int bestTrackID(-1);
+        float bestEnergyFrac(0.f);
 
-                particlesToHits[selectedParticle].push_back(hit);
-                hitsToParticles[hit] = selectedParticle;
-            }
-            catch (cet::exception &e)
+        for (LArHitTruthTable::EntryList::const_iterator iter = hitTruthTable.Begin(hit.key()), iterEnd = hitTruthTable.End(hit.key()); iter != iterEnd; ++iter)
+        {
+            const int trackID(std::abs(iter->m_trackID)); // TODO: Find out why std::abs is needed
+
+            if (iter->m_energyFrac > bestEnergyFrac)
             {
+                bestEnergyFrac = iter->m_energyFrac;
+                bestTrackID = trackID;
             }
         }
+
+        LArPandoraHelper::AddMCParticleHitLink(particleMap, hit, bestTrackID, particlesToHits, hitsToParticles, daughterMode);
     }
 }
 
@@ -939,12 +1190,12 @@ void LArPandoraHelper::BuildMCParticleHitMaps(const art::Event &evt, const std::
     SimChannelVector simChannelVector;
     MCTruthToMCParticles truthToParticles;
     MCParticlesToMCTruth particlesToTruth;
-    HitsToTrackIDEs hitsToTrackIDEs;
+    LArHitTruthTable hitTruthTable;
 
     LArPandoraHelper::CollectSimChannels(evt, label, simChannelVector);
     LArPandoraHelper::CollectMCParticles(evt, label, truthToParticles, particlesToTruth);
-    LArPandoraHelper::BuildMCParticleHitMaps(hitVector, simChannelVector, hitsToTrackIDEs);
-    LArPandoraHelper::BuildMCParticleHitMaps(hitsToTrackIDEs, truthToParticles, particlesToHits, hitsToParticles, daughterMode);
+    LArPandoraHelper::BuildHitTruthTable(hitVector, simChannelVector, hitTruthTable);
+    LArPandoraHelper::BuildMCParticleHitMaps(hitVector, hitTruthTable, truthToParticles, particlesToHits, hitsToParticles, daughterMode);
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
@@ -952,57 +1203,12 @@ void LArPandoraHelper::BuildMCParticleHitMaps(const art::Event &evt, const std::
 void LArPandoraHelper::BuildMCParticleHitMaps(const art::Event &evt, const std::string &hitLabel, const std::string &backtrackLabel,
     HitsToTrackIDEs &hitsToTrackIDEs)
 {
-    // Start by getting the collection of Hits
-    art::Handle< std::vector<recob::Hit> > theHits;
-    evt.getByLabel(hitLabel, theHits);
-
-    if (!theHits.isValid())
-    {
-        mf::LogDebug("LArPandora") << "  Failed to find hits... " << std::endl;
-        return;
-    }
-
     HitVector hitVector;
+    LArHitTruthTable hitTruthTable;
 
-    for (unsigned int i = 0; i < theHits->size(); ++i)
-    {
-        const art::Ptr<recob::Hit> hit(theHits, i);
-        hitVector.push_back(hit);
-    }
-
-    // Now get the associations between Hits and MCParticles
-    std::vector<anab::BackTrackerHitMatchingData const*> backtrackerVector;
-
-    MCParticleVector particleVector;
-
-    art::FindManyP<simb::MCParticle, anab::BackTrackerHitMatchingData> particles_per_hit(theHits, evt, backtrackLabel);
-
-    if (!particles_per_hit.isValid())
-    {
-        mf::LogDebug("LArPandora") << "  Failed to find reco-truth matching... " << std::endl;
-        return;
-    }
-
-    // Now loop over the hits and build a collection of IDEs
-    for (HitVector::const_iterator iter = hitVector.begin(), iterEnd = hitVector.end(); iter != iterEnd; ++iter)
-    {
-        const art::Ptr<recob::Hit> hit = *iter;
-
-        particleVector.clear(); backtrackerVector.clear();
-        particles_per_hit.get(hit.key(), particleVector, backtrackerVector);
-
-        for (unsigned int j = 0; j < particleVector.size(); ++j)
-        {
-            const art::Ptr<simb::MCParticle> particle = particleVector[j];
-
-            sim::TrackIDE trackIDE;
-            trackIDE.trackID = particle->TrackId();
-            trackIDE.energy = backtrackerVector[j]->energy;
-            trackIDE.energyFrac = backtrackerVector[j]->ideFraction;
-
-            hitsToTrackIDEs[hit].push_back(trackIDE);
-        }
-    }
+    LArPandoraHelper::CollectHits(evt, hitLabel, hitVector);
+    LArPandoraHelper::BuildHitTruthTable(evt, hitVector, backtrackLabel, hitTruthTable);
+    LArPandoraHelper::BuildMCParticleHitMaps(hitVector, hitTruthTable, hitsToTrackIDEs);
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
@@ -1012,11 +1218,13 @@ void LArPandoraHelper::BuildMCParticleHitMaps(const art::Event &evt, const std::
 {
     MCTruthToMCParticles truthToParticles;
     MCParticlesToMCTruth particlesToTruth;
-    HitsToTrackIDEs hitsToTrackIDEs;
+    HitVector hitVector;
+    LArHitTruthTable hitTruthTable;
 
     LArPandoraHelper::CollectMCParticles(evt, truthLabel, truthToParticles, particlesToTruth);
-    LArPandoraHelper::BuildMCParticleHitMaps(evt, hitLabel, backtrackLabel, hitsToTrackIDEs);
-    LArPandoraHelper::BuildMCParticleHitMaps(hitsToTrackIDEs, truthToParticles, particlesToHits, hitsToParticles, daughterMode);
+    LArPandoraHelper::CollectHits(evt, hitLabel, hitVector);
+    LArPandoraHelper::BuildHitTruthTable(evt, hitVector, backtrackLabel, hitTruthTable);
+    LArPandoraHelper::BuildMCParticleHitMaps(hitVector, hitTruthTable, truthToParticles, particlesToHits, hitsToParticles, daughterMode);
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
@@ -1030,12 +1238,14 @@ void LArPandoraHelper::GetAssociatedHits(const art::Event &evt, const std::strin
 
     if (indexVector != nullptr)
     {
-        // If indexVector is filled, sort hits according to trajectory points order
+        // If indexVector is filled, sort hits according to trajectory points order, keeping only the representative hit of coalesced hits
         for (int index : (*indexVector))
         {
             const art::Ptr<recob::SpacePoint> &spacePoint = inputSpacePoints.at(index);
             const HitVector &hits = spacePointToHitAssoc.at(spacePoint.key());
-            associatedHits.insert(associatedHits.end(), hits.begin(), hits.end());
+
+            if (!hits.empty())
+                associatedHits.push_back(hits.front());
         }
     } else {
         // If indexVector is empty just loop through inputSpacePoints
@@ -1049,6 +1259,40 @@ void LArPandoraHelper::GetAssociatedHits(const art::Event &evt, const std::strin
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
+void LArPandoraHelper::GetAssociatedHits(const art::Event &evt, const LArCompactSpacePoints &spacePoints, const unsigned int firstSpacePoint,
+    const unsigned int endSpacePoint, HitVector &associatedHits, const pandora::IntVector* const indexVector)
+{
+    if ((firstSpacePoint > endSpacePoint) || (endSpacePoint > spacePoints.GetNSpacePoints()))
+        throw cet::exception("LArPandora") << " LArPandoraHelper::GetAssociatedHits --- invalid range of compact spacepoints ";
+
+    const art::ProductID &hitProductId(spacePoints.GetHitProductId());
+    const art::EDProductGetter *const pProductGetter(evt.productGetter(hitProductId));
+
+    if (indexVector != nullptr)
+    {
+        // If indexVector is filled, sort hits according to trajectory points order, keeping only the representative hit of coalesced hits
+        for (int index : (*indexVector))
+        {
+            const unsigned int spacePointIndex(firstSpacePoint + index);
+
+            if (spacePointIndex >= endSpacePoint)
+                throw cet::exception("LArPandora") << " LArPandoraHelper::GetAssociatedHits --- spacepoint index out of range ";
+
+            if (spacePoints.GetNHits(spacePointIndex) > 0)
+                associatedHits.emplace_back(hitProductId, spacePoints.GetHitKey(spacePointIndex, 0), pProductGetter);
+        }
+    } else {
+        // If indexVector is empty just loop through the range of spacepoints
+        for (unsigned int spacePointIndex = firstSpacePoint; spacePointIndex < endSpacePoint; ++spacePointIndex)
+        {
+            for (unsigned int hitIndex = 0; hitIndex < spacePoints.GetNHits(spacePointIndex); ++hitIndex)
+                associatedHits.emplace_back(hitProductId, spacePoints.GetHitKey(spacePointIndex, hitIndex), pProductGetter);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
 void LArPandoraHelper::BuildMCParticleMap(const MCParticleVector &particleVector, MCParticleMap &particleMap)
 {
     for (MCParticleVector::const_iterator iter = particleVector.begin(), iterEnd = particleVector.end(); iter != iterEnd; ++iter)
@@ -1289,6 +1533,46 @@ bool LArPandoraHelper::IsFinalState(const PFParticleMap &particleMap, const art:
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
+art::Ptr<recob::PFParticle> LArPandoraHelper::GetParentPFParticle(const LArPFParticleSummaryVector &summaries,
+    const art::Ptr<recob::PFParticle> daughterParticle)
+{
+    const LArPFParticleSummary &summary(LArPandoraHelper::GetPFParticleSummary(summaries, daughterParticle));
+    return LArPandoraHelper::GetSummaryPFParticle(daughterParticle, summary.GetRootIndex());
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+art::Ptr<recob::PFParticle> LArPandoraHelper::GetFinalStatePFParticle(const LArPFParticleSummaryVector &summaries,
+    const art::Ptr<recob::PFParticle> daughterParticle)
+{
+    const LArPFParticleSummary &summary(LArPandoraHelper::GetPFParticleSummary(summaries, daughterParticle));
+    return LArPandoraHelper::GetSummaryPFParticle(daughterParticle, summary.GetFinalStateIndex());
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+int LArPandoraHelper::GetGeneration(const LArPFParticleSummaryVector &summaries, const art::Ptr<recob::PFParticle> daughterParticle)
+{
+    return LArPandoraHelper::GetPFParticleSummary(summaries, daughterParticle).GetGeneration();
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+int LArPandoraHelper::GetParentNeutrino(const LArPFParticleSummaryVector &summaries, const art::Ptr<recob::PFParticle> daughterParticle)
+{
+    return LArPandoraHelper::GetPFParticleSummary(summaries, daughterParticle).GetNeutrinoPdgCode();
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+bool LArPandoraHelper::IsFinalState(const LArPFParticleSummaryVector &summaries, const art::Ptr<recob::PFParticle> daughterParticle)
+{
+    const LArPFParticleSummary &summary(LArPandoraHelper::GetPFParticleSummary(summaries, daughterParticle));
+    return (!LArPandoraHelper::IsNeutrino(daughterParticle) && (summary.GetFinalStateIndex() == daughterParticle.key()));
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
 bool LArPandoraHelper::IsNeutrino(const art::Ptr<recob::PFParticle> particle)
 {
     const int pdg(particle->PdgCode());
@@ -1336,4 +1620,82 @@ bool LArPandoraHelper::IsVisible(const art::Ptr<simb::MCParticle> particle)
     return false;
 }
 
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void LArPandoraHelper::AddMCParticleHitLink(const MCParticleMap &particleMap, const art::Ptr<recob::Hit> &hit, const int bestTrackID,
+    MCParticlesToHits &particlesToHits, HitsToMCParticles &hitsToParticles, const DaughterMode daughterMode)
+{
+    if (bestTrackID < 0)
+        return;
+
+    MCParticleMap::const_iterator iter = particleMap.find(bestTrackID);
+    if (particleMap.end() == iter)
+        throw cet::exception("LArPandora") << " PandoraCollector::BuildMCParticleHitMaps --- Found a track ID without an MC Particle ";
+
+    try
+    {
+        const art::Ptr<simb::MCParticle> thisParticle = iter->second;
+        const art::Ptr<simb::MCParticle> primaryParticle(LArPandoraHelper::GetFinalStateMCParticle(particleMap, thisParticle));
+        const art::Ptr<simb::MCParticle> selectedParticle((kAddDaughters == daughterMode) ? primaryParticle : thisParticle);
+
+        if ((kIgnoreDaughters == daughterMode) && (selectedParticle != primaryParticle))
+            return;
+
+        if (!(LArPandoraHelper::IsVisible(selectedParticle)))
+            return;
+
+        particlesToHits[selectedParticle].push_back(hit);
+        hitsToParticles[hit] = selectedParticle;
+    }
+    catch (cet::exception &e)
+    {
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void LArPandoraHelper::GetHitIndicesByKey(const HitVector &hitVector, std::vector<unsigned int> &hitIndices)
+{
+    hitIndices.resize(hitVector.size());
+
+    for (unsigned int iHit = 0, nHits = hitVector.size(); iHit < nHits; ++iHit)
+        hitIndices[iHit] = iHit;
+
+    std::stable_sort(hitIndices.begin(), hitIndices.end(), [&hitVector](const unsigned int lhs, const unsigned int rhs)
+    {
+        return (hitVector[lhs].key() < hitVector[rhs].key());
+    });
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+sim::TrackIDE LArPandoraHelper::GetTrackIDE(const LArHitTruthTable::Entry &entry)
+{
+    sim::TrackIDE trackIDE = sim::TrackIDE();
+    trackIDE.trackID = entry.m_trackID;
+    trackIDE.energyFrac = entry.m_energyFrac;
+    trackIDE.energy = entry.m_energy;
+    return trackIDE;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+const LArPFParticleSummary &LArPandoraHelper::GetPFParticleSummary(const LArPFParticleSummaryVector &summaries, const art::Ptr<recob::PFParticle> particle)
+{
+    if ((particle.key() >= summaries.size()) || (summaries[particle.key()].GetPFParticleProductId() != particle.id()))
+        throw cet::exception("LArPandora") << " LArPandoraHelper::GetPFParticleSummary --- PFParticle summaries were not written alongside the PFParticle ";
+
+    return summaries[particle.key()];
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+art::Ptr<recob::PFParticle> LArPandoraHelper::GetSummaryPFParticle(const art::Ptr<recob::PFParticle> particle, const unsigned int index)
+{
+    if (LArPFParticleSummary::InvalidIndex == index)
+        throw cet::exception("LArPandora") << " LArPandoraHelper::GetSummaryPFParticle --- Found an invalid PFParticle summary index ";
+
+    return art::Ptr<recob::PFParticle>(particle.id(), index, particle.productGetter());
+}
+
 } // namespace lar_pandora
@@ -11,6 +11,8 @@
 
 #include "lardataobj/Simulation/SimChannel.h"
 
+#include "larpandora/LArPandoraInterface/LArHitTruthTable.h"
+
 #include <map>
 #include <set>
 #include <vector>
@@ -26,6 +28,12 @@ namespace simb {class MCParticle; class MCTruth;}
 namespace lar_pandora
 {
 
+class LArCompactSpacePoints;
+class LArHitOwnership;
+class LArPFParticleSummary;
+
+typedef std::vector<LArPFParticleSummary> LArPFParticleSummaryVector;
+
 typedef std::set< art::Ptr<recob::Hit> > HitList;
 
 typedef std::vector< art::Ptr<recob::Wire> >        WireVector;
@@ -42,6 +50,7 @@ typedef std::vector< art::Ptr<simb::MCParticle> >   MCParticleVector;
 typedef std::vector< simb::MCParticle>              RawMCParticleVector;
 typedef std::vector< art::Ptr<sim::SimChannel> >    SimChannelVector;
 typedef std::vector< sim::TrackIDE >                TrackIDEVector;
+typedef std::vector< TrackIDEVector >               HitIndexToTrackIDEs;
 typedef std::vector< art::Ptr<anab::CosmicTag> >    CosmicTagVector;
 typedef std::vector< art::Ptr<anab::T0> >           T0Vector;
 
@@ -315,6 +324,21 @@ public:
         PFParticlesToHits &particlesToHits, HitsToPFParticles &hitsToParticles, const DaughterMode daughterMode = kUseDaughters,
         const bool useClusters = true);
 
+    /**
+     *  @brief Build mapping between PFParticles and Hits from the precomputed hit ownership in the ART event record, without reading the
+     *         clusters or associations (equivalent to the cluster-based mapping)
+     *
+     *  @param evt the ART event record
+     *  @param label the label for the PFParticle list and hit ownership in the event
+     *  @param particlesToHits output map from PFParticle to Hit objects
+     *  @param hitsToParticles output map from Hit to PFParticle objects
+     *  @param daughterMode treatment of daughter particles in construction of maps
+     *
+     *  @return whether the hit ownership was found
+     */
+    static bool BuildPFParticleHitMapsFromHitOwnership(const art::Event &evt, const std::string &label, PFParticlesToHits &particlesToHits,
+        HitsToPFParticles &hitsToParticles, const DaughterMode daughterMode = kUseDaughters);
+
     /**
      *  @brief Collect a vector of cosmic tags from the ART event record
      *
@@ -382,8 +406,54 @@ public:
      *  @param hitVector the input vector of reconstructed hits
      *  @param simChannelVector the input vector of SimChannels
      *  @param hitsToTrackIDEs the out map from hits to true energy deposits
+     *  @param nThreads the number of threads used to sweep the SimChannels
+     */
+    static void BuildMCParticleHitMaps(const HitVector &hitVector, const SimChannelVector &simChannelVector, HitsToTrackIDEs &hitsToTrackIDEs,
+        const unsigned int nThreads = 1);
+
+    /**
+     *  @brief Collect the links from reconstructed hits to their true energy deposits, grouping the hits by channel and sweeping the
+     *         time-ordered energy deposits of each SimChannel once
+     *
+     *  @param hitVector the input vector of reconstructed hits
+     *  @param simChannelVector the input vector of SimChannels
+     *  @param hitIndexToTrackIDEs the output true energy deposits for each hit, aligned with the input hit vector (empty if none)
+     *  @param nThreads the number of threads used to sweep the SimChannels
+     */
+    static void BuildMCParticleHitMaps(const HitVector &hitVector, const SimChannelVector &simChannelVector, HitIndexToTrackIDEs &hitIndexToTrackIDEs,
+        const unsigned int nThreads = 1);
+
+    /**
+     *  @brief Collect the links from reconstructed hits to their true energy deposits, from a flat truth table
+     *
+     *  @param hitVector the input vector of reconstructed hits
+     *  @param hitTruthTable the input table of true energy deposits, by hit key
+     *  @param hitsToTrackIDEs the out map from hits to true energy deposits
      */
-    static void BuildMCParticleHitMaps(const HitVector &hitVector, const SimChannelVector &simChannelVector, HitsToTrackIDEs &hitsToTrackIDEs);
+    static void BuildMCParticleHitMaps(const HitVector &hitVector, const LArHitTruthTable &hitTruthTable, HitsToTrackIDEs &hitsToTrackIDEs);
+
+    /**
+     *  @brief Build the flat table of true energy deposits of reconstructed hits, grouping the hits by channel and sweeping the
+     *         time-ordered energy deposits of each SimChannel once
+     *
+     *  @param hitVector the input vector of reconstructed hits, all from a single hit collection
+     *  @param simChannelVector the input vector of SimChannels
+     *  @param hitTruthTable the output table of true energy deposits, by hit key
+     *  @param nThreads the number of threads used to sweep the SimChannels
+     */
+    static void BuildHitTruthTable(const HitVector &hitVector, const SimChannelVector &simChannelVector, LArHitTruthTable &hitTruthTable,
+        const unsigned int nThreads = 1);
+
+    /**
+     *  @brief Build the flat table of true energy deposits of reconstructed hits, using back-tracker information
+     *
+     *  @param evt the event record
+     *  @param hitVector the input vector of reconstructed hits, all from a single hit collection
+     *  @param backtrackLabel the label of the collection of back-tracker information
+     *  @param hitTruthTable the output table of true energy deposits, by hit key
+     */
+    static void BuildHitTruthTable(const art::Event &evt, const HitVector &hitVector, const std::string &backtrackLabel,
+        LArHitTruthTable &hitTruthTable);
 
     /**
      *  @brief Build mapping between Hits and MCParticles, starting from Hit/TrackIDE/MCParticle information
@@ -397,6 +467,19 @@ public:
     static void BuildMCParticleHitMaps(const HitsToTrackIDEs &hitsToTrackIDEs, const MCTruthToMCParticles &truthToParticles,
         MCParticlesToHits &particlesToHits, HitsToMCParticles &hitsToParticles, const DaughterMode daughterMode = kUseDaughters);
 
+    /**
+     *  @brief Build mapping between Hits and MCParticles, starting from a flat truth table and MCParticle information
+     *
+     *  @param hitVector the input vector of reconstructed hits
+     *  @param hitTruthTable the input table of true energy deposits, by hit key
+     *  @param truthToParticles the input map of truth information
+     *  @param particlesToHits the mapping between true particles and reconstructed hits
+     *  @param hitsToParticles the mapping between reconstructed hits and true particles
+     *  @param daughterMode treatment of daughter particles in construction of maps
+     */
+    static void BuildMCParticleHitMaps(const HitVector &hitVector, const LArHitTruthTable &hitTruthTable, const MCTruthToMCParticles &truthToParticles,
+        MCParticlesToHits &particlesToHits, HitsToMCParticles &hitsToParticles, const DaughterMode daughterMode = kUseDaughters);
+
     /**
      *  @brief Build mapping between Hits and MCParticles, starting from ART event record
      *
@@ -437,7 +520,8 @@ public:
         const DaughterMode daughterMode = kUseDaughters);
 
     /**
-     *  @brief  Get all hits associated with input spacepoints
+     *  @brief  Get all hits associated with input spacepoints. If an index vector is provided, only the first (representative) hit of each
+     *          indexed spacepoint is collected, so that there is one hit per trajectory point
      *
      *  @param  evt the event containing the hits
      *  @param  label the label of the collection producing PFParticles
@@ -448,6 +532,20 @@ public:
     static void GetAssociatedHits(const art::Event &evt, const std::string &label, const SpacePointVector &inputSpacePoints,
         HitVector &associatedHits, const pandora::IntVector* const indexVector = nullptr);
 
+    /**
+     *  @brief  Get all hits associated with a range of compact spacepoints. If an index vector is provided, only the first (representative)
+     *          hit of each indexed spacepoint is collected, so that there is one hit per trajectory point
+     *
+     *  @param  evt the event containing the hits
+     *  @param  spacePoints the compact spacepoints
+     *  @param  firstSpacePoint the index of the first spacepoint in the range
+     *  @param  endSpacePoint the index one past the last spacepoint in the range
+     *  @param  associatedHits output hits associated with spacepoints
+     *  @param  indexVector vector of spacepoint indices, relative to the first spacepoint, reflecting trajectory points sorting order
+     */
+    static void GetAssociatedHits(const art::Event &evt, const LArCompactSpacePoints &spacePoints, const unsigned int firstSpacePoint,
+        const unsigned int endSpacePoint, HitVector &associatedHits, const pandora::IntVector* const indexVector = nullptr);
+
     /**
      *  @brief Select reconstructed neutrino particles from a list of all reconstructed particles
      *
@@ -558,6 +656,58 @@ public:
      */
     static bool IsFinalState(const PFParticleMap &particleMap, const art::Ptr<recob::PFParticle> daughterParticle);
 
+    /**
+     *  @brief Return the top-level parent particle, using the precomputed summaries
+     *
+     *  @param summaries the PFParticle summaries, written alongside the PFParticle collection of the input particle
+     *  @param daughterParticle the input PF particle
+     *
+     *  @return the top-level parent particle
+     */
+    static art::Ptr<recob::PFParticle> GetParentPFParticle(const LArPFParticleSummaryVector &summaries,
+        const art::Ptr<recob::PFParticle> daughterParticle);
+
+    /**
+     *  @brief Return the final-state parent particle, using the precomputed summaries
+     *
+     *  @param summaries the PFParticle summaries, written alongside the PFParticle collection of the input particle
+     *  @param daughterParticle the input PF particle
+     *
+     *  @return the final-state parent particle
+     */
+    static art::Ptr<recob::PFParticle> GetFinalStatePFParticle(const LArPFParticleSummaryVector &summaries,
+        const art::Ptr<recob::PFParticle> daughterParticle);
+
+    /**
+     *  @brief Return the generation of this particle (first generation if primary), using the precomputed summaries
+     *
+     *  @param summaries the PFParticle summaries, written alongside the PFParticle collection of the input particle
+     *  @param daughterParticle the input daughter particle
+     *
+     *  @return the nth generation in the particle hierarchy
+     */
+    static int GetGeneration(const LArPFParticleSummaryVector &summaries, const art::Ptr<recob::PFParticle> daughterParticle);
+
+    /**
+     *  @brief Return the parent neutrino PDG code (or zero for cosmics), using the precomputed summaries
+     *
+     *  @param summaries the PFParticle summaries, written alongside the PFParticle collection of the input particle
+     *  @param daughterParticle the input daughter particle
+     *
+     *  @return the PDG code of the parent neutrinos (or zero for cosmics)
+     */
+    static int GetParentNeutrino(const LArPFParticleSummaryVector &summaries, const art::Ptr<recob::PFParticle> daughterParticle);
+
+    /**
+     *  @brief Determine whether a particle has been reconstructed as a final-state particle, using the precomputed summaries
+     *
+     *  @param summaries the PFParticle summaries, written alongside the PFParticle collection of the input particle
+     *  @param daughterParticle the input daughter particle
+     *
+     *  @return true/false
+     */
+    static bool IsFinalState(const LArPFParticleSummaryVector &summaries, const art::Ptr<recob::PFParticle> daughterParticle);
+
     /**
      *  @brief Determine whether a particle has been reconstructed as a neutrino
      *
@@ -593,8 +743,88 @@ public:
      *  @return true/false
      */
     static bool IsVisible(const art::Ptr<simb::MCParticle> particle);
+
+private:
+    /**
+     *  @brief  Add the link between a hit and the true particle that deposited most of its energy, subject to the daughter mode
+     *
+     *  @param  particleMap the mapping from track ids to true particles
+     *  @param  hit the reconstructed hit
+     *  @param  bestTrackID the id of the track that deposited most of the hit energy (negative if none)
+     *  @param  particlesToHits the mapping between true particles and reconstructed hits
+     *  @param  hitsToParticles the mapping between reconstructed hits and true particles
+     *  @param  daughterMode treatment of daughter particles in construction of maps
+     */
+    static void AddMCParticleHitLink(const MCParticleMap &particleMap, const art::Ptr<recob::Hit> &hit, const int bestTrackID,
+        MCParticlesToHits &particlesToHits, HitsToMCParticles &hitsToParticles, const DaughterMode daughterMode);
+
+    /**
+     *  @brief  Get the indices of a vector of hits, sorted by hit key
+     *
+     *  @param  hitVector the input vector of reconstructed hits
+     *  @param  hitIndices the output hit indices
+     */
+    static void GetHitIndicesByKey(const HitVector &hitVector, std::vector<unsigned int> &hitIndices);
+
+    /**
+     *  @brief  Convert a truth table entry to a true energy deposit
+     *
+     *  @param  entry the truth table entry
+     *
+     *  @return the true energy deposit
+     */
+    static sim::TrackIDE GetTrackIDE(const LArHitTruthTable::Entry &entry);
+
+    /**
+     *  @brief  Get the precomputed summary of a particle, throwing if the summaries were not written alongside its collection
+     *
+     *  @param  summaries the PFParticle summaries
+     *  @param  particle the input particle
+     *
+     *  @return the summary
+     */
+    static const LArPFParticleSummary &GetPFParticleSummary(const LArPFParticleSummaryVector &summaries, const art::Ptr<recob::PFParticle> particle);
+
+    /**
+     *  @brief  Get the particle with a given summary index, in the same collection as a given particle
+     *
+     *  @param  particle a particle in the collection to which the summary index refers
+     *  @param  index the summary index
+     *
+     *  @return the particle
+     */
+    static art::Ptr<recob::PFParticle> GetSummaryPFParticle(const art::Ptr<recob::PFParticle> particle, const unsigned int index);
+
+    /**
+     *  @brief  HitTimeWindow class, the TDC range of a hit, for sweeping the energy deposits of a SimChannel
+     */
+    class HitTimeWindow
+    {
+    public:
+        /**
+         *  @brief  Constructor
+         *
+         *  @param  hitIndex the index of the hit in the input hit vector
+         *  @param  startTDC the first TDC of the hit
+         *  @param  endTDC the last TDC of the hit
+         */
+        HitTimeWindow(const unsigned int hitIndex, const unsigned int startTDC, const unsigned int endTDC);
+
+        unsigned int    m_hitIndex;     ///< The index of the hit in the input hit vector
+        unsigned int    m_startTDC;     ///< The first TDC of the hit
+        unsigned int    m_endTDC;       ///< The last TDC of the hit
+    };
 };
 
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline LArPandoraHelper::HitTimeWindow::HitTimeWindow(const unsigned int hitIndex, const unsigned int startTDC, const unsigned int endTDC) :
+    m_hitIndex(hitIndex),
+    m_startTDC(startTDC),
+    m_endTDC(endTDC)
+{
+}
+
 } // namespace lar_pandora
 
 #endif //  LAR_PANDORA_HELPER_H
@@ -31,109 +31,214 @@
 
 #include "larpandora/LArPandoraInterface/ILArPandora.h"
 #include "larpandora/LArPandoraInterface/LArPandoraInput.h"
-
+#include "larpandora/LArPandoraInterface/LArPandoraParallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iterator>
 #include <limits>
+#include <numeric>
+#include <tuple>
 
 namespace lar_pandora
 {
 
-void LArPandoraInput::CreatePandoraHits2D(const Settings &settings, const LArDriftVolumeMap &driftVolumeMap, const HitVector &hitVector, IdToHitMap &idToHitMap)
+void LArPandoraInput::FilterHits(const HitFilterSettings &filterSettings, const HitVector &hitVector, HitVector &selectedHitVector,
+    HitVector &rejectedHitVector, HitFilterStatistics &statistics)
 {
-    mf::LogDebug("LArPandora") << " *** LArPandoraInput::CreatePandoraHits2D(...) *** " << std::endl;
+    mf::LogDebug("LArPandora") << " *** LArPandoraInput::FilterHits(...) *** " << std::endl;
 
-    if (!settings.m_pPrimaryPandora)
-        throw cet::exception("LArPandora") << "CreatePandoraHits2D - primary Pandora instance does not exist ";
+    const unsigned int nHits(hitVector.size());
+    statistics.m_nInputHits += nHits;
 
-    const pandora::Pandora *pPandora(settings.m_pPrimaryPandora);
-
-    art::ServiceHandle<geo::Geometry> theGeometry;
-    auto const* theDetector = lar::providerFrom<detinfo::DetectorPropertiesService>();
+    if (!filterSettings.m_enableHitFilter)
+    {
+        selectedHitVector.insert(selectedHitVector.end(), hitVector.begin(), hitVector.end());
+        return;
+    }
 
-    // Loop over ART hits
-    int hitCounter(0);
+    const lariov::ChannelStatusProvider *const pChannelStatus(filterSettings.m_rejectNoisyChannels ?
+        &art::ServiceHandle<lariov::ChannelStatusService>()->GetProvider() : nullptr);
 
-    lar_content::LArCaloHitFactory caloHitFactory;
+    // Apply the per-hit cuts, keeping the indices of the surviving hits
+    std::vector<bool> isSelected(nHits, false);
+    std::vector<unsigned int> candidateIndices;
+    candidateIndices.reserve(nHits);
 
-    for (HitVector::const_iterator iter = hitVector.begin(), iterEnd = hitVector.end(); iter != iterEnd; ++iter)
+    for (unsigned int iHit = 0; iHit < nHits; ++iHit)
     {
-        const art::Ptr<recob::Hit> hit = *iter;
-        const geo::WireID hit_WireID(hit->WireID());
+        const recob::Hit &hit(*hitVector[iHit]);
 
-        // Get basic hit properties (view, time, charge)
-        const geo::View_t hit_View(hit->View());
-        const double hit_Charge(hit->Integral());
-        const double hit_Time(hit->PeakTime());
-        const double hit_TimeStart(hit->PeakTimeMinusRMS());
-        const double hit_TimeEnd(hit->PeakTimePlusRMS());
-
-        // Get hit X coordinate and, if using a single global drift volume, remove any out-of-time hits here
-        const double xpos_cm(theDetector->ConvertTicksToX(hit_Time, hit_WireID.Plane, hit_WireID.TPC, hit_WireID.Cryostat));
-        const double dxpos_cm(std::fabs(theDetector->ConvertTicksToX(hit_TimeEnd, hit_WireID.Plane, hit_WireID.TPC, hit_WireID.Cryostat) -
-            theDetector->ConvertTicksToX(hit_TimeStart, hit_WireID.Plane, hit_WireID.TPC, hit_WireID.Cryostat)));
+        if (hit.Integral() < filterSettings.m_minHitCharge)
+        {
+            ++statistics.m_nChargeRejected;
+        }
+        else if ((hit.PeakTime() < filterSettings.m_minHitPeakTime) || (hit.PeakTime() > filterSettings.m_maxHitPeakTime))
+        {
+            ++statistics.m_nTimeRejected;
+        }
+        else if (pChannelStatus && pChannelStatus->IsNoisy(hit.Channel()))
+        {
+            ++statistics.m_nNoisyChannelRejected;
+        }
+        else
+        {
+            candidateIndices.push_back(iHit);
+        }
+    }
 
-        // Get hit Y and Z coordinates, based on central position of wire
-        double xyz[3];
-        theGeometry->Cryostat(hit_WireID.Cryostat).TPC(hit_WireID.TPC).Plane(hit_WireID.Plane).Wire(hit_WireID.Wire).GetCenter(xyz);
-        const double y0_cm(xyz[1]);
-        const double z0_cm(xyz[2]);
+    if (0 == filterSettings.m_minNeighbourHits)
+    {
+        for (const unsigned int iHit : candidateIndices)
+            isSelected[iHit] = true;
+    }
+    else
+    {
+        // Order the candidates by plane, wire and peak time, so the neighbours on each wire form a contiguous range
+        auto hitOrder = [&hitVector](const unsigned int lhs, const unsigned int rhs)
+        {
+            const recob::Hit &lhsHit(*hitVector[lhs]), &rhsHit(*hitVector[rhs]);
+            return (std::make_tuple(lhsHit.WireID().asPlaneID(), lhsHit.WireID().Wire, lhsHit.PeakTime()) <
+                std::make_tuple(rhsHit.WireID().asPlaneID(), rhsHit.WireID().Wire, rhsHit.PeakTime()));
+        };
 
-        // Get other hit properties here
-        const double wire_pitch_cm(theGeometry->WirePitch(hit_View)); // cm
-        const double mips(LArPandoraInput::GetMips(settings, hit_Charge, hit_View));
+        std::vector<unsigned int> sortedIndices(candidateIndices);
+        std::sort(sortedIndices.begin(), sortedIndices.end(), hitOrder);
 
-        // Create Pandora CaloHit
-        lar_content::LArCaloHitParameters caloHitParameters;
+        typedef std::tuple<geo::PlaneID, unsigned int, float> HitPosition;
 
-        try
+        auto hitBeforePosition = [&hitVector](const unsigned int iHit, const HitPosition &position)
         {
-            caloHitParameters.m_expectedDirection = pandora::CartesianVector(0., 0., 1.);
-            caloHitParameters.m_cellNormalVector = pandora::CartesianVector(0., 0., 1.);
-            caloHitParameters.m_cellSize0 = settings.m_dx_cm;
-            caloHitParameters.m_cellSize1 = (settings.m_useHitWidths ? dxpos_cm : settings.m_dx_cm);
-            caloHitParameters.m_cellThickness = wire_pitch_cm;
-            caloHitParameters.m_cellGeometry = pandora::RECTANGULAR;
-            caloHitParameters.m_time = 0.;
-            caloHitParameters.m_nCellRadiationLengths = settings.m_dx_cm / settings.m_rad_cm;
-            caloHitParameters.m_nCellInteractionLengths = settings.m_dx_cm / settings.m_int_cm;
-            caloHitParameters.m_isDigital = false;
-            caloHitParameters.m_hitRegion = pandora::SINGLE_REGION;
-            caloHitParameters.m_layer = 0;
-            caloHitParameters.m_isInOuterSamplingLayer = false;
-            caloHitParameters.m_inputEnergy = hit_Charge;
-            caloHitParameters.m_mipEquivalentEnergy = mips;
-            caloHitParameters.m_electromagneticEnergy = mips * settings.m_mips_to_gev;
-            caloHitParameters.m_hadronicEnergy = mips * settings.m_mips_to_gev;
-            caloHitParameters.m_pParentAddress = (void*)((intptr_t)(++hitCounter));
-            caloHitParameters.m_larTPCVolumeId = LArPandoraGeometry::GetVolumeID(driftVolumeMap, hit_WireID.Cryostat, hit_WireID.TPC);
+            const recob::Hit &hit(*hitVector[iHit]);
+            return (std::make_tuple(hit.WireID().asPlaneID(), hit.WireID().Wire, hit.PeakTime()) < position);
+        };
 
-            const geo::View_t pandora_View(LArPandoraGeometry::GetGlobalView(hit_WireID.Cryostat, hit_WireID.TPC, hit_View));
+        auto positionBeforeHit = [&hitVector](const HitPosition &position, const unsigned int iHit)
+        {
+            const recob::Hit &hit(*hitVector[iHit]);
+            return (position < std::make_tuple(hit.WireID().asPlaneID(), hit.WireID().Wire, hit.PeakTime()));
+        };
 
-            if (pandora_View == geo::kW)
-            {
-                caloHitParameters.m_hitType = pandora::TPC_VIEW_W;
-                const double wpos_cm(z0_cm);
-                caloHitParameters.m_positionVector = pandora::CartesianVector(xpos_cm, 0., wpos_cm);
-            }
-            else if(pandora_View == geo::kU)
+        for (const unsigned int iHit : candidateIndices)
+        {
+            const recob::Hit &hit(*hitVector[iHit]);
+            const geo::PlaneID planeID(hit.WireID().asPlaneID());
+            const unsigned int wire(hit.WireID().Wire);
+            const unsigned int minWire((wire > filterSettings.m_neighbourWireWindow) ? wire - filterSettings.m_neighbourWireWindow : 0);
+            const unsigned int maxWire(wire + filterSettings.m_neighbourWireWindow);
+            const float minTime(hit.PeakTime() - filterSettings.m_neighbourTimeWindow);
+            const float maxTime(hit.PeakTime() + filterSettings.m_neighbourTimeWindow);
+
+            // ATTN The hit itself lies within the window, so is discounted from the number of neighbours
+            unsigned int nNeighbourHits(0);
+
+            for (unsigned int neighbourWire = minWire; (neighbourWire <= maxWire) && (nNeighbourHits <= filterSettings.m_minNeighbourHits); ++neighbourWire)
             {
-                caloHitParameters.m_hitType = pandora::TPC_VIEW_U;
-                const double upos_cm(pPandora->GetPlugins()->GetLArTransformationPlugin()->YZtoU(y0_cm, z0_cm));
-                caloHitParameters.m_positionVector = pandora::CartesianVector(xpos_cm, 0., upos_cm);
+                const auto beginIter(std::lower_bound(sortedIndices.begin(), sortedIndices.end(), HitPosition(planeID, neighbourWire, minTime), hitBeforePosition));
+                const auto endIter(std::upper_bound(beginIter, sortedIndices.end(), HitPosition(planeID, neighbourWire, maxTime), positionBeforeHit));
+                nNeighbourHits += std::distance(beginIter, endIter);
             }
-            else if(pandora_View == geo::kV)
+
+            if (nNeighbourHits > filterSettings.m_minNeighbourHits)
             {
-                caloHitParameters.m_hitType = pandora::TPC_VIEW_V;
-                const double vpos_cm(pPandora->GetPlugins()->GetLArTransformationPlugin()->YZtoV(y0_cm, z0_cm));
-                caloHitParameters.m_positionVector = pandora::CartesianVector(xpos_cm, 0., vpos_cm);
+                isSelected[iHit] = true;
             }
             else
             {
-                throw cet::exception("LArPandora") << "CreatePandoraHits2D - this wire view not recognised (View=" << hit_View << ") ";
+                ++statistics.m_nIsolationRejected;
             }
         }
-        catch (const pandora::StatusCodeException &)
+    }
+
+    for (unsigned int iHit = 0; iHit < nHits; ++iHit)
+    {
+        if (isSelected[iHit])
+        {
+            selectedHitVector.push_back(hitVector[iHit]);
+        }
+        else
+        {
+            rejectedHitVector.push_back(hitVector[iHit]);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void LArPandoraInput::CreatePandoraHits2D(const Settings &settings, const LArDriftVolumeMap &driftVolumeMap, const HitVector &hitVector, LArHitRegistry &hitRegistry)
+{
+    mf::LogDebug("LArPandora") << " *** LArPandoraInput::CreatePandoraHits2D(...) *** " << std::endl;
+
+    if (!settings.m_pPrimaryPandora)
+        throw cet::exception("LArPandora") << "CreatePandoraHits2D - primary Pandora instance does not exist ";
+
+    const pandora::Pandora *pPandora(settings.m_pPrimaryPandora);
+
+    auto const* theDetector = lar::providerFrom<detinfo::DetectorPropertiesService>();
+
+    // Per-plane and per-wire geometry is taken from the precomputed table, so the hit loop needs no geometry service calls
+    LArPandoraGeometryTable localGeometryTable;
+
+    if (!settings.m_pGeometryTable)
+        localGeometryTable.Build(driftVolumeMap, *pPandora);
+
+    const LArPandoraGeometryTable &geometryTable(settings.m_pGeometryTable ? *settings.m_pGeometryTable : localGeometryTable);
+
+    // Optionally coalesce overlapping hits on the same wire; otherwise each group is a single hit, in the original order
+    HitVector coalescedHitVector;
+    std::vector<unsigned int> groupOffsets;
+
+    if (settings.m_coalesceHits)
+        LArPandoraInput::CoalesceHits(settings, hitVector, coalescedHitVector, groupOffsets);
+
+    const bool isCoalesced(settings.m_coalesceHits);
+    const HitVector &groupedHitVector(isCoalesced ? coalescedHitVector : hitVector);
+    const unsigned int nHits(hitVector.size());
+    const unsigned int nGroups(isCoalesced ? groupOffsets.size() - 1 : nHits);
+
+    auto groupBegin = [&](const unsigned int iGroup) { return groupedHitVector.begin() + (isCoalesced ? groupOffsets[iGroup] : iGroup); };
+    auto groupEnd = [&](const unsigned int iGroup) { return groupedHitVector.begin() + (isCoalesced ? groupOffsets[iGroup + 1] : iGroup + 1); };
+
+    // Compute the calo hit parameters for all hits, in parallel, then register the hits with pandora serially, in the original order
+    std::vector<lar_content::LArCaloHitParameters> caloHitParametersVector(nGroups);
+    std::vector<HitParameterStatus> statusVector(nGroups, InvalidWithoutId);
+    std::vector<HitRejectionReason> rejectionReasonVector(nGroups, NotRejected);
+
+    // ATTN Hit pointers are resolved by CollectHits, so dereferencing them here involves no (thread-unsafe) product lookup
+    const unsigned int blockSize(1024);
+    const unsigned int nBlocks((nGroups + blockSize - 1) / blockSize);
+
+    LArPandoraParallel::ForEach(nBlocks, settings.m_nThreads, [&](const unsigned int iBlock)
+    {
+        for (unsigned int iGroup = iBlock * blockSize, iGroupEnd = std::min(nGroups, (iBlock + 1) * blockSize); iGroup < iGroupEnd; ++iGroup)
         {
-            mf::LogWarning("LArPandora") << "CreatePandoraHits2D - invalid calo hit parameter provided, all assigned values must be finite, calo hit omitted " << std::endl;
+            statusVector[iGroup] = LArPandoraInput::FillCaloHitParameters(settings, theDetector, geometryTable, groupBegin(iGroup), groupEnd(iGroup),
+                caloHitParametersVector[iGroup], rejectionReasonVector[iGroup]);
+        }
+    });
+
+    // Continue the numbering from any hits already registered (e.g. with another pandora instance)
+    int hitCounter(hitRegistry.GetMaxId());
+    hitRegistry.Reserve(hitCounter + nGroups, hitRegistry.GetNArtHits() + nHits);
+
+    lar_content::LArCaloHitFactory caloHitFactory;
+    std::vector<unsigned int> nRejectedHits(NumberOfRejectionReasons, 0);
+
+    for (unsigned int iGroup = 0; iGroup < nGroups; ++iGroup)
+    {
+        const HitParameterStatus status(statusVector[iGroup]);
+        lar_content::LArCaloHitParameters &caloHitParameters(caloHitParametersVector[iGroup]);
+
+        // ATTN Hit ids are assigned exactly as in a single serial pass: an id is used once the parameters preceding it are valid
+        if (InvalidWithoutId != status)
+            caloHitParameters.m_pParentAddress = (void*)((intptr_t)(++hitCounter));
+
+        if (Valid != status)
+        {
+            ++nRejectedHits[rejectionReasonVector[iGroup]];
             continue;
         }
 
@@ -141,19 +246,235 @@ void LArPandoraInput::CreatePandoraHits2D(const Settings &settings, const LArDri
         if (hitCounter >= settings.m_uidOffset)
             throw cet::exception("LArPandora") << "CreatePandoraHits2D - detected an excessive number of hits (" << hitCounter << ") ";
 
-        idToHitMap[hitCounter] = hit;
+        hitRegistry.AddHits(hitCounter, groupBegin(iGroup), groupEnd(iGroup));
 
-        // Create the Pandora hit
-        try
+        // Create the Pandora hit, checking the returned status code rather than converting it to an exception
+        if (pandora::STATUS_CODE_SUCCESS != PandoraApi::CaloHit::Create(*pPandora, caloHitParameters, caloHitFactory))
+            ++nRejectedHits[CreationFailed];
+    }
+
+    // Report all rejected hits together, rather than once per hit
+    if (std::accumulate(nRejectedHits.begin(), nRejectedHits.end(), 0u) > 0)
+    {
+        mf::LogWarning("LArPandora") << "CreatePandoraHits2D - calo hits omitted (invalid cell size: " << nRejectedHits[InvalidCellSize]
+                                     << ", invalid energy: " << nRejectedHits[InvalidEnergy] << ", invalid position: " << nRejectedHits[InvalidPosition]
+                                     << ", creation failed: " << nRejectedHits[CreationFailed] << ") " << std::endl;
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void LArPandoraInput::CoalesceHits(const Settings &settings, const HitVector &hitVector, HitVector &coalescedHitVector,
+    std::vector<unsigned int> &groupOffsets)
+{
+    const unsigned int nHits(hitVector.size());
+
+    // Order the hits by wire and start time, so that the hits to be coalesced are adjacent
+    std::vector<unsigned int> sortedIndices(nHits);
+
+    for (unsigned int iHit = 0; iHit < nHits; ++iHit)
+        sortedIndices[iHit] = iHit;
+
+    std::sort(sortedIndices.begin(), sortedIndices.end(), [&hitVector](const unsigned int lhs, const unsigned int rhs)
+    {
+        const recob::Hit &lhsHit(*hitVector[lhs]), &rhsHit(*hitVector[rhs]);
+        return (std::make_tuple(lhsHit.WireID(), lhsHit.PeakTimeMinusRMS(), lhs) < std::make_tuple(rhsHit.WireID(), rhsHit.PeakTimeMinusRMS(), rhs));
+    });
+
+    // Sweep each wire, starting a new group whenever a hit starts beyond the end of the current group, or would take the group beyond its
+    // maximum time span or number of hits
+    std::vector<unsigned int> groupIds(nHits, 0);
+    unsigned int nGroups(0), nGroupHits(0);
+    float groupStartTime(0.f), groupEndTime(0.f);
+
+    for (unsigned int iSorted = 0; iSorted < nHits; ++iSorted)
+    {
+        const recob::Hit &hit(*hitVector[sortedIndices[iSorted]]);
+        const bool isNewWire((0 == iSorted) || (hit.WireID() != hitVector[sortedIndices[iSorted - 1]]->WireID()));
+        const bool isBeyondGap(!isNewWire && (hit.PeakTimeMinusRMS() > groupEndTime + settings.m_hitCoalescenceTimeGap));
+        const bool isBeyondSpan(!isNewWire && (settings.m_hitCoalescenceMaxSpan > 0.) &&
+            (std::max(groupEndTime, hit.PeakTimePlusRMS()) - groupStartTime > settings.m_hitCoalescenceMaxSpan));
+        const bool isBeyondHits(!isNewWire && (settings.m_hitCoalescenceMaxHits > 0) && (nGroupHits >= settings.m_hitCoalescenceMaxHits));
+
+        if (isNewWire || isBeyondGap || isBeyondSpan || isBeyondHits)
         {
-            PANDORA_THROW_RESULT_IF(pandora::STATUS_CODE_SUCCESS, !=, PandoraApi::CaloHit::Create(*pPandora, caloHitParameters, caloHitFactory));
+            ++nGroups;
+            nGroupHits = 1;
+            groupStartTime = hit.PeakTimeMinusRMS();
+            groupEndTime = hit.PeakTimePlusRMS();
         }
-        catch (const pandora::StatusCodeException &)
+        else
         {
-            mf::LogWarning("LArPandora") << "CreatePandoraHits2D - unable to create calo hit, insufficient or invalid information supplied " << std::endl;
-            continue;
+            ++nGroupHits;
+            groupEndTime = std::max(groupEndTime, hit.PeakTimePlusRMS());
         }
+
+        groupIds[sortedIndices[iSorted]] = nGroups - 1;
+    }
+
+    // Number the groups by their first hit in the input order, and place the representative hit of each group first
+    std::vector<unsigned int> groupOrder(nGroups, std::numeric_limits<unsigned int>::max()), groupSizes(nGroups, 0);
+    std::vector<unsigned int> representatives(nGroups, 0);
+    unsigned int nOrderedGroups(0);
+
+    for (unsigned int iHit = 0; iHit < nHits; ++iHit)
+    {
+        const unsigned int groupId(groupIds[iHit]);
+
+        if (std::numeric_limits<unsigned int>::max() == groupOrder[groupId])
+        {
+            groupOrder[groupId] = nOrderedGroups++;
+            representatives[groupId] = iHit;
+        }
+        else if (hitVector[iHit]->Integral() > hitVector[representatives[groupId]]->Integral())
+        {
+            representatives[groupId] = iHit;
+        }
+
+        ++groupSizes[groupOrder[groupId]];
+    }
+
+    groupOffsets.assign(nGroups + 1, 0);
+
+    for (unsigned int iGroup = 0; iGroup < nGroups; ++iGroup)
+        groupOffsets[iGroup + 1] = groupOffsets[iGroup] + groupSizes[iGroup];
+
+    coalescedHitVector.resize(nHits);
+    std::vector<unsigned int> nextPositions(groupOffsets.begin(), groupOffsets.end() - 1);
+
+    for (unsigned int iGroup = 0; iGroup < nGroups; ++iGroup)
+        coalescedHitVector[nextPositions[groupOrder[iGroup]]++] = hitVector[representatives[iGroup]];
+
+    for (unsigned int iHit = 0; iHit < nHits; ++iHit)
+    {
+        const unsigned int groupId(groupIds[iHit]);
+
+        if (iHit != representatives[groupId])
+            coalescedHitVector[nextPositions[groupOrder[groupId]]++] = hitVector[iHit];
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+LArPandoraInput::HitParameterStatus LArPandoraInput::FillCaloHitParameters(const Settings &settings,
+    const detinfo::DetectorProperties *const pDetectorProperties, const LArPandoraGeometryTable &geometryTable,
+    const HitVector::const_iterator hitBegin, const HitVector::const_iterator hitEnd, lar_content::LArCaloHitParameters &caloHitParameters,
+    HitRejectionReason &rejectionReason)
+{
+    const art::Ptr<recob::Hit> &hit(*hitBegin);
+    const geo::WireID hit_WireID(hit->WireID());
+
+    // Get basic hit properties (view, time, charge), combining any coalesced hits
+    const geo::View_t hit_View(hit->View());
+    const double hit_Time(hit->PeakTime());
+    double hit_Charge(hit->Integral());
+    double hit_TimeStart(hit->PeakTimeMinusRMS());
+    double hit_TimeEnd(hit->PeakTimePlusRMS());
+
+    for (HitVector::const_iterator hitIter = hitBegin + 1; hitIter != hitEnd; ++hitIter)
+    {
+        hit_Charge += (*hitIter)->Integral();
+        hit_TimeStart = std::min(hit_TimeStart, static_cast<double>((*hitIter)->PeakTimeMinusRMS()));
+        hit_TimeEnd = std::max(hit_TimeEnd, static_cast<double>((*hitIter)->PeakTimePlusRMS()));
+    }
+
+    // Get hit X coordinate and, if using a single global drift volume, remove any out-of-time hits here
+    const LArPlaneGeometry &planeGeometry(geometryTable.GetPlane(hit_WireID));
+    const double xpos_cm(planeGeometry.ConvertTicksToX(hit_Time));
+
+    // ATTN A coalesced group has its cell centred on the representative peak time, so the hit position (and any derived T0) is unchanged
+    const double xposStart_cm(planeGeometry.ConvertTicksToX(hit_TimeStart)), xposEnd_cm(planeGeometry.ConvertTicksToX(hit_TimeEnd));
+    const double dxpos_cm((hitBegin + 1 == hitEnd) ? std::fabs(xposEnd_cm - xposStart_cm) :
+        2. * std::max(std::fabs(xpos_cm - xposStart_cm), std::fabs(xposEnd_cm - xpos_cm)));
+
+    // Get hit wire coordinate (U, V or W in the global view), based on central position of wire
+    const double wirepos_cm(geometryTable.GetWireCoordinate(planeGeometry, hit_WireID.Wire));
+
+    // Get other hit properties here
+    const double wire_pitch_cm(planeGeometry.GetWirePitch()); // cm
+    const double mips(LArPandoraInput::GetMips(settings, pDetectorProperties, hit_Charge, wire_pitch_cm));
+
+    const double cellSize1_cm(settings.m_useHitWidths ? dxpos_cm : settings.m_dx_cm);
+    const double nCellRadiationLengths(settings.m_dx_cm / settings.m_rad_cm);
+    const double nCellInteractionLengths(settings.m_dx_cm / settings.m_int_cm);
+    const double electromagneticEnergy(mips * settings.m_mips_to_gev);
+
+    // Screen the parameters explicitly, in the order in which they are assigned, so invalid hits are rejected without pandora exceptions
+    rejectionReason = NotRejected;
+
+    if (!LArPandoraInput::IsValidParameter(settings.m_dx_cm) || !LArPandoraInput::IsValidParameter(cellSize1_cm) ||
+        !LArPandoraInput::IsValidParameter(wire_pitch_cm) || !LArPandoraInput::IsValidParameter(nCellRadiationLengths) ||
+        !LArPandoraInput::IsValidParameter(nCellInteractionLengths))
+    {
+        rejectionReason = InvalidCellSize;
+        return InvalidWithoutId;
+    }
+
+    if (!LArPandoraInput::IsValidParameter(hit_Charge) || !LArPandoraInput::IsValidParameter(mips) ||
+        !LArPandoraInput::IsValidParameter(electromagneticEnergy))
+    {
+        rejectionReason = InvalidEnergy;
+        return InvalidWithoutId;
+    }
+
+    // ATTN The parent address precedes the position in the assignment order, so hits with an invalid position still use a hit id
+    if (!LArPandoraInput::IsValidParameter(xpos_cm) || !LArPandoraInput::IsValidParameter(wirepos_cm))
+    {
+        rejectionReason = InvalidPosition;
+        return InvalidWithId;
+    }
+
+    // Fill Pandora CaloHit parameters (the parent address is assigned later, by the caller)
+    caloHitParameters.m_expectedDirection = pandora::CartesianVector(0., 0., 1.);
+    caloHitParameters.m_cellNormalVector = pandora::CartesianVector(0., 0., 1.);
+    caloHitParameters.m_cellSize0 = settings.m_dx_cm;
+    caloHitParameters.m_cellSize1 = cellSize1_cm;
+    caloHitParameters.m_cellThickness = wire_pitch_cm;
+    caloHitParameters.m_cellGeometry = pandora::RECTANGULAR;
+    caloHitParameters.m_time = 0.;
+    caloHitParameters.m_nCellRadiationLengths = nCellRadiationLengths;
+    caloHitParameters.m_nCellInteractionLengths = nCellInteractionLengths;
+    caloHitParameters.m_isDigital = false;
+    caloHitParameters.m_hitRegion = pandora::SINGLE_REGION;
+    caloHitParameters.m_layer = 0;
+    caloHitParameters.m_isInOuterSamplingLayer = false;
+    caloHitParameters.m_inputEnergy = hit_Charge;
+    caloHitParameters.m_mipEquivalentEnergy = mips;
+    caloHitParameters.m_electromagneticEnergy = electromagneticEnergy;
+    caloHitParameters.m_hadronicEnergy = electromagneticEnergy;
+    caloHitParameters.m_larTPCVolumeId = planeGeometry.GetVolumeId();
+
+    const geo::View_t pandora_View(planeGeometry.GetGlobalView());
+
+    if (pandora_View == geo::kW)
+    {
+        caloHitParameters.m_hitType = pandora::TPC_VIEW_W;
+        caloHitParameters.m_positionVector = pandora::CartesianVector(xpos_cm, 0., wirepos_cm);
+    }
+    else if(pandora_View == geo::kU)
+    {
+        caloHitParameters.m_hitType = pandora::TPC_VIEW_U;
+        caloHitParameters.m_positionVector = pandora::CartesianVector(xpos_cm, 0., wirepos_cm);
     }
+    else if(pandora_View == geo::kV)
+    {
+        caloHitParameters.m_hitType = pandora::TPC_VIEW_V;
+        caloHitParameters.m_positionVector = pandora::CartesianVector(xpos_cm, 0., wirepos_cm);
+    }
+    else
+    {
+        throw cet::exception("LArPandora") << "CreatePandoraHits2D - this wire view not recognised (View=" << hit_View << ") ";
+    }
+
+    return Valid;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+bool LArPandoraInput::IsValidParameter(const double value)
+{
+    // ATTN Pandora stores single precision values, so a finite double beyond the float range is also invalid
+    return std::isfinite(static_cast<float>(value));
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
@@ -249,12 +570,12 @@ void LArPandoraInput::CreatePandoraDetectorGaps(const Settings &settings, const
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
-void LArPandoraInput::CreatePandoraReadoutGaps(const Settings &settings, const LArDriftVolumeMap &driftVolumeMap)
+void LArPandoraInput::LoadReadoutGaps(const Settings &settings, const LArDriftVolumeMap &driftVolumeMap, ReadoutGapList &readoutGapList)
 {
-    mf::LogDebug("LArPandora") << " *** LArPandoraInput::CreatePandoraReadoutGaps(...) *** " << std::endl;
+    mf::LogDebug("LArPandora") << " *** LArPandoraInput::LoadReadoutGaps(...) *** " << std::endl;
 
     if (!settings.m_pPrimaryPandora)
-        throw cet::exception("LArPandora") << "CreatePandoraReadoutGaps - primary Pandora instance does not exist ";
+        throw cet::exception("LArPandora") << "LoadReadoutGaps - primary Pandora instance does not exist ";
 
     const pandora::Pandora *pPandora(settings.m_pPrimaryPandora);
 
@@ -299,67 +620,48 @@ void LArPandoraInput::CreatePandoraReadoutGaps(const Settings &settings, const L
 
                     firstBadWire = -1; lastBadWire = -1;
 
-                    PandoraApi::Geometry::LineGap::Parameters parameters;
+                    float lineStartX(-std::numeric_limits<float>::max());
+                    float lineEndX(std::numeric_limits<float>::max());
 
-                    try
+                    const unsigned int volumeId(LArPandoraGeometry::GetVolumeID(driftVolumeMap, icstat, itpc));
+                    LArDriftVolumeMap::const_iterator volumeIter(driftVolumeMap.find(volumeId));
+
+                    if (driftVolumeMap.end() != volumeIter)
                     {
-                        parameters.m_lineStartX = -std::numeric_limits<float>::max();
-                        parameters.m_lineEndX = std::numeric_limits<float>::max();
-
-                        const unsigned int volumeId(LArPandoraGeometry::GetVolumeID(driftVolumeMap, icstat, itpc));
-                        LArDriftVolumeMap::const_iterator volumeIter(driftVolumeMap.find(volumeId));
-
-                        if (driftVolumeMap.end() != volumeIter)
-                        {
-                            parameters.m_lineStartX = volumeIter->second.GetCenterX() - 0.5f * volumeIter->second.GetWidthX();
-                            parameters.m_lineEndX = volumeIter->second.GetCenterX() + 0.5f * volumeIter->second.GetWidthX();
-                        }
-
-                        const geo::View_t iview = (geo::View_t)iplane;
-                        const geo::View_t pandoraView(LArPandoraGeometry::GetGlobalView(icstat, itpc, iview));
-
-                        if (pandoraView == geo::kW)
-                        {
-                            const float firstW(firstXYZ[2]);
-                            const float lastW(lastXYZ[2]);
-
-                            parameters.m_lineGapType = pandora::TPC_WIRE_GAP_VIEW_W;
-                            parameters.m_lineStartZ = std::min(firstW, lastW) - halfWirePitch;
-                            parameters.m_lineEndZ = std::max(firstW, lastW) + halfWirePitch;
-                        }
-                        else if (pandoraView == geo::kU)
-                        {
-                            const float firstU(pPandora->GetPlugins()->GetLArTransformationPlugin()->YZtoU(firstXYZ[1], firstXYZ[2]));
-                            const float lastU(pPandora->GetPlugins()->GetLArTransformationPlugin()->YZtoU(lastXYZ[1], lastXYZ[2]));
-
-                            parameters.m_lineGapType = pandora::TPC_WIRE_GAP_VIEW_U;
-                            parameters.m_lineStartZ = std::min(firstU, lastU) - halfWirePitch;
-                            parameters.m_lineEndZ = std::max(firstU, lastU) + halfWirePitch;
-                        }
-                        else if (pandoraView == geo::kV)
-                        {
-                            const float firstV(pPandora->GetPlugins()->GetLArTransformationPlugin()->YZtoV(firstXYZ[1], firstXYZ[2]));
-                            const float lastV(pPandora->GetPlugins()->GetLArTransformationPlugin()->YZtoV(lastXYZ[1], lastXYZ[2]));
-
-                            parameters.m_lineGapType = pandora::TPC_WIRE_GAP_VIEW_V;
-                            parameters.m_lineStartZ = std::min(firstV, lastV) - halfWirePitch;
-                            parameters.m_lineEndZ = std::max(firstV, lastV) + halfWirePitch;
-                        }
+                        lineStartX = volumeIter->second.GetCenterX() - 0.5f * volumeIter->second.GetWidthX();
+                        lineEndX = volumeIter->second.GetCenterX() + 0.5f * volumeIter->second.GetWidthX();
                     }
-                    catch (const pandora::StatusCodeException &)
+
+                    const geo::View_t iview = (geo::View_t)iplane;
+                    const geo::View_t pandoraView(LArPandoraGeometry::GetGlobalView(icstat, itpc, iview));
+
+                    if (pandoraView == geo::kW)
                     {
-                        mf::LogWarning("LArPandora") << "CreatePandoraReadoutGaps - invalid line gap parameter provided, all assigned values must be finite, line gap omitted " << std::endl;
-                        continue;
+                        const float firstW(firstXYZ[2]);
+                        const float lastW(lastXYZ[2]);
+
+                        readoutGapList.push_back(ReadoutGap(pandora::TPC_WIRE_GAP_VIEW_W, lineStartX, lineEndX, std::min(firstW, lastW) - halfWirePitch,
+                            std::max(firstW, lastW) + halfWirePitch));
                     }
+                    else if (pandoraView == geo::kU)
+                    {
+                        const float firstU(pPandora->GetPlugins()->GetLArTransformationPlugin()->YZtoU(firstXYZ[1], firstXYZ[2]));
+                        const float lastU(pPandora->GetPlugins()->GetLArTransformationPlugin()->YZtoU(lastXYZ[1], lastXYZ[2]));
 
-                    try
+                        readoutGapList.push_back(ReadoutGap(pandora::TPC_WIRE_GAP_VIEW_U, lineStartX, lineEndX, std::min(firstU, lastU) - halfWirePitch,
+                            std::max(firstU, lastU) + halfWirePitch));
+                    }
+                    else if (pandoraView == geo::kV)
                     {
-                        PANDORA_THROW_RESULT_IF(pandora::STATUS_CODE_SUCCESS, !=, PandoraApi::Geometry::LineGap::Create(*pPandora, parameters));
+                        const float firstV(pPandora->GetPlugins()->GetLArTransformationPlugin()->YZtoV(firstXYZ[1], firstXYZ[2]));
+                        const float lastV(pPandora->GetPlugins()->GetLArTransformationPlugin()->YZtoV(lastXYZ[1], lastXYZ[2]));
+
+                        readoutGapList.push_back(ReadoutGap(pandora::TPC_WIRE_GAP_VIEW_V, lineStartX, lineEndX, std::min(firstV, lastV) - halfWirePitch,
+                            std::max(firstV, lastV) + halfWirePitch));
                     }
-                    catch (const pandora::StatusCodeException &)
+                    else
                     {
-                        mf::LogWarning("LArPandora") << "CreatePandoraReadoutGaps - unable to create line gap, insufficient or invalid information supplied " << std::endl;
-                        continue;
+                        mf::LogWarning("LArPandora") << "LoadReadoutGaps - unable to create line gap, insufficient or invalid information supplied " << std::endl;
                     }
                 }
             }
@@ -369,6 +671,181 @@ void LArPandoraInput::CreatePandoraReadoutGaps(const Settings &settings, const L
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
+void LArPandoraInput::CreatePandoraReadoutGaps(const Settings &settings, const ReadoutGapList &readoutGapList)
+{
+    mf::LogDebug("LArPandora") << " *** LArPandoraInput::CreatePandoraReadoutGaps(...) *** " << std::endl;
+
+    if (!settings.m_pPrimaryPandora)
+        throw cet::exception("LArPandora") << "CreatePandoraReadoutGaps - primary Pandora instance does not exist ";
+
+    const pandora::Pandora *pPandora(settings.m_pPrimaryPandora);
+
+    for (const ReadoutGap &readoutGap : readoutGapList)
+    {
+        PandoraApi::Geometry::LineGap::Parameters parameters;
+
+        try
+        {
+            parameters.m_lineGapType = static_cast<pandora::LineGapType>(readoutGap.m_lineGapType);
+            parameters.m_lineStartX = readoutGap.m_lineStartX;
+            parameters.m_lineEndX = readoutGap.m_lineEndX;
+            parameters.m_lineStartZ = readoutGap.m_lineStartZ;
+            parameters.m_lineEndZ = readoutGap.m_lineEndZ;
+        }
+        catch (const pandora::StatusCodeException &)
+        {
+            mf::LogWarning("LArPandora") << "CreatePandoraReadoutGaps - invalid line gap parameter provided, all assigned values must be finite, line gap omitted " << std::endl;
+            continue;
+        }
+
+        try
+        {
+            PANDORA_THROW_RESULT_IF(pandora::STATUS_CODE_SUCCESS, !=, PandoraApi::Geometry::LineGap::Create(*pPandora, parameters));
+        }
+        catch (const pandora::StatusCodeException &)
+        {
+            mf::LogWarning("LArPandora") << "CreatePandoraReadoutGaps - unable to create line gap, insufficient or invalid information supplied " << std::endl;
+            continue;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+std::uint64_t LArPandoraInput::GetReadoutGapKey(const LArDriftVolumeMap &driftVolumeMap)
+{
+    art::ServiceHandle<geo::Geometry> theGeometry;
+    const lariov::ChannelStatusProvider &channelStatus(art::ServiceHandle<lariov::ChannelStatusService>()->GetProvider());
+
+    // ATTN The version tag must change whenever the gap calculation or the cache file format changes
+    const unsigned int readoutGapVersion(2);
+    std::uint64_t key(14695981039346656037ULL);
+    LArPandoraInput::AddToHash(readoutGapVersion, key);
+
+    for (const char character : theGeometry->DetectorName())
+        LArPandoraInput::AddToHash(character, key);
+
+    LArPandoraInput::AddToHash(static_cast<unsigned int>(theGeometry->Nchannels()), key);
+
+    // The wire positions used for the gap boundaries
+    for (unsigned int icstat = 0; icstat < theGeometry->Ncryostats(); ++icstat)
+    {
+        for (unsigned int itpc = 0; itpc < theGeometry->NTPC(icstat); ++itpc)
+        {
+            const geo::TPCGeo &TPC(theGeometry->TPC(itpc, icstat));
+
+            for (unsigned int iplane = 0; iplane < TPC.Nplanes(); ++iplane)
+            {
+                const geo::PlaneGeo &plane(TPC.Plane(iplane));
+                const unsigned int nWires(plane.Nwires());
+                LArPandoraInput::AddToHash(static_cast<int>(plane.View()), key);
+                LArPandoraInput::AddToHash(nWires, key);
+                LArPandoraInput::AddToHash(theGeometry->WirePitch(plane.View()), key);
+
+                if (0 == nWires)
+                    continue;
+
+                double firstXYZ[3], lastXYZ[3];
+                plane.Wire(0).GetCenter(firstXYZ);
+                plane.Wire(nWires - 1).GetCenter(lastXYZ);
+
+                for (unsigned int axis = 0; axis < 3; ++axis)
+                {
+                    LArPandoraInput::AddToHash(firstXYZ[axis], key);
+                    LArPandoraInput::AddToHash(lastXYZ[axis], key);
+                }
+            }
+        }
+    }
+
+    // The drift volume extents used for the gap x ranges
+    for (const LArDriftVolumeMap::value_type &driftVolumeEntry : driftVolumeMap)
+    {
+        LArPandoraInput::AddToHash(driftVolumeEntry.first, key);
+        LArPandoraInput::AddToHash(driftVolumeEntry.second.GetVolumeID(), key);
+        LArPandoraInput::AddToHash(driftVolumeEntry.second.GetCenterX(), key);
+        LArPandoraInput::AddToHash(driftVolumeEntry.second.GetWidthX(), key);
+    }
+
+    // ATTN The bad channel list stands in for a channel status version, which the provider does not expose
+    for (const raw::ChannelID_t channel : channelStatus.BadChannels())
+        LArPandoraInput::AddToHash(channel, key);
+
+    return key;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+template <typename T>
+void LArPandoraInput::AddToHash(const T &value, std::uint64_t &hash)
+{
+    const unsigned char *const pBytes(reinterpret_cast<const unsigned char*>(&value));
+
+    for (std::size_t iByte = 0; iByte < sizeof(T); ++iByte)
+    {
+        hash ^= pBytes[iByte];
+        hash *= 1099511628211ULL;
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+bool LArPandoraInput::ReadReadoutGaps(const std::string &fileName, const std::uint64_t key, ReadoutGapList &readoutGapList)
+{
+    std::ifstream inputFile(fileName);
+
+    std::string header;
+    std::uint64_t fileKey(0);
+    unsigned int nGaps(0);
+
+    if (!(inputFile >> header >> fileKey >> nGaps) || ("LArPandoraReadoutGaps" != header) || (key != fileKey))
+        return false;
+
+    ReadoutGapList fileReadoutGapList;
+
+    for (unsigned int iGap = 0; iGap < nGaps; ++iGap)
+    {
+        int lineGapType(0);
+        float lineStartX(0.f), lineEndX(0.f), lineStartZ(0.f), lineEndZ(0.f);
+
+        if (!(inputFile >> lineGapType >> lineStartX >> lineEndX >> lineStartZ >> lineEndZ))
+        {
+            mf::LogWarning("LArPandora") << "ReadReadoutGaps - readout gap cache file " << fileName << " is truncated, ignoring it " << std::endl;
+            return false;
+        }
+
+        fileReadoutGapList.push_back(ReadoutGap(lineGapType, lineStartX, lineEndX, lineStartZ, lineEndZ));
+    }
+
+    readoutGapList.insert(readoutGapList.end(), fileReadoutGapList.begin(), fileReadoutGapList.end());
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void LArPandoraInput::WriteReadoutGaps(const std::string &fileName, const std::uint64_t key, const ReadoutGapList &readoutGapList)
+{
+    std::ofstream outputFile(fileName);
+
+    if (!outputFile)
+    {
+        mf::LogWarning("LArPandora") << "WriteReadoutGaps - unable to write readout gap cache file " << fileName << std::endl;
+        return;
+    }
+
+    // ATTN Write enough digits for the float values to be read back exactly
+    outputFile << std::setprecision(std::numeric_limits<float>::max_digits10);
+    outputFile << "LArPandoraReadoutGaps " << key << " " << readoutGapList.size() << std::endl;
+
+    for (const ReadoutGap &readoutGap : readoutGapList)
+    {
+        outputFile << readoutGap.m_lineGapType << " " << readoutGap.m_lineStartX << " " << readoutGap.m_lineEndX << " "
+                   << readoutGap.m_lineStartZ << " " << readoutGap.m_lineEndZ << std::endl;
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
 void LArPandoraInput::CreatePandoraMCParticles(const Settings &settings, const MCTruthToMCParticles &truthToParticleMap,
     const MCParticlesToMCTruth &particleToTruthMap, const RawMCParticleVector &generatorMCParticleVector)
 {
@@ -469,9 +946,17 @@ void LArPandoraInput::CreatePandoraMCParticles(const Settings &settings, const M
     // Loop over G4 particles
     int particleCounter(0);
 
+    // Trajectory points are classified as inside or outside the tpcs using the bounding box index, in one pass per particle
+    LArPandoraTPCIndex localTPCIndex;
+
+    if (!settings.m_pTPCIndex)
+        localTPCIndex.Build();
+
+    const LArPandoraTPCIndex &tpcIndex(settings.m_pTPCIndex ? *settings.m_pTPCIndex : localTPCIndex);
+
     // Find Primary Generator Particles
-    std::map<const simb::MCParticle, bool> primaryGeneratorMCParticleMap;
-    LArPandoraInput::FindPrimaryParticles(generatorMCParticleVector, primaryGeneratorMCParticleMap);
+    PrimaryMCParticleIndex primaryGeneratorMCParticleIndex;
+    LArPandoraInput::FindPrimaryParticles(generatorMCParticleVector, primaryGeneratorMCParticleIndex);
 
     for (MCParticleMap::const_iterator iterI = particleMap.begin(), iterEndI = particleMap.end(); iterI != iterEndI; ++iterI)
     {
@@ -487,7 +972,7 @@ void LArPandoraInput::CreatePandoraMCParticles(const Settings &settings, const M
 
         // Find start and end trajectory points
         int firstT(-1), lastT(-1);
-        LArPandoraInput::GetTrueStartAndEndPoints(settings, particle, firstT, lastT);
+        tpcIndex.GetStartAndEndPoints(*particle, firstT, lastT);
 
         if (firstT < 0 && lastT < 0)
         {
@@ -513,7 +998,7 @@ void LArPandoraInput::CreatePandoraMCParticles(const Settings &settings, const M
         const int trackID(particle->TrackId());
         const simb::Origin_t origin(particleInventoryService->TrackIdToMCTruth(trackID).Origin());
 
-        if (LArPandoraInput::IsPrimaryMCParticle(particle, primaryGeneratorMCParticleMap))
+        if (LArPandoraInput::IsPrimaryMCParticle(particle, primaryGeneratorMCParticleIndex))
         {
             nuanceCode = 2001;
         }
@@ -580,42 +1065,69 @@ void LArPandoraInput::CreatePandoraMCParticles(const Settings &settings, const M
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
-void LArPandoraInput::FindPrimaryParticles(const RawMCParticleVector &mcParticleVector, std::map<const simb::MCParticle, bool> &primaryMCParticleMap)  
+void LArPandoraInput::SelectMCParticlesWithHits(const LArHitTruthTable &hitTruthTable, const MCTruthToMCParticles &truthToParticles,
+    const MCParticlesToMCTruth &particlesToTruth, MCTruthToMCParticles &selectedTruthToParticles, MCParticlesToMCTruth &selectedParticlesToTruth)
 {
-    for (const simb::MCParticle &mcParticle : mcParticleVector)
+    MCParticleMap particleMap;
+
+    for (MCParticlesToMCTruth::const_iterator iter = particlesToTruth.begin(), iterEnd = particlesToTruth.end(); iter != iterEnd; ++iter)
+        particleMap[iter->first->TrackId()] = iter->first;
+
+    // Collect the track ids referenced by the hits, then walk up each ancestor chain until reaching an id already selected or the MC truth
+    std::unordered_set<int> selectedTrackIds;
+
+    for (const LArHitTruthTable::Entry &entry : hitTruthTable.GetEntries())
     {
-        if ("primary" == mcParticle.Process())
+        // ATTN Use the same (absolute) track id as CreatePandoraMCLinks2D
+        MCParticleMap::const_iterator particleIter(particleMap.find(std::abs(entry.m_trackID)));
+
+        while ((particleMap.end() != particleIter) && selectedTrackIds.insert(particleIter->first).second)
+            particleIter = particleMap.find(particleIter->second->Mother());
+    }
+
+    for (MCTruthToMCParticles::const_iterator iter = truthToParticles.begin(), iterEnd = truthToParticles.end(); iter != iterEnd; ++iter)
+    {
+        MCParticleVector &selectedParticleVector(selectedTruthToParticles[iter->first]);
+
+        for (const art::Ptr<simb::MCParticle> &particle : iter->second)
         {
-            primaryMCParticleMap.emplace(std::make_pair(mcParticle, false));
+            if (selectedTrackIds.count(particle->TrackId()))
+                selectedParticleVector.push_back(particle);
         }
     }
+
+    for (MCParticlesToMCTruth::const_iterator iter = particlesToTruth.begin(), iterEnd = particlesToTruth.end(); iter != iterEnd; ++iter)
+    {
+        if (selectedTrackIds.count(iter->first->TrackId()))
+            selectedParticlesToTruth.insert(*iter);
+    }
+
+    mf::LogDebug("LArPandora") << "   Selected " << selectedParticlesToTruth.size() << " of " << particlesToTruth.size() << " mc particles with hits " << std::endl;
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
-bool LArPandoraInput::IsPrimaryMCParticle(const art::Ptr<simb::MCParticle> &mcParticle, std::map<const simb::MCParticle, bool> &primaryMCParticleMap) 
+void LArPandoraInput::FindPrimaryParticles(const RawMCParticleVector &mcParticleVector, PrimaryMCParticleIndex &primaryMCParticleIndex)
 {
-    for (auto &mcParticleIter : primaryMCParticleMap)
+    for (const simb::MCParticle &mcParticle : mcParticleVector)
     {
-        if (!mcParticleIter.second)
+        if ("primary" == mcParticle.Process())
         {
-            const simb::MCParticle primaryMCParticle(mcParticleIter.first);
-
-            if (std::fabs(primaryMCParticle.Px() - mcParticle->Px()) < std::numeric_limits<double>::epsilon() && 
-                std::fabs(primaryMCParticle.Py() - mcParticle->Py()) < std::numeric_limits<double>::epsilon() && 
-                std::fabs(primaryMCParticle.Pz() - mcParticle->Pz()) < std::numeric_limits<double>::epsilon())
-            {
-                mcParticleIter.second = true;
-                return true;
-            }
+            primaryMCParticleIndex.AddParticle(mcParticle);
         }
     }
-    return false;
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
-void LArPandoraInput::CreatePandoraMCLinks2D(const Settings &settings, const IdToHitMap &idToHitMap, const HitsToTrackIDEs &hitToParticleMap)
+bool LArPandoraInput::IsPrimaryMCParticle(const art::Ptr<simb::MCParticle> &mcParticle, PrimaryMCParticleIndex &primaryMCParticleIndex)
+{
+    return primaryMCParticleIndex.ConsumeMatch(*mcParticle);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void LArPandoraInput::CreatePandoraMCLinks2D(const Settings &settings, const LArHitRegistry &hitRegistry, const LArHitTruthTable &hitTruthTable)
 {
     mf::LogDebug("LArPandora") << " *** LArPandoraInput::CreatePandoraMCLinks(...) *** " << std::endl;
 
@@ -624,99 +1136,86 @@ void LArPandoraInput::CreatePandoraMCLinks2D(const Settings &settings, const IdT
 
     const pandora::Pandora *pPandora(settings.m_pPrimaryPandora);
 
-    for (IdToHitMap::const_iterator iterI = idToHitMap.begin(), iterEndI = idToHitMap.end(); iterI != iterEndI ; ++iterI)
-    {
-        const int hitID(iterI->first);
-        const art::Ptr<recob::Hit> hit(iterI->second);
-      //  const geo::WireID hit_WireID(hit->WireID());
-
-        // Get list of associated MC particles
-        HitsToTrackIDEs::const_iterator iterJ = hitToParticleMap.find(hit);
+    TrackIDEVector coalescedTrackIDEs;
 
-        if (hitToParticleMap.end() == iterJ)
+    for (int hitID = 1; hitID <= hitRegistry.GetMaxId(); ++hitID)
+    {
+        if (!hitRegistry.HasHit(hitID))
             continue;
 
-        const TrackIDEVector &trackCollection = iterJ->second;
+        LArHitRegistry::HitPtrVector::const_iterator hitBegin(hitRegistry.Begin(hitID)), hitEnd(hitRegistry.End(hitID));
 
-        if (trackCollection.size() == 0)
-            throw cet::exception("LArPandora") << "CreatePandoraMCLinks2D - found a hit without any associated MC truth information ";
-
-        // Create links between hits and MC particles
-        for (unsigned int k = 0; k < trackCollection.size(); ++k)
+        // ATTN For coalesced hits, the energy fractions are recomputed from the deposits summed over all the coalesced ART hits
+        if (std::next(hitBegin) != hitEnd)
         {
-            const sim::TrackIDE trackIDE(trackCollection.at(k));
-            const int trackID(std::abs(trackIDE.trackID)); // TODO: Find out why std::abs is needed
-            const float energyFrac(trackIDE.energyFrac);
+            LArPandoraInput::GetCoalescedTrackIDEs(hitTruthTable, hitBegin, hitEnd, coalescedTrackIDEs);
 
-            try
-            {
-                PANDORA_THROW_RESULT_IF(pandora::STATUS_CODE_SUCCESS, !=, PandoraApi::SetCaloHitToMCParticleRelationship(*pPandora,
-                    (void*)((intptr_t)hitID), (void*)((intptr_t)trackID), energyFrac));
-            }
-            catch (const pandora::StatusCodeException &)
-            {
-                mf::LogWarning("LArPandora") << "CreatePandoraMCLinks2D - unable to create calo hit to mc particle relationship, invalid information supplied " << std::endl;
-                continue;
-            }
+            for (const sim::TrackIDE &trackIDE : coalescedTrackIDEs)
+                LArPandoraInput::CreatePandoraMCLink2D(*pPandora, hitID, trackIDE.trackID, trackIDE.energyFrac);
+
+            continue;
         }
+
+        const art::Ptr<recob::Hit> &hit(*hitBegin);
+
+        // Create links between hits and MC particles
+        for (LArHitTruthTable::EntryList::const_iterator iter = hitTruthTable.Begin(hit.key()), iterEnd = hitTruthTable.End(hit.key()); iter != iterEnd; ++iter)
+            LArPandoraInput::CreatePandoraMCLink2D(*pPandora, hitID, iter->m_trackID, iter->m_energyFrac);
     }
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
-void LArPandoraInput::GetTrueStartAndEndPoints(const Settings &settings, const art::Ptr<simb::MCParticle> &particle, int &firstT, int &lastT)
+void LArPandoraInput::CreatePandoraMCLink2D(const pandora::Pandora &pandora, const int hitID, const int trackID, const float energyFrac)
 {
-    art::ServiceHandle<geo::Geometry> theGeometry;
-    firstT = -1;  lastT  = -1;
-
-    for (unsigned int icstat = 0; icstat < theGeometry->Ncryostats(); ++icstat)
+    try
     {
-        for (unsigned int itpc = 0; itpc < theGeometry->NTPC(icstat); ++itpc)
-        {
-            int thisfirstT(-1), thislastT(-1);
-            LArPandoraInput::GetTrueStartAndEndPoints(icstat, itpc, particle, thisfirstT, thislastT);
-
-            if (thisfirstT < 0)
-                continue;
-
-            if (firstT < 0 || thisfirstT < firstT)
-                firstT = thisfirstT;
-
-            if (lastT < 0 || thislastT > lastT)
-                lastT = thislastT;
-        }
+        // TODO: Find out why std::abs is needed
+        PANDORA_THROW_RESULT_IF(pandora::STATUS_CODE_SUCCESS, !=, PandoraApi::SetCaloHitToMCParticleRelationship(pandora,
+            (void*)((intptr_t)hitID), (void*)((intptr_t)std::abs(trackID)), energyFrac));
+    }
+    catch (const pandora::StatusCodeException &)
+    {
+        mf::LogWarning("LArPandora") << "CreatePandoraMCLinks2D - unable to create calo hit to mc particle relationship, invalid information supplied " << std::endl;
     }
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
-void LArPandoraInput::GetTrueStartAndEndPoints(const unsigned int cstat, const unsigned int tpc, const art::Ptr<simb::MCParticle> &particle,
-    int &startT, int &endT)
+void LArPandoraInput::GetCoalescedTrackIDEs(const LArHitTruthTable &hitTruthTable, const LArHitRegistry::HitPtrVector::const_iterator hitBegin,
+    const LArHitRegistry::HitPtrVector::const_iterator hitEnd, TrackIDEVector &trackIDEs)
 {
-    art::ServiceHandle<geo::Geometry> theGeometry;
+    trackIDEs.clear();
+    float totalEnergy(0.f);
 
-    bool foundStartPosition(false);
-    const int numTrajectoryPoints(static_cast<int>(particle->NumberTrajectoryPoints()));
-
-    for (int nt = 0; nt < numTrajectoryPoints; ++nt)
+    for (LArHitRegistry::HitPtrVector::const_iterator hitIter = hitBegin; hitIter != hitEnd; ++hitIter)
     {
-        const double pos[3] = {particle->Vx(nt), particle->Vy(nt), particle->Vz(nt)};
-        geo::TPCID tpcID = theGeometry->FindTPCAtPosition(pos);
-
-        if (!tpcID.isValid)
-            continue;
-
-        if (!(cstat == tpcID.Cryostat && tpc == tpcID.TPC))
-            continue;
+        for (LArHitTruthTable::EntryList::const_iterator iter = hitTruthTable.Begin(hitIter->key()), iterEnd = hitTruthTable.End(hitIter->key());
+            iter != iterEnd; ++iter)
+        {
+            TrackIDEVector::iterator trackIter(std::find_if(trackIDEs.begin(), trackIDEs.end(),
+                [&iter](const sim::TrackIDE &trackIDE) { return (trackIDE.trackID == iter->m_trackID); }));
 
-        endT = nt;
+            if (trackIDEs.end() == trackIter)
+            {
+                sim::TrackIDE trackIDE = sim::TrackIDE();
+                trackIDE.trackID = iter->m_trackID;
+                trackIDE.energyFrac = 0.f;
+                trackIDE.energy = 0.f;
+                trackIter = trackIDEs.insert(trackIDEs.end(), trackIDE);
+            }
 
-        if (!foundStartPosition)
-        {
-            startT = endT;
-            foundStartPosition = true;
+            trackIter->energy += iter->m_energy;
+            totalEnergy += iter->m_energy;
         }
     }
+
+    // ATTN As for single hits, a negligible total energy gives fractions equal to the deposited energies
+    if (totalEnergy < 1.e-5f)
+        totalEnergy = 1.f;
+
+    for (sim::TrackIDE &trackIDE : trackIDEs)
+        trackIDE.energyFrac = trackIDE.energy / totalEnergy;
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
@@ -743,15 +1242,13 @@ float LArPandoraInput::GetTrueX0(const art::Ptr<simb::MCParticle> &particle, con
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
-double LArPandoraInput::GetMips(const Settings &settings, const double hit_Charge, const geo::View_t hit_View)
+double LArPandoraInput::GetMips(const Settings &settings, const detinfo::DetectorProperties *const pDetectorProperties, const double hit_Charge,
+    const double wire_pitch_cm)
 {
-    art::ServiceHandle<geo::Geometry> theGeometry;
-    auto const* theDetector = lar::providerFrom<detinfo::DetectorPropertiesService>();
-
     // TODO: Check if this procedure is correct
-    const double dQdX(hit_Charge / (theGeometry->WirePitch(hit_View))); // ADC/cm
-    const double dQdX_e(dQdX / (theDetector->ElectronsToADC() * settings.m_recombination_factor)); // e/cm
-    double dEdX(theDetector->BirksCorrection(dQdX_e));
+    const double dQdX(hit_Charge / wire_pitch_cm); // ADC/cm
+    const double dQdX_e(dQdX / (pDetectorProperties->ElectronsToADC() * settings.m_recombination_factor)); // e/cm
+    double dEdX(pDetectorProperties->BirksCorrection(dQdX_e));
 
     if ((dEdX < 0) || (dEdX > settings.m_dEdX_max))
         dEdX = settings.m_dEdX_max;
@@ -765,6 +1262,9 @@ double LArPandoraInput::GetMips(const Settings &settings, const double hit_Charg
 
 LArPandoraInput::Settings::Settings() :
     m_pPrimaryPandora(nullptr),
+    m_pGeometryTable(nullptr),
+    m_pTPCIndex(nullptr),
+    m_nThreads(1),
     m_useHitWidths(true),
     m_uidOffset(100000000),
     m_dx_cm(0.5),
@@ -773,8 +1273,184 @@ LArPandoraInput::Settings::Settings() :
     m_dEdX_max(100000000.),
     m_dEdX_mip(2.),
     m_mips_to_gev(3.5e-4),
-    m_recombination_factor(0.63)
+    m_recombination_factor(0.63),
+    m_coalesceHits(false),
+    m_hitCoalescenceTimeGap(0.),
+    m_hitCoalescenceMaxSpan(0.),
+    m_hitCoalescenceMaxHits(0)
+{
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+LArPandoraInput::HitFilterSettings::HitFilterSettings() :
+    m_enableHitFilter(false),
+    m_minHitCharge(-std::numeric_limits<double>::max()),
+    m_minHitPeakTime(-std::numeric_limits<double>::max()),
+    m_maxHitPeakTime(std::numeric_limits<double>::max()),
+    m_rejectNoisyChannels(false),
+    m_minNeighbourHits(0),
+    m_neighbourWireWindow(1),
+    m_neighbourTimeWindow(10.)
+{
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+LArPandoraInput::HitFilterStatistics::HitFilterStatistics() :
+    m_nInputHits(0),
+    m_nChargeRejected(0),
+    m_nTimeRejected(0),
+    m_nNoisyChannelRejected(0),
+    m_nIsolationRejected(0)
+{
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void LArPandoraInput::HitFilterStatistics::Add(const HitFilterStatistics &rhs)
+{
+    m_nInputHits += rhs.m_nInputHits;
+    m_nChargeRejected += rhs.m_nChargeRejected;
+    m_nTimeRejected += rhs.m_nTimeRejected;
+    m_nNoisyChannelRejected += rhs.m_nNoisyChannelRejected;
+    m_nIsolationRejected += rhs.m_nIsolationRejected;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+unsigned int LArPandoraInput::HitFilterStatistics::GetNRejectedHits() const
+{
+    return (m_nChargeRejected + m_nTimeRejected + m_nNoisyChannelRejected + m_nIsolationRejected);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void LArPandoraInput::PrimaryMCParticleIndex::AddParticle(const simb::MCParticle &mcParticle)
+{
+    // ATTN Primaries were previously held in a map ordered by track id, so only the first with a given track id is kept
+    if (!m_trackIds.insert(mcParticle.TrackId()).second)
+        return;
+
+    m_unconsumedParticles[MomentumKey(mcParticle)].push_back(&mcParticle);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+bool LArPandoraInput::PrimaryMCParticleIndex::ConsumeMatch(const simb::MCParticle &mcParticle)
+{
+    // ATTN Momenta within epsilon of one another are at most one bucket apart in each component
+    const MomentumKey momentumKey(mcParticle);
+
+    for (int dx = -1; dx <= 1; ++dx)
+    {
+        for (int dy = -1; dy <= 1; ++dy)
+        {
+            for (int dz = -1; dz <= 1; ++dz)
+            {
+                MomentumToParticlesMap::iterator iter(m_unconsumedParticles.find(momentumKey.GetNeighbour(dx, dy, dz)));
+
+                if (m_unconsumedParticles.end() == iter)
+                    continue;
+
+                ParticleList &particleList(iter->second);
+
+                for (ParticleList::iterator pIter = particleList.begin(); pIter != particleList.end(); ++pIter)
+                {
+                    if (PrimaryMCParticleIndex::IsMomentumMatch(**pIter, mcParticle))
+                    {
+                        particleList.erase(pIter);
+                        return true;
+                    }
+                }
+            }
+        }
+    }
+
+    return false;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+bool LArPandoraInput::PrimaryMCParticleIndex::IsMomentumMatch(const simb::MCParticle &lhs, const simb::MCParticle &rhs)
+{
+    return (std::fabs(lhs.Px() - rhs.Px()) < std::numeric_limits<double>::epsilon() &&
+            std::fabs(lhs.Py() - rhs.Py()) < std::numeric_limits<double>::epsilon() &&
+            std::fabs(lhs.Pz() - rhs.Pz()) < std::numeric_limits<double>::epsilon());
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+LArPandoraInput::PrimaryMCParticleIndex::MomentumKey::MomentumKey() :
+    m_px(0.),
+    m_py(0.),
+    m_pz(0.)
+{
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+LArPandoraInput::PrimaryMCParticleIndex::MomentumKey::MomentumKey(const simb::MCParticle &mcParticle) :
+    // ATTN Adding zero maps -0 to +0, so that components which compare equal also hash equally
+    m_px(std::floor(mcParticle.Px() / std::numeric_limits<double>::epsilon()) + 0.),
+    m_py(std::floor(mcParticle.Py() / std::numeric_limits<double>::epsilon()) + 0.),
+    m_pz(std::floor(mcParticle.Pz() / std::numeric_limits<double>::epsilon()) + 0.)
+{
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+LArPandoraInput::PrimaryMCParticleIndex::MomentumKey LArPandoraInput::PrimaryMCParticleIndex::MomentumKey::GetNeighbour(const int dx, const int dy,
+    const int dz) const
+{
+    // ATTN Beyond 2^53 neighbouring buckets coincide, but there the tolerance is below the double spacing, so only equal momenta match
+    MomentumKey neighbour;
+    neighbour.m_px = m_px + dx + 0.;
+    neighbour.m_py = m_py + dy + 0.;
+    neighbour.m_pz = m_pz + dz + 0.;
+    return neighbour;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+bool LArPandoraInput::PrimaryMCParticleIndex::MomentumKey::operator==(const MomentumKey &rhs) const
+{
+    return ((m_px == rhs.m_px) && (m_py == rhs.m_py) && (m_pz == rhs.m_pz));
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+std::size_t LArPandoraInput::PrimaryMCParticleIndex::MomentumKeyHasher::operator()(const MomentumKey &key) const
+{
+    const std::hash<double> hasher;
+    std::size_t seed(hasher(key.m_px));
+    seed ^= hasher(key.m_py) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    seed ^= hasher(key.m_pz) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    return seed;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+LArPandoraInput::ReadoutGap::ReadoutGap(const int lineGapType, const float lineStartX, const float lineEndX, const float lineStartZ,
+        const float lineEndZ) :
+    m_lineGapType(lineGapType),
+    m_lineStartX(lineStartX),
+    m_lineEndX(lineEndX),
+    m_lineStartZ(lineStartZ),
+    m_lineEndZ(lineEndZ)
+{
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+bool LArPandoraInput::ReadoutGap::operator<(const ReadoutGap &rhs) const
 {
+    return (std::tie(m_lineGapType, m_lineStartX, m_lineEndX, m_lineStartZ, m_lineEndZ) <
+        std::tie(rhs.m_lineGapType, rhs.m_lineStartX, rhs.m_lineEndX, rhs.m_lineStartZ, rhs.m_lineEndZ));
 }
 
 } // namespace lar_pandora
@@ -12,6 +12,16 @@
 #include "larpandora/LArPandoraInterface/ILArPandora.h"
 #include "larpandora/LArPandoraInterface/LArPandoraHelper.h"
 #include "larpandora/LArPandoraInterface/LArPandoraGeometry.h"
+#include "larpandora/LArPandoraInterface/LArPandoraGeometryTable.h"
+#include "larpandora/LArPandoraInterface/LArPandoraTPCIndex.h"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace detinfo {class DetectorProperties;}
+namespace lar_content {class LArCaloHitParameters;}
 
 namespace lar_pandora
 {
@@ -34,6 +44,9 @@ public:
         Settings();
 
         const pandora::Pandora *m_pPrimaryPandora;          ///<
+        const LArPandoraGeometryTable *m_pGeometryTable;    ///< The precomputed geometry table (if null, a table is built when needed)
+        const LArPandoraTPCIndex *m_pTPCIndex;              ///< The tpc bounding box index (if null, an index is built when needed)
+        unsigned int            m_nThreads;                 ///< The number of threads used to compute hit parameters
         bool                    m_useHitWidths;             ///<
         int                     m_uidOffset;                ///<
         double                  m_dx_cm;                    ///<
@@ -43,17 +56,208 @@ public:
         double                  m_dEdX_mip;                 ///<
         double                  m_mips_to_gev;              ///<
         double                  m_recombination_factor;     ///<
+        bool                    m_coalesceHits;             ///< Whether to coalesce overlapping ART hits on the same wire into single pandora hits
+        double                  m_hitCoalescenceTimeGap;    ///< The maximum gap between the time extents of ART hits to be coalesced, in ticks
+        double                  m_hitCoalescenceMaxSpan;    ///< The maximum time extent of a group of coalesced ART hits, in ticks (0 for no limit)
+        unsigned int            m_hitCoalescenceMaxHits;    ///< The maximum number of ART hits coalesced into a single pandora hit (0 for no limit)
+    };
+
+    /**
+     *  @brief  PrimaryMCParticleIndex class, indexing primary MCParticles by their initial momentum, with each primary matched at most once.
+     *          Momenta match if each component agrees to within the double precision epsilon, so particles are bucketed by momentum
+     *          quantised to that epsilon and a lookup probes the neighbouring buckets.
+     */
+    class PrimaryMCParticleIndex
+    {
+    public:
+        /**
+         *  @brief  Add a primary MCParticle, ignoring any with the same track id as a particle already added
+         *
+         *  @param  mcParticle the primary MCParticle, which must outlive the index
+         */
+        void AddParticle(const simb::MCParticle &mcParticle);
+
+        /**
+         *  @brief  Find a primary MCParticle, not yet consumed, with the same initial momentum (within epsilon) as a given MCParticle,
+         *          and consume it
+         *
+         *  @param  mcParticle the MCParticle
+         *
+         *  @return whether a matching primary MCParticle was found
+         */
+        bool ConsumeMatch(const simb::MCParticle &mcParticle);
+
+    private:
+        /**
+         *  @brief  MomentumKey class, the initial momentum quantised to the matching tolerance
+         */
+        class MomentumKey
+        {
+        public:
+            /**
+             *  @brief  Constructor
+             *
+             *  @param  mcParticle the MCParticle whose initial momentum defines the key
+             */
+            MomentumKey(const simb::MCParticle &mcParticle);
+
+            /**
+             *  @brief  Get the key of a neighbouring bucket
+             *
+             *  @param  dx the bucket offset in x momentum
+             *  @param  dy the bucket offset in y momentum
+             *  @param  dz the bucket offset in z momentum
+             */
+            MomentumKey GetNeighbour(const int dx, const int dy, const int dz) const;
+
+            /**
+             *  @brief  Equality operator
+             */
+            bool operator==(const MomentumKey &rhs) const;
+
+            double  m_px;   ///< The quantised initial x momentum
+            double  m_py;   ///< The quantised initial y momentum
+            double  m_pz;   ///< The quantised initial z momentum
+
+        private:
+            /**
+             *  @brief  Default constructor
+             */
+            MomentumKey();
+        };
+
+        /**
+         *  @brief  Whether the initial momenta of two MCParticles agree, component by component, within the matching tolerance
+         *
+         *  @param  lhs the first MCParticle
+         *  @param  rhs the second MCParticle
+         */
+        static bool IsMomentumMatch(const simb::MCParticle &lhs, const simb::MCParticle &rhs);
+
+        /**
+         *  @brief  MomentumKeyHasher class
+         */
+        class MomentumKeyHasher
+        {
+        public:
+            /**
+             *  @brief  Hash a momentum key
+             */
+            std::size_t operator()(const MomentumKey &key) const;
+        };
+
+        typedef std::vector<const simb::MCParticle*> ParticleList;
+        typedef std::unordered_map<MomentumKey, ParticleList, MomentumKeyHasher> MomentumToParticlesMap;
+
+        MomentumToParticlesMap      m_unconsumedParticles;  ///< The primary MCParticles not yet consumed, by initial momentum
+        std::unordered_set<int>     m_trackIds;             ///< The track ids of all primary MCParticles added
+    };
+
+    /**
+     *  @brief  ReadoutGap class, the parameters of a pandora line gap covering a continuous region of bad channels
+     */
+    class ReadoutGap
+    {
+    public:
+        /**
+         *  @brief  Constructor
+         *
+         *  @param  lineGapType the pandora line gap type
+         *  @param  lineStartX the line gap start x coordinate
+         *  @param  lineEndX the line gap end x coordinate
+         *  @param  lineStartZ the line gap start coordinate along the wire-pitch direction
+         *  @param  lineEndZ the line gap end coordinate along the wire-pitch direction
+         */
+        ReadoutGap(const int lineGapType, const float lineStartX, const float lineEndX, const float lineStartZ, const float lineEndZ);
+
+        /**
+         *  @brief  Less than operator, allowing lists of readout gaps to be compared
+         */
+        bool operator<(const ReadoutGap &rhs) const;
+
+        int     m_lineGapType;  ///< The pandora line gap type
+        float   m_lineStartX;   ///< The line gap start x coordinate
+        float   m_lineEndX;     ///< The line gap end x coordinate
+        float   m_lineStartZ;   ///< The line gap start coordinate along the wire-pitch direction
+        float   m_lineEndZ;     ///< The line gap end coordinate along the wire-pitch direction
     };
 
+    typedef std::vector<ReadoutGap> ReadoutGapList;
+
     /**
-     *  @brief  Create the Pandora 2D hits from the ART hits
+     *  @brief  HitFilterSettings class, the cuts applied to ART hits before pandora hits are created
+     */
+    class HitFilterSettings
+    {
+    public:
+        /**
+         *  @brief  Default constructor, with all cuts disabled
+         */
+        HitFilterSettings();
+
+        bool            m_enableHitFilter;          ///< Whether to filter hits before creating pandora hits
+        double          m_minHitCharge;             ///< The minimum hit integral
+        double          m_minHitPeakTime;           ///< The minimum hit peak time, in ticks
+        double          m_maxHitPeakTime;           ///< The maximum hit peak time, in ticks
+        bool            m_rejectNoisyChannels;      ///< Whether to reject hits on channels flagged as noisy by the channel status service
+        unsigned int    m_minNeighbourHits;         ///< The minimum number of neighbouring hits, for a hit not to be isolated (zero disables the cut)
+        unsigned int    m_neighbourWireWindow;      ///< The maximum wire separation of neighbouring hits, in the same plane
+        double          m_neighbourTimeWindow;      ///< The maximum peak time separation of neighbouring hits, in ticks
+    };
+
+    /**
+     *  @brief  HitFilterStatistics class, the numbers of ART hits rejected by each hit filter cut
+     */
+    class HitFilterStatistics
+    {
+    public:
+        /**
+         *  @brief  Default constructor
+         */
+        HitFilterStatistics();
+
+        /**
+         *  @brief  Add the counts from other hit filter statistics, e.g. to accumulate statistics over events
+         *
+         *  @param  rhs the other hit filter statistics
+         */
+        void Add(const HitFilterStatistics &rhs);
+
+        /**
+         *  @brief  Get the total number of rejected hits
+         */
+        unsigned int GetNRejectedHits() const;
+
+        unsigned int    m_nInputHits;               ///< The number of hits considered
+        unsigned int    m_nChargeRejected;          ///< The number of hits rejected by the charge cut
+        unsigned int    m_nTimeRejected;            ///< The number of hits rejected by the peak time window
+        unsigned int    m_nNoisyChannelRejected;    ///< The number of hits rejected as lying on noisy channels
+        unsigned int    m_nIsolationRejected;       ///< The number of hits rejected as isolated
+    };
+
+    /**
+     *  @brief  Filter the ART hits before pandora hits are created. Each rejected hit is counted against the first cut it fails, with the
+     *          isolation cut applied last, to the hits passing all other cuts. Both lists preserve the input order.
+     *
+     *  @param  filterSettings the hit filter settings
+     *  @param  hitVector the input list of ART hits for this event
+     *  @param  selectedHitVector to receive the hits passing all cuts
+     *  @param  rejectedHitVector to receive the hits failing any cut
+     *  @param  statistics to receive the numbers of hits rejected by each cut
+     */
+    static void FilterHits(const HitFilterSettings &filterSettings, const HitVector &hitVector, HitVector &selectedHitVector,
+        HitVector &rejectedHitVector, HitFilterStatistics &statistics);
+
+    /**
+     *  @brief  Create the Pandora 2D hits from the ART hits. If hit coalescence is enabled, each set of ART hits on the same wire whose time
+     *          extents overlap (or are separated by at most the coalescence time gap) gives a single Pandora hit, registered with all of them
      *
      *  @param  settings the settings
      *  @param  driftVolumeMap the mapping from volume id to drift volume
      *  @param  hits the input list of ART hits for this event
-     *  @param  idToHitMap to receive the mapping from Pandora hit ID to ART hit
+     *  @param  hitRegistry to receive the registry of ART hits, by Pandora hit ID
      */
-    static void CreatePandoraHits2D(const Settings &settings, const LArDriftVolumeMap &driftVolumeMap, const HitVector &hitVector, IdToHitMap &idToHitMap);
+    static void CreatePandoraHits2D(const Settings &settings, const LArDriftVolumeMap &driftVolumeMap, const HitVector &hitVector, LArHitRegistry &hitRegistry);
 
     /**
      *  @brief  Create pandora LArTPCs to represent the different drift volumes in use
@@ -74,12 +278,58 @@ public:
         const LArDetectorGapList &listOfGaps);
 
     /**
-     *  @brief  Create pandora line gaps to cover any (continuous regions of) bad channels
+     *  @brief  Find the pandora line gaps covering any (continuous regions of) bad channels, without creating them
      *
      *  @param  settings the settings
      *  @param  driftVolumeMap the mapping from volume id to drift volume
+     *  @param  readoutGapList to receive the readout gaps
+     */
+    static void LoadReadoutGaps(const Settings &settings, const LArDriftVolumeMap &driftVolumeMap, ReadoutGapList &readoutGapList);
+
+    /**
+     *  @brief  Create pandora line gaps from a list of readout gaps
+     *
+     *  @param  settings the settings
+     *  @param  readoutGapList the readout gaps
+     */
+    static void CreatePandoraReadoutGaps(const Settings &settings, const ReadoutGapList &readoutGapList);
+
+    /**
+     *  @brief  Get a key identifying the current wire geometry, drift volumes, bad channel list and cache format, which changes whenever
+     *          the readout gaps may change. The key is an FNV-1a hash, so is stable between builds and may be stored in cache files.
+     *
+     *  @param  driftVolumeMap the mapping from volume id to drift volume
+     */
+    static std::uint64_t GetReadoutGapKey(const LArDriftVolumeMap &driftVolumeMap);
+
+    /**
+     *  @brief  Read readout gaps from a cache file
+     *
+     *  @param  fileName the cache file name
+     *  @param  key the readout gap key, which must match that stored in the file
+     *  @param  readoutGapList to receive the readout gaps
+     *
+     *  @return whether the file exists, matches the key and could be read
+     */
+    static bool ReadReadoutGaps(const std::string &fileName, const std::uint64_t key, ReadoutGapList &readoutGapList);
+
+    /**
+     *  @brief  Write readout gaps to a cache file
+     *
+     *  @param  fileName the cache file name
+     *  @param  key the readout gap key
+     *  @param  readoutGapList the readout gaps
+     */
+    static void WriteReadoutGaps(const std::string &fileName, const std::uint64_t key, const ReadoutGapList &readoutGapList);
+
+    /**
+     *  @brief  Add a value to an FNV-1a hash
+     *
+     *  @param  value the value, whose bytes are hashed
+     *  @param  hash the hash to update
      */
-    static void CreatePandoraReadoutGaps(const Settings &settings, const LArDriftVolumeMap &driftVolumeMap);
+    template <typename T>
+    static void AddToHash(const T &value, std::uint64_t &hash);
 
     /**
      *  @brief  Create the Pandora MC particles from the MC particles
@@ -91,53 +341,127 @@ public:
     static void CreatePandoraMCParticles(const Settings &settings, const MCTruthToMCParticles &truthToParticles,
         const MCParticlesToMCTruth &particlesToTruth, const RawMCParticleVector &generatorMCParticleVector);
 
+    /**
+     *  @brief  Select the MC particles that contribute to at least one hit, together with their ancestors up to the MC truth, so that
+     *          the Pandora MC hierarchy remains complete for hit matching while particles without hits are not created
+     *
+     *  @param  hitTruthTable the true energy deposits of the ART hits, by hit key
+     *  @param  truthToParticles mapping from MC truth to MC particles
+     *  @param  particlesToTruth mapping from MC particles to MC truth
+     *  @param  selectedTruthToParticles to receive the mapping from MC truth to selected MC particles (every MC truth is retained)
+     *  @param  selectedParticlesToTruth to receive the mapping from selected MC particles to MC truth
+     */
+    static void SelectMCParticlesWithHits(const LArHitTruthTable &hitTruthTable, const MCTruthToMCParticles &truthToParticles,
+        const MCParticlesToMCTruth &particlesToTruth, MCTruthToMCParticles &selectedTruthToParticles, MCParticlesToMCTruth &selectedParticlesToTruth);
+
     /**
      *  @brief Find all primary MCParticles in a given vector of MCParticles
      *
-     *  @param mcParticleVector vector of all MCParticles to consider
-     *  @param primaryMCParticleMap map containing primary MCParticles and bool indicating whether particle has been accounted for
+     *  @param mcParticleVector vector of all MCParticles to consider, which must outlive the index
+     *  @param primaryMCParticleIndex to receive the index of primary MCParticles, by momentum
      */
-    static void FindPrimaryParticles(const RawMCParticleVector &mcParticleVector, std::map<const simb::MCParticle, bool> &primaryMCParticleMap);
+    static void FindPrimaryParticles(const RawMCParticleVector &mcParticleVector, PrimaryMCParticleIndex &primaryMCParticleIndex);
 
     /**
-     *  @brief Check whether an MCParticle can be found in a given map
+     *  @brief Check whether an MCParticle matches a primary MCParticle that has not yet been accounted for, consuming the match if so
      *
      *  @param mcParticle target MCParticle
-     *  @param primaryMCParticleMap map containing primary MCParticles and bool indicating whether particle has been accounted for
+     *  @param primaryMCParticleIndex the index of primary MCParticles, by momentum
      */
-    static bool IsPrimaryMCParticle(const art::Ptr<simb::MCParticle> &mcParticle, std::map<const simb::MCParticle, bool> &primaryMCParticleMap);
+    static bool IsPrimaryMCParticle(const art::Ptr<simb::MCParticle> &mcParticle, PrimaryMCParticleIndex &primaryMCParticleIndex);
 
     /**
      *  @brief  Create links between the 2D hits and Pandora MC particles
      *
      *  @param  settings the settings
-     *  @param  hitMap mapping from Pandora hit addresses to ART hits
-     *  @param  hitToParticleMap mapping from each ART hit to its underlying G4 track ID
+     *  @param  hitRegistry the registry of ART hits, by Pandora hit ID
+     *  @param  hitTruthTable the true energy deposits of the ART hits, by hit key
      */
-    static void CreatePandoraMCLinks2D(const Settings &settings, const HitMap &hitMap, const HitsToTrackIDEs &hitToParticleMap);
+    static void CreatePandoraMCLinks2D(const Settings &settings, const LArHitRegistry &hitRegistry, const LArHitTruthTable &hitTruthTable);
 
 private:
     /**
-     *  @brief  Loop over MC trajectory points and identify start and end points within the detector
+     *  @brief  Hit parameter status enumeration
+     */
+    enum HitParameterStatus
+    {
+        InvalidWithoutId,   ///< A parameter preceding the parent address is invalid, so the hit does not use a hit id
+        InvalidWithId,      ///< A parameter following the parent address is invalid, so the hit uses a hit id but is not created
+        Valid               ///< All parameters are valid
+    };
+
+    /**
+     *  @brief  Hit rejection reason enumeration
+     */
+    enum HitRejectionReason
+    {
+        NotRejected,                ///< The hit is not rejected
+        InvalidCellSize,            ///< The hit width, wire pitch or derived cell sizes are not finite single precision values
+        InvalidEnergy,              ///< The hit charge or derived energies are not finite single precision values
+        InvalidPosition,            ///< The hit drift or wire coordinate is not a finite single precision value
+        CreationFailed,             ///< Pandora failed to create the hit from valid parameters
+        NumberOfRejectionReasons    ///< The number of hit rejection reasons
+    };
+
+    /**
+     *  @brief  Group the ART hits to be coalesced into single pandora hits. The groups are ordered by their first hit in the input list, and
+     *          each group starts with its representative (largest integral) hit.
      *
      *  @param  settings the settings
-     *  @param  particle the true particle
-     *  @param  startT the first trajectory point in the detector
-     *  @param  endT the last trajectory point in the detector
+     *  @param  hitVector the input list of ART hits
+     *  @param  coalescedHitVector to receive the ART hits, contiguous per group
+     *  @param  groupOffsets to receive the index of the first hit of each group, with a final entry for the total
      */
-    static void GetTrueStartAndEndPoints(const Settings &settings, const art::Ptr<simb::MCParticle> &particle, int &startT, int &endT);
+    static void CoalesceHits(const Settings &settings, const HitVector &hitVector, HitVector &coalescedHitVector, std::vector<unsigned int> &groupOffsets);
 
     /**
-     *  @brief  Loop over MC trajectory points and identify start and end points within a given cryostat and TPC
+     *  @brief  Fill the pandora calo hit parameters for a group of ART hits on the same wire (usually a single hit), except for the parent
+     *          address. The pandora hit takes its position from the representative hit and its charge from the sum over the group. A single
+     *          hit keeps its own width; a larger group takes its width from its time extent about the representative peak time, so the cell
+     *          stays centred on the hit position. All values are screened before any are assigned, so invalid hits are rejected without
+     *          exceptions. Independent for each group, so may be called concurrently.
      *
-     *  @param  cstat the cryostat
-     *  @param  tpc the TPC
-     *  @param  particle the true particle
-     *  @param  startT the first trajectory point in the detector
-     *  @param  endT the last trajectory point in the detector
+     *  @param  settings the settings
+     *  @param  pDetectorProperties the detector properties provider
+     *  @param  geometryTable the geometry lookup table
+     *  @param  hitBegin the representative ART hit, followed by any other hits in the group
+     *  @param  hitEnd one past the last ART hit in the group
+     *  @param  caloHitParameters to receive the calo hit parameters
+     *  @param  rejectionReason to receive the reason for rejecting the hit, if the parameters are not valid
+     *
+     *  @return the status of the filled parameters
+     */
+    static HitParameterStatus FillCaloHitParameters(const Settings &settings, const detinfo::DetectorProperties *const pDetectorProperties,
+        const LArPandoraGeometryTable &geometryTable, const HitVector::const_iterator hitBegin, const HitVector::const_iterator hitEnd,
+        lar_content::LArCaloHitParameters &caloHitParameters, HitRejectionReason &rejectionReason);
+
+    /**
+     *  @brief  Whether a value can be assigned to a pandora input parameter, i.e. is finite in single precision
+     *
+     *  @param  value the value
+     */
+    static bool IsValidParameter(const double value);
+
+    /**
+     *  @brief  Create a link between a 2D hit and a Pandora MC particle, warning if the link is invalid
+     *
+     *  @param  pandora the pandora instance
+     *  @param  hitID the pandora hit id
+     *  @param  trackID the G4 track id
+     *  @param  energyFrac the fraction of the hit energy deposited by the track
+     */
+    static void CreatePandoraMCLink2D(const pandora::Pandora &pandora, const int hitID, const int trackID, const float energyFrac);
+
+    /**
+     *  @brief  Sum the true energy deposits of a group of coalesced ART hits by track, with energy fractions relative to the group
+     *
+     *  @param  hitTruthTable the true energy deposits of the ART hits, by hit key
+     *  @param  hitBegin the first ART hit in the group
+     *  @param  hitEnd one past the last ART hit in the group
+     *  @param  trackIDEs to receive the summed energy deposits, by track
      */
-    static void GetTrueStartAndEndPoints(const unsigned int cstat, const unsigned int tpc, const art::Ptr<simb::MCParticle> &particle,
-        int &startT, int &endT);
+    static void GetCoalescedTrackIDEs(const LArHitTruthTable &hitTruthTable, const LArHitRegistry::HitPtrVector::const_iterator hitBegin,
+        const LArHitRegistry::HitPtrVector::const_iterator hitEnd, TrackIDEVector &trackIDEs);
 
     /**
      *  @brief  Use detector and time services to get a true X offset for a given trajectory point
@@ -151,10 +475,12 @@ private:
      *  @brief  Convert charge in ADCs to approximate MIPs
      *
      *  @param  settings the settings
+     *  @param  pDetectorProperties the detector properties provider
      *  @param  hit_Charge the input charge
-     *  @param  hit_View the input view number
+     *  @param  wire_pitch_cm the wire pitch of the hit plane, in cm
      */
-    static double GetMips(const Settings &settings, const double hit_Charge, const geo::View_t hit_View);
+    static double GetMips(const Settings &settings, const detinfo::DetectorProperties *const pDetectorProperties, const double hit_Charge,
+        const double wire_pitch_cm);
 };
 
 } // namespace lar_pandora
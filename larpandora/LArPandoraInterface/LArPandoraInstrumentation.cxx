@@ -0,0 +1,208 @@
+/**
+ *  @file   larpandora/LArPandoraInterface/LArPandoraInstrumentation.cxx
+ *
+ *  @brief  Stage-level timing and memory instrumentation for LArPandora producer modules
+ */
+
+#include "art/Framework/Principal/Event.h"
+#include "art/Framework/Services/Optional/TFileService.h"
+#include "art/Framework/Services/Registry/ServiceHandle.h"
+#include "cetlib/exception.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+#include "TTree.h"
+
+#include "larpandora/LArPandoraInterface/LArPandoraInstrumentation.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include <unistd.h>
+
+namespace lar_pandora
+{
+
+LArPandoraInstrumentation::LArPandoraInstrumentation(const bool isEnabled) :
+    m_isEnabled(isEnabled),
+    m_pTree(nullptr),
+    m_run(0),
+    m_event(0),
+    m_nHits(0),
+    m_nPfos(0),
+    m_timers(NumberOfStages),
+    m_wallTimes(NumberOfStages, 0.),
+    m_cpuTimes(NumberOfStages, 0.),
+    m_rssDeltas(NumberOfStages, 0.),
+    m_rssAtStart(NumberOfStages, 0.),
+    m_nEvents(0),
+    m_totalHits(0.),
+    m_totalPfos(0.),
+    m_totalWallTimes(NumberOfStages, 0.),
+    m_totalCpuTimes(NumberOfStages, 0.),
+    m_maxWallTimes(NumberOfStages, 0.),
+    m_totalRssDeltas(NumberOfStages, 0.)
+{
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void LArPandoraInstrumentation::BeginJob()
+{
+    if (!m_isEnabled)
+        return;
+
+    art::ServiceHandle<art::TFileService> tfs;
+    m_pTree = tfs->make<TTree>("instrumentation", "LArPandora stage timing and memory");
+    m_pTree->Branch("run", &m_run, "run/I");
+    m_pTree->Branch("event", &m_event, "event/I");
+    m_pTree->Branch("nHits", &m_nHits, "nHits/I");
+    m_pTree->Branch("nPfos", &m_nPfos, "nPfos/I");
+
+    for (unsigned int iStage = 0; iStage < NumberOfStages; ++iStage)
+    {
+        const std::string stageName(LArPandoraInstrumentation::GetStageName(static_cast<Stage>(iStage)));
+        m_pTree->Branch((stageName + "WallTime").c_str(), &m_wallTimes[iStage], (stageName + "WallTime/D").c_str());
+        m_pTree->Branch((stageName + "CpuTime").c_str(), &m_cpuTimes[iStage], (stageName + "CpuTime/D").c_str());
+        m_pTree->Branch((stageName + "RssDelta").c_str(), &m_rssDeltas[iStage], (stageName + "RssDelta/D").c_str());
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void LArPandoraInstrumentation::BeginEvent(const art::Event &evt)
+{
+    if (!m_isEnabled)
+        return;
+
+    m_run = evt.run();
+    m_event = evt.id().event();
+    m_nHits = 0;
+    m_nPfos = 0;
+
+    for (unsigned int iStage = 0; iStage < NumberOfStages; ++iStage)
+    {
+        m_timers[iStage].reset();
+        m_rssDeltas[iStage] = 0.;
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void LArPandoraInstrumentation::StartStage(const Stage stage)
+{
+    if (!m_isEnabled)
+        return;
+
+    m_rssAtStart.at(stage) = LArPandoraInstrumentation::GetResidentSetSize();
+    m_timers.at(stage).start();
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void LArPandoraInstrumentation::StopStage(const Stage stage)
+{
+    if (!m_isEnabled)
+        return;
+
+    m_timers.at(stage).stop();
+    m_rssDeltas.at(stage) += LArPandoraInstrumentation::GetResidentSetSize() - m_rssAtStart.at(stage);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void LArPandoraInstrumentation::SetEventSize(const unsigned int nHits, const unsigned int nPfos)
+{
+    m_nHits = nHits;
+    m_nPfos = nPfos;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void LArPandoraInstrumentation::EndEvent()
+{
+    if (!m_isEnabled)
+        return;
+
+    for (unsigned int iStage = 0; iStage < NumberOfStages; ++iStage)
+    {
+        m_wallTimes[iStage] = m_timers[iStage].accumulated_real_time();
+        m_cpuTimes[iStage] = m_timers[iStage].accumulated_cpu_time();
+
+        m_totalWallTimes[iStage] += m_wallTimes[iStage];
+        m_totalCpuTimes[iStage] += m_cpuTimes[iStage];
+        m_maxWallTimes[iStage] = std::max(m_maxWallTimes[iStage], m_wallTimes[iStage]);
+        m_totalRssDeltas[iStage] += m_rssDeltas[iStage];
+    }
+
+    ++m_nEvents;
+    m_totalHits += m_nHits;
+    m_totalPfos += m_nPfos;
+
+    if (m_pTree)
+        m_pTree->Fill();
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void LArPandoraInstrumentation::EndJob() const
+{
+    if (!m_isEnabled || (0 == m_nEvents))
+        return;
+
+    std::ostringstream summary;
+    summary << " *** LArPandoraInstrumentation summary for " << m_nEvents << " events, mean hits " << (m_totalHits / m_nEvents)
+            << ", mean pfos " << (m_totalPfos / m_nEvents) << " *** " << std::endl
+            << std::setw(16) << "Stage" << std::setw(16) << "TotalWall[s]" << std::setw(16) << "MeanWall[s]" << std::setw(16) << "MaxWall[s]"
+            << std::setw(16) << "MeanCpu[s]" << std::setw(16) << "MeanRss[MB]" << std::endl;
+
+    for (unsigned int iStage = 0; iStage < NumberOfStages; ++iStage)
+    {
+        summary << std::setw(16) << LArPandoraInstrumentation::GetStageName(static_cast<Stage>(iStage))
+                << std::setw(16) << m_totalWallTimes[iStage]
+                << std::setw(16) << (m_totalWallTimes[iStage] / m_nEvents)
+                << std::setw(16) << m_maxWallTimes[iStage]
+                << std::setw(16) << (m_totalCpuTimes[iStage] / m_nEvents)
+                << std::setw(16) << (m_totalRssDeltas[iStage] / m_nEvents) << std::endl;
+    }
+
+    mf::LogInfo("LArPandora") << summary.str();
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+std::string LArPandoraInstrumentation::GetStageName(const Stage stage)
+{
+    switch (stage)
+    {
+        case InputStage: return "input";
+        case ReadoutGapsStage: return "readoutGaps";
+        case HitFilterStage: return "hitFilter";
+        case HitsStage: return "hits";
+        case MCParticlesStage: return "mcParticles";
+        case MCLinksStage: return "mcLinks";
+        case RunStage: return "run";
+        case OutputStage: return "output";
+        case ResetStage: return "reset";
+        default: break;
+    }
+
+    throw cet::exception("LArPandora") << " LArPandoraInstrumentation::GetStageName --- unknown stage " << stage;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+double LArPandoraInstrumentation::GetResidentSetSize()
+{
+    // ATTN The second field of statm is the resident set size, in pages; returns zero where statm is unavailable
+    std::ifstream statm("/proc/self/statm");
+    long nPagesTotal(0), nPagesResident(0);
+
+    if (!(statm >> nPagesTotal >> nPagesResident))
+        return 0.;
+
+    return static_cast<double>(nPagesResident) * static_cast<double>(sysconf(_SC_PAGESIZE)) / (1024. * 1024.);
+}
+
+} // namespace lar_pandora
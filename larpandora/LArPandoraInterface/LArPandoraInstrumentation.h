@@ -0,0 +1,152 @@
+/**
+ *  @file   larpandora/LArPandoraInterface/LArPandoraInstrumentation.h
+ *
+ *  @brief  Stage-level timing and memory instrumentation for LArPandora producer modules
+ */
+
+#ifndef LAR_PANDORA_INSTRUMENTATION_H
+#define LAR_PANDORA_INSTRUMENTATION_H 1
+
+#include "cetlib/cpu_timer.h"
+
+#include <string>
+#include <vector>
+
+namespace art {class Event;}
+
+class TTree;
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+namespace lar_pandora
+{
+
+/**
+ *  @brief  LArPandoraInstrumentation class
+ */
+class LArPandoraInstrumentation
+{
+public:
+    /**
+     *  @brief  Stage enumeration
+     */
+    enum Stage
+    {
+        InputStage,
+        ReadoutGapsStage,
+        HitFilterStage,
+        HitsStage,
+        MCParticlesStage,
+        MCLinksStage,
+        RunStage,
+        OutputStage,
+        ResetStage,
+        NumberOfStages
+    };
+
+    /**
+     *  @brief  Constructor
+     *
+     *  @param  isEnabled whether instrumentation is enabled (if not, all calls are no-ops)
+     */
+    LArPandoraInstrumentation(const bool isEnabled);
+
+    /**
+     *  @brief  Whether instrumentation is enabled
+     */
+    bool IsEnabled() const;
+
+    /**
+     *  @brief  Book the per-event output tree, using the TFileService
+     */
+    void BeginJob();
+
+    /**
+     *  @brief  Clear the per-event measurements and record the event identity
+     *
+     *  @param  evt the art event
+     */
+    void BeginEvent(const art::Event &evt);
+
+    /**
+     *  @brief  Start timing a stage (stages may be nested, and may be started and stopped several times per event)
+     *
+     *  @param  stage the stage
+     */
+    void StartStage(const Stage stage);
+
+    /**
+     *  @brief  Stop timing a stage
+     *
+     *  @param  stage the stage
+     */
+    void StopStage(const Stage stage);
+
+    /**
+     *  @brief  Record the size of the current event
+     *
+     *  @param  nHits the number of input ART hits
+     *  @param  nPfos the number of output particles (zero if production is disabled)
+     */
+    void SetEventSize(const unsigned int nHits, const unsigned int nPfos);
+
+    /**
+     *  @brief  Write the measurements for the current event to the output tree and add them to the job totals
+     */
+    void EndEvent();
+
+    /**
+     *  @brief  Print a summary of the measurements accumulated over the job
+     */
+    void EndJob() const;
+
+    /**
+     *  @brief  Get the name of a stage
+     *
+     *  @param  stage the stage
+     *
+     *  @return the stage name
+     */
+    static std::string GetStageName(const Stage stage);
+
+private:
+    /**
+     *  @brief  Get the current resident set size of this process
+     *
+     *  @return the resident set size, in MB
+     */
+    static double GetResidentSetSize();
+
+    bool                        m_isEnabled;        ///< Whether instrumentation is enabled
+    TTree                      *m_pTree;            ///< The per-event output tree
+
+    int                         m_run;              ///< The run number of the current event
+    int                         m_event;            ///< The event number of the current event
+    int                         m_nHits;            ///< The number of input ART hits in the current event
+    int                         m_nPfos;            ///< The number of output particles in the current event
+
+    std::vector<cet::cpu_timer> m_timers;           ///< The timer for each stage in the current event
+    std::vector<double>         m_wallTimes;        ///< The wall time for each stage in the current event, in seconds
+    std::vector<double>         m_cpuTimes;         ///< The cpu time for each stage in the current event, in seconds
+    std::vector<double>         m_rssDeltas;        ///< The change in resident set size for each stage in the current event, in MB
+    std::vector<double>         m_rssAtStart;       ///< The resident set size when each stage was last started, in MB
+
+    unsigned int                m_nEvents;          ///< The number of events processed in the job
+    double                      m_totalHits;        ///< The total number of input hits in the job
+    double                      m_totalPfos;        ///< The total number of output pfos in the job
+    std::vector<double>         m_totalWallTimes;   ///< The total wall time for each stage in the job, in seconds
+    std::vector<double>         m_totalCpuTimes;    ///< The total cpu time for each stage in the job, in seconds
+    std::vector<double>         m_maxWallTimes;     ///< The largest per-event wall time for each stage in the job, in seconds
+    std::vector<double>         m_totalRssDeltas;   ///< The total change in resident set size for each stage in the job, in MB
+};
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline bool LArPandoraInstrumentation::IsEnabled() const
+{
+    return m_isEnabled;
+}
+
+} // namespace lar_pandora
+
+#endif // #ifndef LAR_PANDORA_INSTRUMENTATION_H
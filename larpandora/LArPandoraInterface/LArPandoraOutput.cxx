@@ -6,26 +6,31 @@
  */
 
 #include "art/Framework/Core/EDProducer.h"
+#include "art/Persistency/Common/PtrMaker.h"
+#include "canvas/Persistency/Common/Assns.h"
 #include "cetlib/exception.h"
 #include "messagefacility/MessageLogger/MessageLogger.h"
 
 #include "larreco/ClusterFinder/ClusterCreator.h"
 #include "larreco/RecoAlg/ClusterRecoUtil/StandardClusterParamsAlg.h"
 #include "larreco/RecoAlg/ClusterParamsImportWrapper.h"
-#include "lardata/Utilities/AssociationUtil.h"
 
 #include "lardataobj/RecoBase/Hit.h"
 #include "lardataobj/RecoBase/PFParticle.h"
 #include "lardataobj/RecoBase/SpacePoint.h"
+#include "lardataobj/RecoBase/TrackHitMeta.h"
 #include "lardataobj/RecoBase/Vertex.h"
 #include "lardataobj/AnalysisBase/T0.h"
 
+#include "larcoreobj/SimpleTypesAndConstants/PhysicalConstants.h"
+
 #include "larcore/Geometry/Geometry.h"
 #include "lardata/DetectorInfoServices/DetectorClocksService.h"
-#include "lardata/DetectorInfoServices/DetectorPropertiesService.h"
 
 #include "Api/PandoraApi.h"
 
+#include "Pandora/PdgTable.h"
+
 #include "Objects/CaloHit.h"
 #include "Objects/Cluster.h"
 #include "Objects/ParticleFlowObject.h"
@@ -34,17 +39,25 @@
 #include "larpandoracontent/LArHelpers/LArClusterHelper.h"
 #include "larpandoracontent/LArHelpers/LArPfoHelper.h"
 
+#include "larpandora/LArPandoraObjects/LArCompactSpacePoints.h"
+#include "larpandora/LArPandoraObjects/LArHitOwnership.h"
+
 #include "larpandora/LArPandoraInterface/LArPandoraOutput.h"
+#include "larpandora/LArPandoraInterface/LArPandoraParallel.h"
 
 #include <algorithm>
+#include <cmath>
+#include <cstdlib>
 #include <iterator>
 #include <iostream>
 #include <limits>
+#include <map>
+#include <unordered_set>
 
 namespace lar_pandora
 {
 
-void LArPandoraOutput::ProduceArtOutput(const Settings &settings, const IdToHitMap &idToHitMap, art::Event &evt)
+unsigned int LArPandoraOutput::ProduceArtOutput(const Settings &settings, const LArHitRegistry &hitRegistry, art::Event &evt)
 {
     mf::LogDebug("LArPandora") << " *** LArPandora::ProduceArtOutput() *** " << std::endl;
 
@@ -55,17 +68,17 @@ void LArPandoraOutput::ProduceArtOutput(const Settings &settings, const IdToHitM
         throw cet::exception("LArPandora") << " LArPandoraOutput::ProduceArtOutput --- pointer to ART Producer module does not exist ";
 
     // Obtain a sorted vector of all output Pfos and their daughters
-    const pandora::PfoList *pPfoList(nullptr);
-    PANDORA_THROW_RESULT_IF(pandora::STATUS_CODE_SUCCESS, !=, PandoraApi::GetCurrentPfoList(*(settings.m_pPrimaryPandora), pPfoList));
+    pandora::PfoVector pfoVector;
+    LArPandoraOutput::CollectPfos(settings, pfoVector);
 
-    if (pPfoList->empty())
+    if (pfoVector.empty())
         mf::LogDebug("LArPandora") << "   Warning: No reconstructed particles for this event " << std::endl;
 
-    pandora::PfoList connectedPfoList;
-    lar_content::LArPfoHelper::GetAllConnectedPfos(*pPfoList, connectedPfoList);
+    // Pfos from the daughter instances are stitched across drift volume boundaries here, with each stitched group output as a single particle
+    StitchedPfos stitchedPfos;
 
-    pandora::PfoVector pfoVector(connectedPfoList.begin(), connectedPfoList.end());
-    std::sort(pfoVector.begin(), pfoVector.end(), lar_content::LArPfoHelper::SortByNHits);
+    if (settings.m_shouldRunStitching && !settings.m_daughterPandoraInstances.empty())
+        LArPandoraOutput::StitchDaughterPfos(settings, hitRegistry, pfoVector, stitchedPfos);
 
     // Set up ART outputs from RecoBase and AnalysisBase
     std::unique_ptr< std::vector<recob::PFParticle> > outputParticles( new std::vector<recob::PFParticle> );
@@ -81,12 +94,100 @@ void LArPandoraOutput::ProduceArtOutput(const Settings &settings, const IdToHitM
     std::unique_ptr< art::Assns<recob::SpacePoint, recob::Hit> >        outputSpacePointsToHits( new art::Assns<recob::SpacePoint, recob::Hit> );
     std::unique_ptr< art::Assns<recob::Cluster, recob::Hit> >           outputClustersToHits( new art::Assns<recob::Cluster, recob::Hit> );
 
-    // prepare the algorithm to compute the cluster characteristics;
-    // we use the "standard" one here; configuration would happen here,
-    // but we are using the default configuration for that algorithm
-    cluster::StandardClusterParamsAlg ClusterParamAlgo;
+    std::unique_ptr< LArCompactSpacePoints >      outputCompactSpacePoints( new LArCompactSpacePoints );
+    std::unique_ptr< LArHitOwnership >            outputHitOwnership( new LArHitOwnership );
+    std::unique_ptr< LArPFParticleSummaryVector > outputParticleSummaries( new LArPFParticleSummaryVector );
+
+    std::unique_ptr< std::vector<recob::Track> >  outputTracks( new std::vector<recob::Track> );
+    std::unique_ptr< std::vector<recob::Shower> > outputShowers( new std::vector<recob::Shower> );
+    std::unique_ptr< std::vector<recob::PCAxis> > outputPCAxes( new std::vector<recob::PCAxis> );
+
+    std::unique_ptr< art::Assns<recob::PFParticle, recob::Track> >              outputParticlesToTracks( new art::Assns<recob::PFParticle, recob::Track> );
+    std::unique_ptr< art::Assns<recob::Track, recob::Hit> >                     outputTracksToHits( new art::Assns<recob::Track, recob::Hit> );
+    std::unique_ptr< art::Assns<recob::Track, recob::Hit, recob::TrackHitMeta> > outputTracksToHitsWithMeta( new art::Assns<recob::Track, recob::Hit, recob::TrackHitMeta> );
+    std::unique_ptr< art::Assns<recob::PFParticle, recob::Shower> >             outputParticlesToShowers( new art::Assns<recob::PFParticle, recob::Shower> );
+    std::unique_ptr< art::Assns<recob::PFParticle, recob::PCAxis> >             outputParticlesToPCAxes( new art::Assns<recob::PFParticle, recob::PCAxis> );
+    std::unique_ptr< art::Assns<recob::Shower, recob::Hit> >                    outputShowersToHits( new art::Assns<recob::Shower, recob::Hit> );
+    std::unique_ptr< art::Assns<recob::Shower, recob::PCAxis> >                 outputShowersToPCAxes( new art::Assns<recob::Shower, recob::PCAxis> );
 
     size_t particleCounter(0), vertexCounter(0), spacePointCounter(0), clusterCounter(0), t0Counter(0);
+    int trackCounter(0);
+
+    // Look up the output product ids once, rather than once per association
+    const art::PtrMaker<recob::PFParticle> makeParticlePtr(evt, *(settings.m_pProducer));
+    const art::PtrMaker<recob::SpacePoint> makeSpacePointPtr(evt, *(settings.m_pProducer));
+    const art::PtrMaker<recob::Cluster> makeClusterPtr(evt, *(settings.m_pProducer));
+    const art::PtrMaker<recob::Vertex> makeVertexPtr(evt, *(settings.m_pProducer));
+    const art::PtrMaker<anab::T0> makeT0Ptr(evt, *(settings.m_pProducer));
+    const art::PtrMaker<recob::Track> makeTrackPtr(evt, *(settings.m_pProducer));
+    const art::PtrMaker<recob::Shower> makeShowerPtr(evt, *(settings.m_pProducer));
+    const art::PtrMaker<recob::PCAxis> makePCAxisPtr(evt, *(settings.m_pProducer));
+
+    // Spacepoints (with their hit associations) are omitted from the minimal output tier, and may be written in compact form instead
+    const bool shouldBuildSpacePoints((MinimalTier != settings.m_outputTier) && !settings.m_shouldProduceCompactSpacePoints);
+    const bool shouldBuildCompactSpacePoints((MinimalTier != settings.m_outputTier) && settings.m_shouldProduceCompactSpacePoints);
+
+    // Tracks and showers, if requested, are built from the 3D hits of each pfo, without a round trip through the event
+    float wirePitchW(0.f);
+
+    if (settings.m_shouldProduceTracksAndShowers)
+    {
+        art::ServiceHandle<geo::Geometry> theGeometry;
+        wirePitchW = ((theGeometry->MaxPlanes() > 2) ? theGeometry->WirePitch(geo::kW) : 0.5f * (theGeometry->WirePitch(geo::kU) + theGeometry->WirePitch(geo::kV)));
+    }
+
+    // Calculate the T0s up front, as they are independent for each pfo
+    std::vector<double> pfoT0s;
+
+    if (settings.m_shouldRunStitching)
+        LArPandoraOutput::CalculateT0s(settings, hitRegistry, stitchedPfos, pfoVector, pfoT0s);
+
+    // Count the output objects, so that each output vector is allocated once
+    size_t nSpacePoints(0), nClusters(0);
+
+    for (const pandora::ParticleFlowObject *const pPfo : pfoVector)
+    {
+        pandora::PfoVector outputPfos;
+        LArPandoraOutput::GetOutputPfos(stitchedPfos, pPfo, outputPfos);
+
+        for (const pandora::ParticleFlowObject *const pOutputPfo : outputPfos)
+        {
+            if (shouldBuildSpacePoints || shouldBuildCompactSpacePoints)
+            {
+                pandora::CaloHitList pandoraHitList3D;
+                lar_content::LArPfoHelper::GetCaloHits(pOutputPfo, pandora::TPC_3D, pandoraHitList3D);
+                nSpacePoints += pandoraHitList3D.size();
+            }
+
+            // ATTN Clusters spanning several drift volumes are split, so this is a lower bound on the number of output clusters
+            for (const pandora::Cluster *const pCluster : pOutputPfo->GetClusterList())
+            {
+                if (pandora::TPC_3D != lar_content::LArClusterHelper::GetClusterHitType(pCluster))
+                    ++nClusters;
+            }
+        }
+    }
+
+    outputParticles->reserve(pfoVector.size());
+
+    if (shouldBuildSpacePoints)
+        outputSpacePoints->reserve(nSpacePoints);
+
+    // ATTN Assumes one art hit per spacepoint, as the hits are only coalesced in very busy events
+    if (shouldBuildCompactSpacePoints)
+        outputCompactSpacePoints->Reserve(nSpacePoints, nSpacePoints);
+    outputClusters->reserve(nClusters);
+
+    // The cluster parameters are computed after the pfo loop, in parallel, so the hits of each output cluster are kept until then
+    std::vector<HitVector> clusterHitVectors;
+    std::vector<HitList> clusterIsolatedHitLists;
+    std::vector<unsigned int> clusterIsolatedHitIndices;
+    clusterHitVectors.reserve(nClusters);
+    clusterIsolatedHitLists.reserve(nClusters);
+    clusterIsolatedHitIndices.reserve(nClusters);
+
+    // The hit and spacepoint counts of each particle, for the particle summaries
+    std::vector<unsigned int> particleNHitsU, particleNHitsV, particleNHitsW, particleNSpacePoints;
 
     // Build maps of pandora::Pfos and build recob::vertices
     ThreeDParticleMap particleMap;
@@ -94,7 +195,14 @@ void LArPandoraOutput::ProduceArtOutput(const Settings &settings, const IdToHitM
 
     for (const pandora::ParticleFlowObject *const pPfo : pfoVector)
     {
-        particleMap.insert( std::pair<const pandora::ParticleFlowObject*, size_t>(pPfo, particleCounter++) );
+        // ATTN Every pfo of a stitched group maps to the same particle, so that the parents of their daughters are found
+        pandora::PfoVector outputPfos;
+        LArPandoraOutput::GetOutputPfos(stitchedPfos, pPfo, outputPfos);
+
+        for (const pandora::ParticleFlowObject *const pOutputPfo : outputPfos)
+            particleMap.insert( std::pair<const pandora::ParticleFlowObject*, size_t>(pOutputPfo, particleCounter) );
+
+        ++particleCounter;
 
         if (!pPfo->GetVertexList().empty())
         {
@@ -106,7 +214,7 @@ void LArPandoraOutput::ProduceArtOutput(const Settings &settings, const IdToHitM
             if (vertexMap.end() != vertexMap.find(pVertex))
                 continue;
 
-            double pos[3] = {pVertex->GetPosition().GetX(), pVertex->GetPosition().GetY(), pVertex->GetPosition().GetZ()};
+            double pos[3] = {pVertex->GetPosition().GetX() + LArPandoraOutput::GetXShift(stitchedPfos, pPfo), pVertex->GetPosition().GetY(), pVertex->GetPosition().GetZ()};
             outputVertices->emplace_back(recob::Vertex(pos, vertexCounter++));
             vertexMap.insert(std::pair<const pandora::Vertex*, unsigned int>(pVertex, vertexCounter - 1));
         }
@@ -138,9 +246,16 @@ void LArPandoraOutput::ProduceArtOutput(const Settings &settings, const IdToHitM
             parentIdCode = parentIdIter->second;
         }
 
-        // Get Pfo Daughters
+        // Get Pfo Daughters, including those of any pfos stitched to this pfo
+        pandora::PfoVector outputPfos;
+        LArPandoraOutput::GetOutputPfos(stitchedPfos, pPfo, outputPfos);
+
         std::vector<size_t> daughterIdCodes;
-        pandora::PfoVector daughterPfoVector(pPfo->GetDaughterPfoList().begin(), pPfo->GetDaughterPfoList().end());
+        pandora::PfoVector daughterPfoVector;
+
+        for (const pandora::ParticleFlowObject *const pOutputPfo : outputPfos)
+            daughterPfoVector.insert(daughterPfoVector.end(), pOutputPfo->GetDaughterPfoList().begin(), pOutputPfo->GetDaughterPfoList().end());
+
         std::sort(daughterPfoVector.begin(), daughterPfoVector.end(), lar_content::LArPfoHelper::SortByNHits);
 
         for (const pandora::ParticleFlowObject *const pDaughterPfo : daughterPfoVector)
@@ -157,6 +272,14 @@ void LArPandoraOutput::ProduceArtOutput(const Settings &settings, const IdToHitM
         recob::PFParticle newParticle(pPfo->GetParticleId(), pfoIdCode, parentIdCode, daughterIdCodes);
         outputParticles->push_back(newParticle);
 
+        if (settings.m_shouldProduceParticleSummaries)
+        {
+            particleNHitsU.push_back(0);
+            particleNHitsV.push_back(0);
+            particleNHitsW.push_back(0);
+            particleNSpacePoints.push_back(0);
+        }
+
         // Associate Vertex
         if (!pPfo->GetVertexList().empty())
         {
@@ -170,12 +293,15 @@ void LArPandoraOutput::ProduceArtOutput(const Settings &settings, const IdToHitM
                 throw cet::exception("LArPandora") << " LArPandoraOutput::ProduceArtOutput --- found an unassociated vertex ";
 
             const unsigned int vtxElement(iter->second);
-            util::CreateAssn(*(settings.m_pProducer), evt, *(outputParticles.get()), *(outputVertices.get()), *(outputParticlesToVertices.get()),
-                vtxElement, vtxElement + 1);
+            outputParticlesToVertices->addSingle(makeParticlePtr(outputParticles->size() - 1), makeVertexPtr(vtxElement));
         }
 
         // Build 2D Clusters
-        pandora::ClusterVector pandoraClusterVector(pPfo->GetClusterList().begin(), pPfo->GetClusterList().end());
+        pandora::ClusterVector pandoraClusterVector;
+
+        for (const pandora::ParticleFlowObject *const pOutputPfo : outputPfos)
+            pandoraClusterVector.insert(pandoraClusterVector.end(), pOutputPfo->GetClusterList().begin(), pOutputPfo->GetClusterList().end());
+
         std::sort(pandoraClusterVector.begin(), pandoraClusterVector.end(), lar_content::LArClusterHelper::SortByNHits);
 
         for (const pandora::Cluster *const pCluster : pandoraClusterVector)
@@ -195,102 +321,622 @@ void LArPandoraOutput::ProduceArtOutput(const Settings &settings, const IdToHitM
 
             for (const pandora::CaloHit *const pCaloHit2D : pandoraHitVector2D)
             {
-                const art::Ptr<recob::Hit> hit = LArPandoraOutput::GetHit(idToHitMap, pCaloHit2D);
+                const art::Ptr<recob::Hit> hit = LArPandoraOutput::GetHit(hitRegistry, pCaloHit2D);
 
+                // ATTN Coalesced hits lie on the same wire as their representative hit, so share its drift volume
                 const geo::WireID wireID(hit->WireID());
                 const unsigned int volID(100000 * wireID.Cryostat + wireID.TPC);
-                hitArray[volID].push_back(hit);
+                LArPandoraOutput::GetHits(hitRegistry, pCaloHit2D, hitArray[volID]);
 
                 if (pCaloHit2D->IsIsolated())
-                    isolatedHits.insert(hit);
+                {
+                    const int hitId(LArPandoraOutput::GetHitId(pCaloHit2D));
+                    isolatedHits.insert(hitRegistry.Begin(hitId), hitRegistry.End(hitId));
+                }
             }
 
             if (hitArray.empty())
                 throw cet::exception("LArPandora") << " LArPandoraOutput::ProduceArtOutput --- found a cluster with no hits ";
 
-            for (const HitArray::value_type &hitArrayEntry : hitArray)
+            if (settings.m_shouldProduceParticleSummaries)
             {
-                const HitVector &clusterHits(hitArrayEntry.second);
-                outputClusters->emplace_back(LArPandoraOutput::BuildCluster(clusterCounter++, clusterHits, isolatedHits, ClusterParamAlgo));
+                const pandora::HitType hitType(lar_content::LArClusterHelper::GetClusterHitType(pCluster));
+                unsigned int &nHits((pandora::TPC_VIEW_U == hitType) ? particleNHitsU.back() : (pandora::TPC_VIEW_V == hitType) ? particleNHitsV.back() :
+                    particleNHitsW.back());
+
+                for (const HitArray::value_type &hitArrayEntry : hitArray)
+                    nHits += hitArrayEntry.second.size();
+            }
+
+            clusterIsolatedHitLists.push_back(std::move(isolatedHits));
+
+            for (HitArray::value_type &hitArrayEntry : hitArray)
+            {
+                // ATTN Each cluster is stored now, as a placeholder, so that cluster ids and associations follow the serial order
+                HitVector &clusterHits(hitArrayEntry.second);
+                outputClusters->emplace_back();
+                ++clusterCounter;
+
+                const art::Ptr<recob::Cluster> clusterPtr(makeClusterPtr(outputClusters->size() - 1));
 
-                util::CreateAssn(*(settings.m_pProducer), evt, *(outputClusters.get()), clusterHits, *(outputClustersToHits.get()));
-                util::CreateAssn(*(settings.m_pProducer), evt, *(outputParticles.get()), *(outputClusters.get()), *(outputParticlesToClusters.get()),
-                    outputClusters->size() - 1, outputClusters->size());
+                for (const art::Ptr<recob::Hit> &hit : clusterHits)
+                {
+                    outputClustersToHits->addSingle(clusterPtr, hit);
 
-                LOG_DEBUG("LArPandora") << "Stored cluster ID=" << outputClusters->back().ID() << " (#" << (outputClusters->size() - 1)
+                    if (settings.m_shouldProduceHitOwnership)
+                        LArPandoraOutput::SetHitOwner(hit, outputParticles->size() - 1, *outputHitOwnership);
+                }
+
+                outputParticlesToClusters->addSingle(makeParticlePtr(outputParticles->size() - 1), clusterPtr);
+
+                LOG_DEBUG("LArPandora") << "Stored cluster ID=" << (clusterCounter - 1) << " (#" << (outputClusters->size() - 1)
                     << ") with " << clusterHits.size() << " hits";
+
+                clusterHitVectors.push_back(std::move(clusterHits));
+                clusterIsolatedHitIndices.push_back(clusterIsolatedHitLists.size() - 1);
             }
         }
 
-        // Build 3D SpacePoints and calculate T0 from shift in 2D hits
-        pandora::CaloHitList pandoraHitList3D;
-        lar_content::LArPfoHelper::GetCaloHits(pPfo, pandora::TPC_3D, pandoraHitList3D);
+        // Build 3D SpacePoints
+        pandora::CaloHitVector pandoraHitVector3D;
 
-        pandora::CaloHitVector pandoraHitVector3D(pandoraHitList3D.begin(), pandoraHitList3D.end());
-        std::sort(pandoraHitVector3D.begin(), pandoraHitVector3D.end(), lar_content::LArClusterHelper::SortHitsByPosition);
+        if (shouldBuildSpacePoints || shouldBuildCompactSpacePoints || settings.m_shouldProduceTracksAndShowers || settings.m_shouldProduceParticleSummaries)
+            LArPandoraOutput::GetOutputCaloHits3D(stitchedPfos, pPfo, pandoraHitVector3D);
 
-        double sumT(0.), sumN(0.);
+        if (settings.m_shouldProduceParticleSummaries)
+            particleNSpacePoints.back() = pandoraHitVector3D.size();
 
         for (const pandora::CaloHit *const pCaloHit3D : pandoraHitVector3D)
         {
             if (pandora::TPC_3D != pCaloHit3D->GetHitType())
                 throw cet::exception("LArPandora") << " LArPandoraOutput::ProduceArtOutput --- found a 2D hit in a 3D cluster";
 
-            const pandora::CaloHit *const pCaloHit2D = static_cast<const pandora::CaloHit*>(pCaloHit3D->GetParentAddress());
+            if (!shouldBuildSpacePoints && !shouldBuildCompactSpacePoints)
+                continue;
 
-            const art::Ptr<recob::Hit> hit = LArPandoraOutput::GetHit(idToHitMap, pCaloHit2D);
+            const pandora::CaloHit *const pCaloHit2D = static_cast<const pandora::CaloHit*>(pCaloHit3D->GetParentAddress());
 
             HitVector spacePointHits;
-            spacePointHits.push_back(hit);
+            LArPandoraOutput::GetHits(hitRegistry, pCaloHit2D, spacePointHits);
 
-            // ATTN: We assume that the 2D Pandora hits have been shifted
-            sumT += LArPandoraOutput::CalculateT0(hit, pCaloHit2D);
-            sumN += 1.;
+            if (shouldBuildCompactSpacePoints)
+            {
+                std::vector<unsigned int> hitKeys;
+
+                for (const art::Ptr<recob::Hit> &spacePointHit : spacePointHits)
+                {
+                    // ATTN The input hits are read from a single collection, so a single product id suffices
+                    if (0 == outputCompactSpacePoints->GetNSpacePoints() && hitKeys.empty())
+                        outputCompactSpacePoints->SetHitProductId(spacePointHit.id());
+
+                    if (spacePointHit.id() != outputCompactSpacePoints->GetHitProductId())
+                        throw cet::exception("LArPandora") << " LArPandoraOutput::ProduceArtOutput --- compact spacepoints require hits from a single collection ";
+
+                    hitKeys.push_back(spacePointHit.key());
+                }
+
+                const pandora::CartesianVector &position(pCaloHit3D->GetPositionVector());
+                outputCompactSpacePoints->AddSpacePoint(position.GetX() + LArPandoraOutput::GetXShift(stitchedPfos, pCaloHit3D), position.GetY(), position.GetZ(),
+                    outputParticles->size() - 1, hitKeys);
+                continue;
+            }
+
+            outputSpacePoints->emplace_back(LArPandoraOutput::BuildSpacePoint(spacePointCounter++, pCaloHit3D, LArPandoraOutput::GetXShift(stitchedPfos, pCaloHit3D)));
+
+            const art::Ptr<recob::SpacePoint> spacePointPtr(makeSpacePointPtr(outputSpacePoints->size() - 1));
+
+            for (const art::Ptr<recob::Hit> &spacePointHit : spacePointHits)
+                outputSpacePointsToHits->addSingle(spacePointPtr, spacePointHit);
+        }
 
-            outputSpacePoints->emplace_back(LArPandoraOutput::BuildSpacePoint(spacePointCounter++, pCaloHit3D));
+        // Associate the particle with its spacepoints, which occupy a contiguous index range
+        const art::Ptr<recob::PFParticle> particlePtr(makeParticlePtr(outputParticles->size() - 1));
 
-            util::CreateAssn(*(settings.m_pProducer), evt, *(outputSpacePoints.get()), spacePointHits, *(outputSpacePointsToHits.get()));
-            util::CreateAssn(*(settings.m_pProducer), evt, *(outputParticles.get()), *(outputSpacePoints.get()), *(outputParticlesToSpacePoints.get()),
-                outputSpacePoints->size() - 1, outputSpacePoints->size());
+        if (shouldBuildSpacePoints)
+        {
+            for (size_t spacePointIndex = outputSpacePoints->size() - pandoraHitVector3D.size(); spacePointIndex < outputSpacePoints->size(); ++spacePointIndex)
+                outputParticlesToSpacePoints->addSingle(particlePtr, makeSpacePointPtr(spacePointIndex));
+        }
+
+        // Build Track or Shower, with the same selection and fits as the LArPandoraTrackCreation and LArPandoraShowerCreation modules
+        if (settings.m_shouldProduceTracksAndShowers && !pandoraHitVector3D.empty() && (1 == pPfo->GetVertexList().size()))
+        {
+            pandora::CartesianPointVector cartesianPointVector;
+            cartesianPointVector.reserve(pandoraHitVector3D.size());
+
+            for (const pandora::CaloHit *const pCaloHit3D : pandoraHitVector3D)
+                cartesianPointVector.push_back(pCaloHit3D->GetPositionVector() + pandora::CartesianVector(LArPandoraOutput::GetXShift(stitchedPfos, pCaloHit3D), 0.f, 0.f));
+
+            const pandora::CartesianVector vertexPosition(pPfo->GetVertexList().front()->GetPosition() +
+                pandora::CartesianVector(LArPandoraOutput::GetXShift(stitchedPfos, pPfo), 0.f, 0.f));
+
+            if (settings.m_useAllParticles || lar_content::LArPfoHelper::IsTrack(pPfo))
+            {
+                // Call pandora "fast" track fitter
+                lar_content::LArTrackStateVector trackStateVector;
+                pandora::IntVector indexVector;
+
+                try
+                {
+                    lar_content::LArPfoHelper::GetSlidingFitTrajectory(cartesianPointVector, vertexPosition, settings.m_slidingFitHalfWindow, wirePitchW,
+                        trackStateVector, &indexVector);
+                }
+                catch (const pandora::StatusCodeException &)
+                {
+                    mf::LogDebug("LArPandora") << "Unable to extract sliding fit trajectory";
+                    trackStateVector.clear();
+                }
+
+                if (trackStateVector.size() < settings.m_minTrajectoryPoints)
+                {
+                    mf::LogDebug("LArPandora") << "Insufficient input trajectory points to build track: " << trackStateVector.size();
+                }
+                else
+                {
+                    // Hits are ordered by trajectory point, with only the representative hit of any coalesced hits, so each point has one hit
+                    HitVector trackHits;
+
+                    for (const int index : indexVector)
+                        trackHits.push_back(LArPandoraOutput::GetHit(hitRegistry, static_cast<const pandora::CaloHit*>(pandoraHitVector3D.at(index)->GetParentAddress())));
+
+                    // Add invalid points at the end of the vector, so that the number of the trajectory points is the same as the number of hits
+                    if (trackStateVector.size() > trackHits.size())
+                        throw cet::exception("LArPandora") << " LArPandoraOutput::ProduceArtOutput --- more trajectory points than hits for a track ";
+
+                    const pandora::CartesianVector bogusVector(util::kBogusF, util::kBogusF, util::kBogusF);
+
+                    while (trackStateVector.size() < trackHits.size())
+                        trackStateVector.push_back(lar_content::LArTrackState(bogusVector, bogusVector, nullptr));
+
+                    outputTracks->emplace_back(LArPandoraOutput::BuildTrack(trackCounter++, trackStateVector));
+                    const art::Ptr<recob::Track> trackPtr(makeTrackPtr(outputTracks->size() - 1));
+
+                    outputParticlesToTracks->addSingle(particlePtr, trackPtr);
+
+                    for (unsigned int hitIndex = 0; hitIndex < trackHits.size(); ++hitIndex)
+                    {
+                        outputTracksToHits->addSingle(trackPtr, trackHits.at(hitIndex));
+                        outputTracksToHitsWithMeta->addSingle(trackPtr, trackHits.at(hitIndex), recob::TrackHitMeta(hitIndex, -std::numeric_limits<double>::max()));
+                    }
+                }
+            }
+
+            if (settings.m_useAllParticles || lar_content::LArPfoHelper::IsShower(pPfo))
+            {
+                // Call pandora "fast" shower fitter, ensuring successful creation of all structures before placing results in output containers
+                bool isShowerBuilt(false);
+
+                try
+                {
+                    const lar_content::LArShowerPCA larShowerPCA(lar_content::LArPfoHelper::GetPrincipalComponents(cartesianPointVector, vertexPosition));
+                    const recob::Shower shower(LArPandoraOutput::BuildShower(larShowerPCA, vertexPosition));
+                    const recob::PCAxis pcAxis(LArPandoraOutput::BuildPCAxis(larShowerPCA));
+                    outputShowers->emplace_back(shower);
+                    outputPCAxes->emplace_back(pcAxis);
+                    isShowerBuilt = true;
+                }
+                catch (const pandora::StatusCodeException &)
+                {
+                    mf::LogDebug("LArPandora") << "Unable to extract shower pca";
+                }
+
+                if (isShowerBuilt)
+                {
+                    const art::Ptr<recob::Shower> showerPtr(makeShowerPtr(outputShowers->size() - 1));
+                    const art::Ptr<recob::PCAxis> pcAxisPtr(makePCAxisPtr(outputPCAxes->size() - 1));
+
+                    outputParticlesToShowers->addSingle(particlePtr, showerPtr);
+                    outputParticlesToPCAxes->addSingle(particlePtr, pcAxisPtr);
+                    outputShowersToPCAxes->addSingle(showerPtr, pcAxisPtr);
+
+                    for (const pandora::CaloHit *const pCaloHit3D : pandoraHitVector3D)
+                    {
+                        HitVector showerHits;
+                        LArPandoraOutput::GetHits(hitRegistry, static_cast<const pandora::CaloHit*>(pCaloHit3D->GetParentAddress()), showerHits);
+
+                        for (const art::Ptr<recob::Hit> &showerHit : showerHits)
+                            outputShowersToHits->addSingle(showerPtr, showerHit);
+                    }
+                }
+            }
         }
 
         // Output T0 objects [arguments are:  time (nanoseconds);  trigger type (3 for TPC stitching!);  pfparticle SelfID code;  T0 ID code]
         // ATTN: T0 values are currently calculated in nanoseconds relative to the trigger offset. Only non-zero values are outputted.
-        const double T0((sumN > 0. && std::fabs(sumT) > sumN) ? (sumT / sumN) : 0.);
+        const double T0(settings.m_shouldRunStitching ? pfoT0s.at(pfoIdCode) : 0.);
 
-        if (settings.m_shouldRunStitching && std::fabs(T0) > 0.)
+        if (std::fabs(T0) > 0.)
         {
             outputT0s->emplace_back(anab::T0(T0, 3, outputParticles->back().Self(), t0Counter++));
-            util::CreateAssn(*(settings.m_pProducer), evt, *(outputParticles.get()), *(outputT0s.get()), *(outputParticlesToT0s.get()), outputT0s->size() - 1, outputT0s->size());
+            outputParticlesToT0s->addSingle(particlePtr, makeT0Ptr(outputT0s->size() - 1));
         }
     }
 
+    LArPandoraOutput::BuildClusters(settings, clusterHitVectors, clusterIsolatedHitLists, clusterIsolatedHitIndices, *outputClusters);
+
+    if (settings.m_shouldProduceHitOwnership)
+        LArPandoraOutput::SetPFParticleAncestry(*outputParticles, *outputHitOwnership);
+
+    if (settings.m_shouldProduceParticleSummaries)
+    {
+        // ATTN The product id of the output pfparticle collection, taken from a Ptr that is never dereferenced
+        LArPandoraOutput::BuildPFParticleSummaries(makeParticlePtr(0).id(), *outputParticles, particleNHitsU, particleNHitsV, particleNHitsW,
+            particleNSpacePoints, *outputParticleSummaries);
+    }
+
     mf::LogDebug("LArPandora") << "   Number of new particles: " << outputParticles->size() << std::endl;
     mf::LogDebug("LArPandora") << "   Number of new clusters: " << outputClusters->size() << std::endl;
-    mf::LogDebug("LArPandora") << "   Number of new space points: " << outputSpacePoints->size() << std::endl;
+
+    if (shouldBuildSpacePoints)
+        mf::LogDebug("LArPandora") << "   Number of new space points: " << outputSpacePoints->size() << std::endl;
+
+    if (shouldBuildCompactSpacePoints)
+        mf::LogDebug("LArPandora") << "   Number of new compact space points: " << outputCompactSpacePoints->GetNSpacePoints() << std::endl;
+
     mf::LogDebug("LArPandora") << "   Number of new vertices: " << outputVertices->size() << std::endl;
 
     if (settings.m_shouldRunStitching)
         mf::LogDebug("LArPandora") << "   Number of new T0s: " << outputT0s->size() << std::endl;
 
+    if (settings.m_shouldProduceTracksAndShowers)
+    {
+        mf::LogDebug("LArPandora") << "   Number of new tracks: " << outputTracks->size() << std::endl;
+        mf::LogDebug("LArPandora") << "   Number of new showers: " << outputShowers->size() << std::endl;
+    }
+
+    const unsigned int nOutputParticles(outputParticles->size());
+
     evt.put(std::move(outputParticles));
-    evt.put(std::move(outputSpacePoints));
     evt.put(std::move(outputClusters));
     evt.put(std::move(outputVertices));
 
-    evt.put(std::move(outputParticlesToSpacePoints));
     evt.put(std::move(outputParticlesToClusters));
     evt.put(std::move(outputParticlesToVertices));
-    evt.put(std::move(outputSpacePointsToHits));
     evt.put(std::move(outputClustersToHits));
 
+    if (shouldBuildSpacePoints)
+    {
+        evt.put(std::move(outputSpacePoints));
+        evt.put(std::move(outputParticlesToSpacePoints));
+        evt.put(std::move(outputSpacePointsToHits));
+    }
+
+    if (shouldBuildCompactSpacePoints)
+        evt.put(std::move(outputCompactSpacePoints));
+
+    if (settings.m_shouldProduceHitOwnership)
+        evt.put(std::move(outputHitOwnership));
+
+    if (settings.m_shouldProduceParticleSummaries)
+        evt.put(std::move(outputParticleSummaries));
+
     if (settings.m_shouldRunStitching)
     {
         evt.put(std::move(outputT0s));
         evt.put(std::move(outputParticlesToT0s));
     }
 
+    if (settings.m_shouldProduceTracksAndShowers)
+    {
+        evt.put(std::move(outputTracks));
+        evt.put(std::move(outputShowers));
+        evt.put(std::move(outputPCAxes));
+
+        evt.put(std::move(outputParticlesToTracks));
+        evt.put(std::move(outputTracksToHits));
+        evt.put(std::move(outputTracksToHitsWithMeta));
+        evt.put(std::move(outputParticlesToShowers));
+        evt.put(std::move(outputParticlesToPCAxes));
+        evt.put(std::move(outputShowersToHits));
+        evt.put(std::move(outputShowersToPCAxes));
+    }
+
     mf::LogDebug("LArPandora") << " *** LArPandora::ProduceArtOutput() [DONE!] *** " << std::endl;
+
+    return nOutputParticles;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void LArPandoraOutput::CollectPfos(const Settings &settings, pandora::PfoVector &pfoVector)
+{
+    if (!pfoVector.empty())
+        throw cet::exception("LArPandora") << " LArPandoraOutput::CollectPfos --- trying to collect pfos into a non-empty vector ";
+
+    if (!settings.m_pPrimaryPandora)
+        throw cet::exception("LArPandora") << " LArPandoraOutput::CollectPfos --- primary Pandora instance does not exist ";
+
+    // Pfos are taken from the primary instance or, if in use, from each daughter instance
+    std::vector<const pandora::Pandora*> pandoraInstances;
+
+    if (settings.m_daughterPandoraInstances.empty())
+        pandoraInstances.push_back(settings.m_pPrimaryPandora);
+
+    for (const VolumeIdToPandoraMap::value_type &daughterEntry : settings.m_daughterPandoraInstances)
+        pandoraInstances.push_back(daughterEntry.second);
+
+    pandora::PfoList connectedPfoList;
+
+    for (const pandora::Pandora *const pPandora : pandoraInstances)
+    {
+        const pandora::PfoList *pPfoList(nullptr);
+        PANDORA_THROW_RESULT_IF(pandora::STATUS_CODE_SUCCESS, !=, PandoraApi::GetCurrentPfoList(*pPandora, pPfoList));
+        lar_content::LArPfoHelper::GetAllConnectedPfos(*pPfoList, connectedPfoList);
+    }
+
+    pfoVector.insert(pfoVector.end(), connectedPfoList.begin(), connectedPfoList.end());
+    std::sort(pfoVector.begin(), pfoVector.end(), lar_content::LArPfoHelper::SortByNHits);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void LArPandoraOutput::StitchDaughterPfos(const Settings &settings, const LArHitRegistry &hitRegistry, pandora::PfoVector &pfoVector, StitchedPfos &stitchedPfos)
+{
+    LArPandoraGeometryTable localGeometryTable;
+    const LArPandoraGeometryTable &geometryTable(LArPandoraOutput::GetGeometryTable(settings, localGeometryTable));
+
+    // Describe the ends of the primary track-like pfos of each daughter instance, using the principal axis of their 3D hits
+    std::vector<StitchingCandidate> candidates;
+
+    for (const VolumeIdToPandoraMap::value_type &daughterEntry : settings.m_daughterPandoraInstances)
+    {
+        const pandora::PfoList *pPfoList(nullptr);
+        PANDORA_THROW_RESULT_IF(pandora::STATUS_CODE_SUCCESS, !=, PandoraApi::GetCurrentPfoList(*daughterEntry.second, pPfoList));
+
+        for (const pandora::ParticleFlowObject *const pPfo : *pPfoList)
+        {
+            if (!pPfo->GetParentPfoList().empty() || !lar_content::LArPfoHelper::IsTrack(pPfo))
+                continue;
+
+            pandora::CaloHitList pandoraHitList3D;
+            lar_content::LArPfoHelper::GetCaloHits(pPfo, pandora::TPC_3D, pandoraHitList3D);
+
+            if (pandoraHitList3D.size() < std::max(settings.m_stitchingMinHits, 2u))
+                continue;
+
+            pandora::CartesianPointVector cartesianPointVector;
+
+            for (const pandora::CaloHit *const pCaloHit3D : pandoraHitList3D)
+                cartesianPointVector.push_back(pCaloHit3D->GetPositionVector());
+
+            // ATTN Every plane of a drift volume shares its drift direction, so any hit gives the T0 per unit x shift for the pfo
+            const art::Ptr<recob::Hit> hit(LArPandoraOutput::GetHit(hitRegistry, static_cast<const pandora::CaloHit*>(pandoraHitList3D.front()->GetParentAddress())));
+            const double t0PerXShift(geometryTable.GetPlane(hit->WireID()).ConvertXShiftToT0(1.));
+
+            try
+            {
+                const lar_content::LArShowerPCA larPCA(lar_content::LArPfoHelper::GetPrincipalComponents(cartesianPointVector, cartesianPointVector.front()));
+                const pandora::CartesianVector direction(larPCA.GetPrimaryAxis().GetUnitVector());
+
+                float minProjection(std::numeric_limits<float>::max()), maxProjection(-std::numeric_limits<float>::max());
+                pandora::CartesianVector firstPosition(cartesianPointVector.front()), secondPosition(cartesianPointVector.front());
+
+                for (const pandora::CartesianVector &position : cartesianPointVector)
+                {
+                    const float projection(direction.GetDotProduct(position - larPCA.GetCentroid()));
+
+                    if (projection < minProjection)
+                    {
+                        minProjection = projection;
+                        firstPosition = position;
+                    }
+
+                    if (projection > maxProjection)
+                    {
+                        maxProjection = projection;
+                        secondPosition = position;
+                    }
+                }
+
+                candidates.emplace_back(pPfo, daughterEntry.first, t0PerXShift, direction, firstPosition, secondPosition);
+            }
+            catch (const pandora::StatusCodeException &)
+            {
+                mf::LogDebug("LArPandora") << "Unable to extract principal axis for stitching";
+            }
+        }
+    }
+
+    // Find the candidate links between the ends of pfos in different drift volumes
+    std::vector<StitchingLink> links;
+
+    for (unsigned int iCandidate = 0; iCandidate < candidates.size(); ++iCandidate)
+    {
+        const StitchingCandidate &firstCandidate(candidates.at(iCandidate));
+
+        for (unsigned int jCandidate = iCandidate + 1; jCandidate < candidates.size(); ++jCandidate)
+        {
+            const StitchingCandidate &secondCandidate(candidates.at(jCandidate));
+
+            if ((firstCandidate.m_volumeId == secondCandidate.m_volumeId) ||
+                (std::fabs(firstCandidate.m_direction.GetDotProduct(secondCandidate.m_direction)) < settings.m_stitchingMinCosRelativeAngle))
+            {
+                continue;
+            }
+
+            // ATTN A T0 shifts pfos in volumes drifting in opposite directions by opposite amounts in x, so only their y and z must match
+            const bool isOppositeDrift(firstCandidate.m_t0PerXShift * secondCandidate.m_t0PerXShift < 0.);
+
+            for (unsigned int firstEnd = 0; firstEnd < 2; ++firstEnd)
+            {
+                const pandora::CartesianVector &firstPosition(0 == firstEnd ? firstCandidate.m_firstPosition : firstCandidate.m_secondPosition);
+
+                for (unsigned int secondEnd = 0; secondEnd < 2; ++secondEnd)
+                {
+                    const pandora::CartesianVector &secondPosition(0 == secondEnd ? secondCandidate.m_firstPosition : secondCandidate.m_secondPosition);
+                    const double dx(secondPosition.GetX() - firstPosition.GetX());
+                    const double dy(secondPosition.GetY() - firstPosition.GetY());
+                    const double dz(secondPosition.GetZ() - firstPosition.GetZ());
+                    const double displacement(std::sqrt((isOppositeDrift ? 0. : dx * dx) + dy * dy + dz * dz));
+
+                    if (displacement > settings.m_stitchingMaxDisplacement)
+                        continue;
+
+                    // The ends meet halfway, so the first pfo is shifted by half of the x separation
+                    links.push_back({iCandidate, firstEnd, jCandidate, secondEnd, displacement, isOppositeDrift,
+                        isOppositeDrift ? firstCandidate.m_t0PerXShift * 0.5 * dx : 0.});
+                }
+            }
+        }
+    }
+
+    // Accept the links in order of increasing displacement, using each pfo end at most once and never closing a loop
+    std::sort(links.begin(), links.end(), [](const StitchingLink &lhs, const StitchingLink &rhs)
+    {
+        if (lhs.m_displacement != rhs.m_displacement)
+            return (lhs.m_displacement < rhs.m_displacement);
+
+        return ((lhs.m_firstIndex != rhs.m_firstIndex) ? (lhs.m_firstIndex < rhs.m_firstIndex) : (lhs.m_secondIndex < rhs.m_secondIndex));
+    });
+
+    std::vector<unsigned int> groupIndices(candidates.size());
+    std::vector<bool> isEndUsed(2 * candidates.size(), false);
+
+    for (unsigned int iCandidate = 0; iCandidate < candidates.size(); ++iCandidate)
+        groupIndices.at(iCandidate) = iCandidate;
+
+    const auto getGroupIndex = [&groupIndices](unsigned int index)
+    {
+        while (groupIndices.at(index) != index)
+            index = groupIndices.at(index) = groupIndices.at(groupIndices.at(index));
+
+        return index;
+    };
+
+    std::vector<StitchingLink> acceptedLinks;
+
+    for (const StitchingLink &link : links)
+    {
+        const unsigned int firstGroupIndex(getGroupIndex(link.m_firstIndex)), secondGroupIndex(getGroupIndex(link.m_secondIndex));
+
+        if ((firstGroupIndex == secondGroupIndex) || isEndUsed.at(2 * link.m_firstIndex + link.m_firstEnd) || isEndUsed.at(2 * link.m_secondIndex + link.m_secondEnd))
+            continue;
+
+        isEndUsed.at(2 * link.m_firstIndex + link.m_firstEnd) = true;
+        isEndUsed.at(2 * link.m_secondIndex + link.m_secondEnd) = true;
+        groupIndices.at(secondGroupIndex) = firstGroupIndex;
+        acceptedLinks.push_back(link);
+    }
+
+    if (acceptedLinks.empty())
+        return;
+
+    // Each stitched group takes the mean T0 of its links across volumes drifting in opposite directions
+    std::map<unsigned int, std::vector<unsigned int>> groupToCandidates;
+    std::map<unsigned int, std::pair<double, unsigned int>> groupToT0Sum;
+
+    for (unsigned int iCandidate = 0; iCandidate < candidates.size(); ++iCandidate)
+        groupToCandidates[getGroupIndex(iCandidate)].push_back(iCandidate);
+
+    for (const StitchingLink &link : acceptedLinks)
+    {
+        if (!link.m_hasT0)
+            continue;
+
+        std::pair<double, unsigned int> &t0Sum(groupToT0Sum[getGroupIndex(link.m_firstIndex)]);
+        t0Sum.first += link.m_t0;
+        ++t0Sum.second;
+    }
+
+    // ATTN The output order is that of the sorted pfo vector, so the representative of each group is its first pfo in that order
+    std::unordered_map<const pandora::ParticleFlowObject*, unsigned int> pfoToIndex;
+
+    for (unsigned int iPfo = 0; iPfo < pfoVector.size(); ++iPfo)
+        pfoToIndex[pfoVector.at(iPfo)] = iPfo;
+
+    std::unordered_set<const pandora::ParticleFlowObject*> stitchedPfoSet;
+
+    for (const auto &groupEntry : groupToCandidates)
+    {
+        if (groupEntry.second.size() < 2)
+            continue;
+
+        pandora::PfoVector groupPfos;
+
+        for (const unsigned int iCandidate : groupEntry.second)
+            groupPfos.push_back(candidates.at(iCandidate).m_pPfo);
+
+        std::sort(groupPfos.begin(), groupPfos.end(), [&pfoToIndex](const pandora::ParticleFlowObject *const pLhs, const pandora::ParticleFlowObject *const pRhs)
+        {
+            return (pfoToIndex.at(pLhs) < pfoToIndex.at(pRhs));
+        });
+
+        const auto t0Iter(groupToT0Sum.find(groupEntry.first));
+        const double t0((groupToT0Sum.end() != t0Iter && t0Iter->second.second > 0) ? (t0Iter->second.first / t0Iter->second.second) : 0.);
+
+        for (const unsigned int iCandidate : groupEntry.second)
+        {
+            const StitchingCandidate &candidate(candidates.at(iCandidate));
+            const double xShift((std::fabs(candidate.m_t0PerXShift) > std::numeric_limits<double>::epsilon()) ? (t0 / candidate.m_t0PerXShift) : 0.);
+
+            // The whole hierarchy of each stitched pfo is shifted, as for the stitching within a single pandora instance
+            pandora::PfoList connectedPfoList;
+            lar_content::LArPfoHelper::GetAllConnectedPfos(pandora::PfoList(1, candidate.m_pPfo), connectedPfoList);
+
+            for (const pandora::ParticleFlowObject *const pConnectedPfo : connectedPfoList)
+            {
+                stitchedPfos.m_pfoXShiftMap[pConnectedPfo] = xShift;
+
+                pandora::CaloHitList pandoraHitList3D;
+                lar_content::LArPfoHelper::GetCaloHits(pConnectedPfo, pandora::TPC_3D, pandoraHitList3D);
+
+                for (const pandora::CaloHit *const pCaloHit3D : pandoraHitList3D)
+                    stitchedPfos.m_caloHitXShiftMap[pCaloHit3D] = xShift;
+            }
+
+            if (candidate.m_pPfo != groupPfos.front())
+                stitchedPfoSet.insert(candidate.m_pPfo);
+        }
+
+        mf::LogDebug("LArPandora") << "   Stitched " << groupPfos.size() << " pfos across drift volumes, with T0 " << t0 << " ns " << std::endl;
+        stitchedPfos.m_stitchedPfoMap[groupPfos.front()] = groupPfos;
+    }
+
+    pfoVector.erase(std::remove_if(pfoVector.begin(), pfoVector.end(), [&stitchedPfoSet](const pandora::ParticleFlowObject *const pPfo)
+    {
+        return (stitchedPfoSet.count(pPfo) > 0);
+    }), pfoVector.end());
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void LArPandoraOutput::BuildClusters(const Settings &settings, const std::vector<HitVector> &clusterHitVectors,
+    const std::vector<HitList> &isolatedHitLists, const std::vector<unsigned int> &isolatedHitIndices, std::vector<recob::Cluster> &outputClusters)
+{
+    const unsigned int nClusters(clusterHitVectors.size());
+
+    if ((isolatedHitIndices.size() != nClusters) || (outputClusters.size() != nClusters))
+        throw cet::exception("LArPandora") << " LArPandoraOutput::BuildClusters --- inconsistent numbers of clusters provided ";
+
+    if (FullTier == settings.m_outputTier)
+    {
+        // prepare the algorithm to compute the cluster characteristics;
+        // we use the "standard" one here; configuration would happen here,
+        // but we are using the default configuration for that algorithm
+        // ATTN The algorithm looks up the geometry and detector properties providers as it sets the hits, so it is run on this thread only
+        cluster::StandardClusterParamsAlg ClusterParamAlgo;
+
+        for (unsigned int iCluster = 0; iCluster < nClusters; ++iCluster)
+        {
+            const HitList &isolatedHits(isolatedHitLists.at(isolatedHitIndices[iCluster]));
+            outputClusters[iCluster] = LArPandoraOutput::BuildCluster(iCluster, clusterHitVectors[iCluster], isolatedHits, ClusterParamAlgo);
+        }
+
+        return;
+    }
+
+    // Below the full output tier, only the cluster end points and hit sums are filled, from the hits alone, so the clusters can be built
+    // concurrently. Each worker takes every nWorkers-th cluster, so that clusters of very different sizes are shared out evenly
+    const unsigned int nWorkers(std::max(1u, std::min(settings.m_nThreads, nClusters)));
+
+    LArPandoraParallel::ForEach(nWorkers, nWorkers, [&](const unsigned int iWorker)
+    {
+        for (unsigned int iCluster = iWorker; iCluster < nClusters; iCluster += nWorkers)
+        {
+            const HitList &isolatedHits(isolatedHitLists.at(isolatedHitIndices[iCluster]));
+            outputClusters[iCluster] = LArPandoraOutput::BuildCluster(iCluster, clusterHitVectors[iCluster], isolatedHits);
+        }
+    });
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
@@ -299,21 +945,91 @@ recob::Cluster LArPandoraOutput::BuildCluster(const int id, const HitVector &hit
 {
     mf::LogDebug("LArPandora") << "   Building Cluster [" << id << "], Number of hits = " << hitVector.size() << std::endl;
 
-    if (hitVector.empty())
-        throw cet::exception("LArPandora") << " LArPandoraOutput::BuildCluster --- No input hits were provided ";
-
     // Fill list of cluster properties
-    geo::View_t view(geo::kUnknown);
-    geo::PlaneID planeID;
-
-    double startWire(+std::numeric_limits<float>::max()), sigmaStartWire(0.0);
-    double startTime(+std::numeric_limits<float>::max()), sigmaStartTime(0.0);
-    double endWire(-std::numeric_limits<float>::max()), sigmaEndWire(0.0);
-    double endTime(-std::numeric_limits<float>::max()), sigmaEndTime(0.0);
+    const ClusterEndPoints endPoints(LArPandoraOutput::GetClusterEndPoints(hitVector, isolatedHits));
 
     std::vector<recob::Hit const*> hits_for_params;
     hits_for_params.reserve(hitVector.size());
 
+    for (const art::Ptr<recob::Hit> &hit : hitVector)
+        hits_for_params.push_back(&*hit);
+
+    // feed the algorithm with all the cluster hits
+    algo.SetHits(hits_for_params);
+
+    // create the recob::Cluster directly in the vector
+    return cluster::ClusterCreator(
+      algo,                         // algo
+      endPoints.m_startWire,        // start_wire
+      endPoints.m_sigmaStartWire,   // sigma_start_wire
+      endPoints.m_startTime,        // start_tick
+      endPoints.m_sigmaStartTime,   // sigma_start_tick
+      endPoints.m_endWire,          // end_wire
+      endPoints.m_sigmaEndWire,     // sigma_end_wire
+      endPoints.m_endTime,          // end_tick
+      endPoints.m_sigmaEndTime,     // sigma_end_tick
+      id,                           // ID
+      endPoints.m_view,             // view
+      endPoints.m_planeID,          // plane
+      recob::Cluster::Sentry        // sentry
+      ).move();
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+recob::Cluster LArPandoraOutput::BuildCluster(const int id, const HitVector &hitVector, const HitList &isolatedHits)
+{
+    mf::LogDebug("LArPandora") << "   Building lightweight Cluster [" << id << "], Number of hits = " << hitVector.size() << std::endl;
+
+    const ClusterEndPoints endPoints(LArPandoraOutput::GetClusterEndPoints(hitVector, isolatedHits));
+
+    float integral(0.f), summedADC(0.f);
+
+    for (const art::Ptr<recob::Hit> &hit : hitVector)
+    {
+        integral += hit->Integral();
+        summedADC += hit->SummedADC();
+    }
+
+    // ATTN The charge, angle, opening, width and density parameters are set to bogus values, as no cluster parameter algorithm is run
+    return recob::Cluster(
+      endPoints.m_startWire,        // start_wire
+      endPoints.m_sigmaStartWire,   // sigma_start_wire
+      endPoints.m_startTime,        // start_tick
+      endPoints.m_sigmaStartTime,   // sigma_start_tick
+      util::kBogusF,                // start_charge
+      util::kBogusF,                // start_angle
+      util::kBogusF,                // start_opening
+      endPoints.m_endWire,          // end_wire
+      endPoints.m_sigmaEndWire,     // sigma_end_wire
+      endPoints.m_endTime,          // end_tick
+      endPoints.m_sigmaEndTime,     // sigma_end_tick
+      util::kBogusF,                // end_charge
+      util::kBogusF,                // end_angle
+      util::kBogusF,                // end_opening
+      integral,                     // integral
+      0.f,                          // integral_stddev
+      summedADC,                    // summedADC
+      0.f,                          // summedADC_stddev
+      hitVector.size(),             // n_hits
+      util::kBogusF,                // multiple_hit_density
+      util::kBogusF,                // width
+      id,                           // ID
+      endPoints.m_view,             // view
+      endPoints.m_planeID,          // plane
+      recob::Cluster::Sentry        // sentry
+      );
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+LArPandoraOutput::ClusterEndPoints LArPandoraOutput::GetClusterEndPoints(const HitVector &hitVector, const HitList &isolatedHits)
+{
+    if (hitVector.empty())
+        throw cet::exception("LArPandora") << " LArPandoraOutput::BuildCluster --- No input hits were provided ";
+
+    ClusterEndPoints endPoints;
+
     for (const art::Ptr<recob::Hit> &hit : hitVector)
     {
         const double thisWire(hit->WireID().Wire);
@@ -323,70 +1039,49 @@ recob::Cluster LArPandoraOutput::BuildCluster(const int id, const HitVector &hit
         const geo::View_t thisView(hit->View());
         const geo::PlaneID thisPlaneID(hit->WireID().planeID());
 
-        if (geo::kUnknown == view)
+        if (geo::kUnknown == endPoints.m_view)
         {
-            view = thisView;
-            planeID = thisPlaneID;
+            endPoints.m_view = thisView;
+            endPoints.m_planeID = thisPlaneID;
         }
 
-        if (!(thisView == view && thisPlaneID == planeID))
+        if (!(thisView == endPoints.m_view && thisPlaneID == endPoints.m_planeID))
         {
             throw cet::exception("LArPandora") << " LArPandoraOutput::BuildCluster --- Input hits have inconsistent plane IDs ";
         }
 
-        hits_for_params.push_back(&*hit);
-
         if (isolatedHits.count(hit))
             continue;
 
-        if (thisWire < startWire || (thisWire == startWire && thisTime < startTime))
+        if (thisWire < endPoints.m_startWire || (thisWire == endPoints.m_startWire && thisTime < endPoints.m_startTime))
         {
-            startWire = thisWire;
-            sigmaStartWire = thisWireSigma;
-            startTime = thisTime;
-            sigmaStartTime = thisTimeSigma;
+            endPoints.m_startWire = thisWire;
+            endPoints.m_sigmaStartWire = thisWireSigma;
+            endPoints.m_startTime = thisTime;
+            endPoints.m_sigmaStartTime = thisTimeSigma;
         }
 
-        if (thisWire > endWire || (thisWire == endWire && thisTime > endTime))
+        if (thisWire > endPoints.m_endWire || (thisWire == endPoints.m_endWire && thisTime > endPoints.m_endTime))
         {
-            endWire = thisWire;
-            sigmaEndWire = thisWireSigma;
-            endTime = thisTime;
-            sigmaEndTime = thisTimeSigma;
+            endPoints.m_endWire = thisWire;
+            endPoints.m_sigmaEndWire = thisWireSigma;
+            endPoints.m_endTime = thisTime;
+            endPoints.m_sigmaEndTime = thisTimeSigma;
         }
-
     }
 
-    // feed the algorithm with all the cluster hits
-    algo.SetHits(hits_for_params);
-
-    // create the recob::Cluster directly in the vector
-    return cluster::ClusterCreator(
-      algo,                  // algo
-      startWire,             // start_wire
-      sigmaStartWire,        // sigma_start_wire
-      startTime,             // start_tick
-      sigmaStartTime,        // sigma_start_tick
-      endWire,               // end_wire
-      sigmaEndWire,          // sigma_end_wire
-      endTime,               // end_tick
-      sigmaEndTime,          // sigma_end_tick
-      id,                    // ID
-      view,                  // view
-      planeID,               // plane
-      recob::Cluster::Sentry // sentry
-      ).move();
+    return endPoints;
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
-recob::SpacePoint LArPandoraOutput::BuildSpacePoint(const int id, const pandora::CaloHit *const pCaloHit)
+recob::SpacePoint LArPandoraOutput::BuildSpacePoint(const int id, const pandora::CaloHit *const pCaloHit, const double xShift)
 {
     if (pandora::TPC_3D != pCaloHit->GetHitType())
         throw cet::exception("LArPandora") << " LArPandoraOutput::BuildSpacePoint --- trying to build a space point from a 2D hit";
 
     const pandora::CartesianVector point(pCaloHit->GetPositionVector());
-    double xyz[3] = { point.GetX(), point.GetY(), point.GetZ() };
+    double xyz[3] = { point.GetX() + xShift, point.GetY(), point.GetZ() };
     double dxdydz[6] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 }; // TODO: Fill in the error matrix
     double chi2(0.0);
 
@@ -395,42 +1090,339 @@ recob::SpacePoint LArPandoraOutput::BuildSpacePoint(const int id, const pandora:
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
-art::Ptr<recob::Hit> LArPandoraOutput::GetHit(const IdToHitMap &idToHitMap, const pandora::CaloHit *const pCaloHit)
+recob::Track LArPandoraOutput::BuildTrack(const int id, const lar_content::LArTrackStateVector &trackStateVector)
+{
+    if (trackStateVector.empty())
+        throw cet::exception("LArPandora") << " LArPandoraOutput::BuildTrack --- No input trajectory points provided ";
+
+    recob::tracking::Positions_t xyz;
+    recob::tracking::Momenta_t pxpypz;
+    recob::TrackTrajectory::Flags_t flags;
+
+    for (const lar_content::LArTrackState &trackState : trackStateVector)
+    {
+        xyz.emplace_back(recob::tracking::Point_t(trackState.GetPosition().GetX(), trackState.GetPosition().GetY(), trackState.GetPosition().GetZ()));
+        pxpypz.emplace_back(recob::tracking::Vector_t(trackState.GetDirection().GetX(), trackState.GetDirection().GetY(), trackState.GetDirection().GetZ()));
+        // Set flag NoPoint if point has bogus coordinates, otherwise use clean flag set
+        if (std::fabs(trackState.GetPosition().GetX()-util::kBogusF)<std::numeric_limits<float>::epsilon() &&
+            std::fabs(trackState.GetPosition().GetY()-util::kBogusF)<std::numeric_limits<float>::epsilon() &&
+            std::fabs(trackState.GetPosition().GetZ()-util::kBogusF)<std::numeric_limits<float>::epsilon())
+        {
+            flags.emplace_back(recob::TrajectoryPointFlags(recob::TrajectoryPointFlags::InvalidHitIndex, recob::TrajectoryPointFlagTraits::NoPoint));
+        } else {
+            flags.emplace_back(recob::TrajectoryPointFlags());
+        }
+    }
+
+    // note from gc: eventually we should produce a TrackTrajectory, not a Track with empty covariance matrix and bogus chi2, etc.
+    return recob::Track(recob::TrackTrajectory(std::move(xyz), std::move(pxpypz), std::move(flags), false),
+                        util::kBogusI, util::kBogusF, util::kBogusI, recob::tracking::SMatrixSym55(), recob::tracking::SMatrixSym55(), id);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+recob::Shower LArPandoraOutput::BuildShower(const lar_content::LArShowerPCA &larShowerPCA, const pandora::CartesianVector &vertexPosition)
+{
+    const pandora::CartesianVector &showerLength(larShowerPCA.GetAxisLengths());
+    const pandora::CartesianVector &showerDirection(larShowerPCA.GetPrimaryAxis());
+
+    const float length(showerLength.GetX());
+    const float openingAngle(larShowerPCA.GetPrimaryLength() > 0.f ? std::atan(larShowerPCA.GetSecondaryLength() / larShowerPCA.GetPrimaryLength()) : 0.f);
+    const TVector3 direction(showerDirection.GetX(), showerDirection.GetY(), showerDirection.GetZ());
+    const TVector3 vertex(vertexPosition.GetX(), vertexPosition.GetY(), vertexPosition.GetZ());
+
+    // TODO
+    const TVector3 directionErr;
+    const TVector3 vertexErr;
+    const std::vector<double> totalEnergyErr;
+    const std::vector<double> dEdx;
+    const std::vector<double> dEdxErr;
+    const std::vector<double> totalEnergy;
+    const int bestplane(0);
+
+    return recob::Shower(direction, directionErr, vertex, vertexErr, totalEnergy, totalEnergyErr, dEdx, dEdxErr, bestplane, util::kBogusI, length, openingAngle);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+recob::PCAxis LArPandoraOutput::BuildPCAxis(const lar_content::LArShowerPCA &larShowerPCA)
+{
+    const pandora::CartesianVector &showerCentroid(larShowerPCA.GetCentroid());
+    const pandora::CartesianVector &showerDirection(larShowerPCA.GetPrimaryAxis());
+    const pandora::CartesianVector &showerSecondaryVector(larShowerPCA.GetSecondaryAxis());
+    const pandora::CartesianVector &showerTertiaryVector(larShowerPCA.GetTertiaryAxis());
+    const pandora::CartesianVector &showerEigenValues(larShowerPCA.GetEigenValues());
+
+    const bool svdOK(true); ///< SVD Decomposition was successful
+    const double eigenValues[3] = {showerEigenValues.GetX(), showerEigenValues.GetY(), showerEigenValues.GetZ()}; ///< Eigen values from SVD decomposition
+    const double avePosition[3] = {showerCentroid.GetX(), showerCentroid.GetY(), showerCentroid.GetZ()}; ///< Average position of hits fed to PCA
+
+    std::vector< std::vector<double> > eigenVecs = { /// The three principle axes
+        { showerDirection.GetX(), showerDirection.GetY(), showerDirection.GetZ() },
+        { showerSecondaryVector.GetX(), showerSecondaryVector.GetY(), showerSecondaryVector.GetZ() },
+        { showerTertiaryVector.GetX(), showerTertiaryVector.GetY(), showerTertiaryVector.GetZ() }
+    };
+
+    // TODO
+    const int numHitsUsed(100); ///< Number of hits in the decomposition, not yet ready
+    const double aveHitDoca(0.); ///< Average doca of hits used in PCA, not ready yet
+    const size_t iD(util::kBogusI); ///< Axis ID, not ready yet
+
+    return recob::PCAxis(svdOK, numHitsUsed, eigenValues, eigenVecs, avePosition, aveHitDoca, iD);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+art::Ptr<recob::Hit> LArPandoraOutput::GetHit(const LArHitRegistry &hitRegistry, const pandora::CaloHit *const pCaloHit)
+{
+    return hitRegistry.GetHit(pCaloHit->GetParentAddress());
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void LArPandoraOutput::GetHits(const LArHitRegistry &hitRegistry, const pandora::CaloHit *const pCaloHit, HitVector &hitVector)
+{
+    const int hitId(LArPandoraOutput::GetHitId(pCaloHit));
+
+    if (!hitRegistry.HasHit(hitId))
+        throw cet::exception("LArPandora") << " LArPandoraOutput::GetHits --- found a Pandora hit without a parent ART hit ";
+
+    hitVector.insert(hitVector.end(), hitRegistry.Begin(hitId), hitRegistry.End(hitId));
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+int LArPandoraOutput::GetHitId(const pandora::CaloHit *const pCaloHit)
 {
-    const void *const pHitAddress(pCaloHit->GetParentAddress());
-    const intptr_t hitID_temp((intptr_t)(pHitAddress));
-    const int hitID((int)(hitID_temp));
+    const intptr_t hitID_temp((intptr_t)(pCaloHit->GetParentAddress()));
+    return (int)(hitID_temp);
+}
 
-    IdToHitMap::const_iterator artIter = idToHitMap.find(hitID);
+//------------------------------------------------------------------------------------------------------------------------------------------
 
-    if (idToHitMap.end() == artIter)
-        throw cet::exception("LArPandora") << " LArPandoraOutput::GetHit --- found a Pandora hit without a parent ART hit ";
+void LArPandoraOutput::GetOutputPfos(const StitchedPfos &stitchedPfos, const pandora::ParticleFlowObject *const pPfo, pandora::PfoVector &outputPfos)
+{
+    PfoToPfoVectorMap::const_iterator iter(stitchedPfos.m_stitchedPfoMap.find(pPfo));
 
-    return artIter->second;
+    if (stitchedPfos.m_stitchedPfoMap.end() == iter)
+    {
+        outputPfos.push_back(pPfo);
+        return;
+    }
+
+    outputPfos.insert(outputPfos.end(), iter->second.begin(), iter->second.end());
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
-double LArPandoraOutput::CalculateT0(const art::Ptr<recob::Hit> hit, const pandora::CaloHit *const pCaloHit)
+void LArPandoraOutput::GetOutputCaloHits3D(const StitchedPfos &stitchedPfos, const pandora::ParticleFlowObject *const pPfo, pandora::CaloHitVector &caloHitVector3D)
 {
-    art::ServiceHandle<geo::Geometry> theGeometry;
-    auto const* theDetector = lar::providerFrom<detinfo::DetectorPropertiesService>();
+    pandora::PfoVector outputPfos;
+    LArPandoraOutput::GetOutputPfos(stitchedPfos, pPfo, outputPfos);
+
+    pandora::CaloHitList pandoraHitList3D;
 
-    const geo::WireID hit_WireID(hit->WireID());
-    const geo::TPCGeo &theTpc = theGeometry->Cryostat(hit_WireID.Cryostat).TPC(hit_WireID.TPC);
+    for (const pandora::ParticleFlowObject *const pOutputPfo : outputPfos)
+        lar_content::LArPfoHelper::GetCaloHits(pOutputPfo, pandora::TPC_3D, pandoraHitList3D);
+
+    caloHitVector3D.insert(caloHitVector3D.end(), pandoraHitList3D.begin(), pandoraHitList3D.end());
+    std::sort(caloHitVector3D.begin(), caloHitVector3D.end(), lar_content::LArClusterHelper::SortHitsByPosition);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+double LArPandoraOutput::GetXShift(const StitchedPfos &stitchedPfos, const pandora::ParticleFlowObject *const pPfo)
+{
+    PfoToXShiftMap::const_iterator iter(stitchedPfos.m_pfoXShiftMap.find(pPfo));
+    return ((stitchedPfos.m_pfoXShiftMap.end() != iter) ? iter->second : 0.);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+double LArPandoraOutput::GetXShift(const StitchedPfos &stitchedPfos, const pandora::CaloHit *const pCaloHit3D)
+{
+    CaloHitToXShiftMap::const_iterator iter(stitchedPfos.m_caloHitXShiftMap.find(pCaloHit3D));
+    return ((stitchedPfos.m_caloHitXShiftMap.end() != iter) ? iter->second : 0.);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+const LArPandoraGeometryTable &LArPandoraOutput::GetGeometryTable(const Settings &settings, LArPandoraGeometryTable &localGeometryTable)
+{
+    if (settings.m_pGeometryTable)
+        return *(settings.m_pGeometryTable);
+
+    // ATTN The output stage needs only the drift constants and wire coordinates, not the drift volume ids, so an empty drift volume map suffices
+    localGeometryTable.Build(LArDriftVolumeMap(), *(settings.m_pPrimaryPandora));
+    return localGeometryTable;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+double LArPandoraOutput::CalculateT0(const LArPandoraGeometryTable &geometryTable, const art::Ptr<recob::Hit> hit, const pandora::CaloHit *const pCaloHit,
+    const double xShift)
+{
+    const LArPlaneGeometry &plane(geometryTable.GetPlane(hit->WireID()));
 
     // Calculate shift in x position between input and output hits
-    const double input_xpos_cm(theDetector->ConvertTicksToX(hit->PeakTime(), hit_WireID.Plane, hit_WireID.TPC, hit_WireID.Cryostat));
-    const double output_xpos_dm(pCaloHit->GetPositionVector().GetX());
-    const double x0_cm(output_xpos_dm - input_xpos_cm);
+    const double input_xpos_cm(plane.ConvertTicksToX(hit->PeakTime()));
+    const double output_xpos_dm(pCaloHit->GetPositionVector().GetX() + xShift);
+
+    return plane.ConvertXShiftToT0(output_xpos_dm - input_xpos_cm);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void LArPandoraOutput::CalculateT0s(const Settings &settings, const LArHitRegistry &hitRegistry, const StitchedPfos &stitchedPfos, const pandora::PfoVector &pfoVector,
+    std::vector<double> &pfoT0s)
+{
+    LArPandoraGeometryTable localGeometryTable;
+    const LArPandoraGeometryTable &geometryTable(LArPandoraOutput::GetGeometryTable(settings, localGeometryTable));
+
+    pfoT0s.assign(pfoVector.size(), 0.);
+
+    LArPandoraParallel::ForEach(pfoVector.size(), settings.m_nThreads, [&](const unsigned int iPfo)
+    {
+        // ATTN The hits are summed in the same (position) order as the output spacepoints, so that the T0s do not depend on the output tier
+        pandora::CaloHitVector pandoraHitVector3D;
+        LArPandoraOutput::GetOutputCaloHits3D(stitchedPfos, pfoVector[iPfo], pandoraHitVector3D);
+
+        double sumT(0.), sumN(0.);
+
+        for (const pandora::CaloHit *const pCaloHit3D : pandoraHitVector3D)
+        {
+            if (pandora::TPC_3D != pCaloHit3D->GetHitType())
+                throw cet::exception("LArPandora") << " LArPandoraOutput::CalculateT0s --- found a 2D hit in a 3D cluster";
+
+            const pandora::CaloHit *const pCaloHit2D = static_cast<const pandora::CaloHit*>(pCaloHit3D->GetParentAddress());
+
+            // ATTN: We assume that the 2D Pandora hits have been shifted, other than by the stitching of daughter instance pfos
+            sumT += LArPandoraOutput::CalculateT0(geometryTable, LArPandoraOutput::GetHit(hitRegistry, pCaloHit2D), pCaloHit2D,
+                LArPandoraOutput::GetXShift(stitchedPfos, pCaloHit3D));
+            sumN += 1.;
+        }
+
+        pfoT0s[iPfo] = ((sumN > 0. && std::fabs(sumT) > sumN) ? (sumT / sumN) : 0.);
+    });
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void LArPandoraOutput::SetHitOwner(const art::Ptr<recob::Hit> &hit, const unsigned int pfParticleIndex, LArHitOwnership &hitOwnership)
+{
+    // ATTN A single hit product id, as for the compact spacepoints in ProduceArtOutput
+    if (hitOwnership.GetPFParticleIndices().empty())
+        hitOwnership.SetHitProductId(hit.id());
 
-    // The ingredients for the T0 calculation all come from the detector properties service
-    const double dir((theTpc.DriftDirection() == geo::kNegX) ? 1.0 : -1.0);
-    const double cm_per_tick(theDetector->GetXTicksCoefficient());
-    const double ns_per_tick(theDetector->SamplingRate());
+    if (hit.id() != hitOwnership.GetHitProductId())
+        throw cet::exception("LArPandora") << " LArPandoraOutput::SetHitOwner --- hit ownership requires hits from a single collection ";
 
-    // This calculation should give the T0 in nanoseconds relative to the initial 2D hit
-    return (- dir * x0_cm * ns_per_tick / cm_per_tick);
+    hitOwnership.SetPFParticleIndex(hit.key(), pfParticleIndex);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void LArPandoraOutput::SetPFParticleAncestry(const std::vector<recob::PFParticle> &particles, LArHitOwnership &hitOwnership)
+{
+    std::vector<unsigned int> rootIndices, finalStateIndices, neutrinoIndices;
+    std::vector<int> generations;
+    LArPandoraOutput::GetPFParticleAncestry(particles, rootIndices, finalStateIndices, generations);
+
+    for (const unsigned int rootIndex : rootIndices)
+        neutrinoIndices.push_back(LArPandoraOutput::IsNeutrino(particles.at(rootIndex)) ? rootIndex : LArHitOwnership::InvalidIndex);
+
+    hitOwnership.SetPFParticleAncestry(finalStateIndices, neutrinoIndices);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void LArPandoraOutput::BuildPFParticleSummaries(const art::ProductID &pfParticleProductId, const std::vector<recob::PFParticle> &particles,
+    const std::vector<unsigned int> &nHitsU, const std::vector<unsigned int> &nHitsV, const std::vector<unsigned int> &nHitsW,
+    const std::vector<unsigned int> &nSpacePoints, LArPFParticleSummaryVector &summaries)
+{
+    if ((nHitsU.size() != particles.size()) || (nHitsV.size() != particles.size()) || (nHitsW.size() != particles.size()) ||
+        (nSpacePoints.size() != particles.size()))
+    {
+        throw cet::exception("LArPandora") << " LArPandoraOutput::BuildPFParticleSummaries --- inconsistent numbers of particles provided ";
+    }
+
+    std::vector<unsigned int> rootIndices, finalStateIndices;
+    std::vector<int> generations;
+    LArPandoraOutput::GetPFParticleAncestry(particles, rootIndices, finalStateIndices, generations);
+
+    summaries.reserve(summaries.size() + particles.size());
+
+    for (size_t index = 0; index < particles.size(); ++index)
+    {
+        const recob::PFParticle &particle(particles.at(index));
+        const recob::PFParticle &rootParticle(particles.at(rootIndices.at(index)));
+
+        summaries.emplace_back(pfParticleProductId, particle.IsPrimary() ? LArPFParticleSummary::InvalidIndex : particle.Parent(),
+            rootIndices.at(index), finalStateIndices.at(index), generations.at(index),
+            LArPandoraOutput::IsNeutrino(rootParticle) ? rootParticle.PdgCode() : 0, nHitsU.at(index), nHitsV.at(index), nHitsW.at(index),
+            nSpacePoints.at(index));
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void LArPandoraOutput::GetPFParticleAncestry(const std::vector<recob::PFParticle> &particles, std::vector<unsigned int> &rootIndices,
+    std::vector<unsigned int> &finalStateIndices, std::vector<int> &generations)
+{
+    // ATTN The pfparticle ids are their indices in the output vector, so parent ids can be used as indices
+    for (const recob::PFParticle &particle : particles)
+    {
+        if (particle.Self() >= particles.size())
+            throw cet::exception("LArPandora") << " LArPandoraOutput::GetPFParticleAncestry --- found a particle id beyond the output particles ";
+
+        // Navigate upward through the parent links, as in LArPandoraHelper::GetParentPFParticle, GetFinalStatePFParticle and GetGeneration
+        size_t finalStateIndex(particle.Self()), primaryIndex(particle.Self());
+        int generation(1);
+
+        while (!particles.at(primaryIndex).IsPrimary())
+        {
+            const size_t parentIndex(particles.at(primaryIndex).Parent());
+
+            if (parentIndex >= particles.size())
+                throw cet::exception("LArPandora") << " LArPandoraOutput::GetPFParticleAncestry --- found a particle without a parent particle ";
+
+            if (!LArPandoraOutput::IsNeutrino(particles.at(parentIndex)) && (finalStateIndex == primaryIndex))
+                finalStateIndex = parentIndex;
+
+            primaryIndex = parentIndex;
+            ++generation;
+        }
+
+        rootIndices.push_back(primaryIndex);
+        finalStateIndices.push_back(finalStateIndex);
+        generations.push_back(generation);
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+bool LArPandoraOutput::IsNeutrino(const recob::PFParticle &particle)
+{
+    const int pdg(std::abs(particle.PdgCode()));
+
+    // electron, muon, tau (use Pandora PDG tables)
+    return ((pandora::NU_E == pdg) || (pandora::NU_MU == pdg) || (pandora::NU_TAU == pdg));
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+LArPandoraOutput::OutputTier LArPandoraOutput::GetOutputTier(const std::string &name)
+{
+    if ("minimal" == name)
+        return MinimalTier;
+
+    if ("standard" == name)
+        return StandardTier;
+
+    if ("full" == name)
+        return FullTier;
+
+    throw cet::exception("LArPandora") << " LArPandoraOutput::GetOutputTier --- unknown output tier " << name << " (expected minimal, standard or full) ";
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
@@ -438,7 +1430,50 @@ double LArPandoraOutput::CalculateT0(const art::Ptr<recob::Hit> hit, const pando
 LArPandoraOutput::Settings::Settings() :
     m_pPrimaryPandora(nullptr),
     m_pProducer(nullptr),
-    m_shouldRunStitching(false)
+    m_shouldRunStitching(false),
+    m_nThreads(1),
+    m_outputTier(FullTier),
+    m_pGeometryTable(nullptr),
+    m_shouldProduceCompactSpacePoints(false),
+    m_shouldProduceHitOwnership(false),
+    m_shouldProduceParticleSummaries(false),
+    m_shouldProduceTracksAndShowers(false),
+    m_minTrajectoryPoints(2),
+    m_slidingFitHalfWindow(20),
+    m_useAllParticles(false),
+    m_stitchingMaxDisplacement(5.),
+    m_stitchingMinCosRelativeAngle(0.98),
+    m_stitchingMinHits(10)
+{
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+LArPandoraOutput::ClusterEndPoints::ClusterEndPoints() :
+    m_view(geo::kUnknown),
+    m_startWire(+std::numeric_limits<float>::max()),
+    m_sigmaStartWire(0.0),
+    m_startTime(+std::numeric_limits<float>::max()),
+    m_sigmaStartTime(0.0),
+    m_endWire(-std::numeric_limits<float>::max()),
+    m_sigmaEndWire(0.0),
+    m_endTime(-std::numeric_limits<float>::max()),
+    m_sigmaEndTime(0.0)
+{
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+LArPandoraOutput::StitchingCandidate::StitchingCandidate(const pandora::ParticleFlowObject *const pPfo, const unsigned int volumeId, const double t0PerXShift,
+        const pandora::CartesianVector &direction, const pandora::CartesianVector &firstPosition, const pandora::CartesianVector &secondPosition) :
+    m_pPfo(pPfo),
+    m_volumeId(volumeId),
+    m_t0PerXShift(t0PerXShift),
+    m_direction(direction),
+    m_firstPosition(firstPosition),
+    m_secondPosition(secondPosition)
 {
 }
 
@@ -8,12 +8,25 @@
 #define LAR_PANDORA_OUTPUT_H
 
 #include "lardataobj/RecoBase/Cluster.h"
+#include "lardataobj/RecoBase/PCAxis.h"
+#include "lardataobj/RecoBase/Shower.h"
+#include "lardataobj/RecoBase/Track.h"
 
 #include "larreco/RecoAlg/ClusterRecoUtil/ClusterParamsAlgBase.h"
 
+#include "Pandora/PandoraInternal.h"
+
+#include "larpandoracontent/LArObjects/LArPfoObjects.h"
+
+#include "larpandora/LArPandoraObjects/LArPFParticleSummary.h"
+
 #include "larpandora/LArPandoraInterface/ILArPandora.h"
+#include "larpandora/LArPandoraInterface/LArPandoraGeometryTable.h"
 #include "larpandora/LArPandoraInterface/LArPandoraHelper.h"
 
+#include <string>
+#include <unordered_map>
+
 namespace art {class EDProducer;}
 namespace pandora {class Pandora; class CaloHit;}
 
@@ -22,9 +35,21 @@ namespace pandora {class Pandora; class CaloHit;}
 namespace lar_pandora
 {
 
+class LArHitOwnership;
+
 class LArPandoraOutput
 {
 public:
+    /**
+     *  @brief  The output tiers, each of which contains the products of the tiers below it
+     */
+    enum OutputTier
+    {
+        MinimalTier,                                            ///< Particles, vertices and clusters with their hits, without cluster parameters
+        StandardTier,                                           ///< As minimal, plus spacepoints and their associations
+        FullTier                                                ///< As standard, plus the cluster parameters from the cluster parameter algorithms
+    };
+
     /**
      *  @brief  Settings class
      */
@@ -39,16 +64,81 @@ public:
         const pandora::Pandora *m_pPrimaryPandora;              ///<
         art::EDProducer        *m_pProducer;                    ///<
         bool                    m_shouldRunStitching;           ///<
+        VolumeIdToPandoraMap    m_daughterPandoraInstances;     ///< If not empty, output pfos are collected from these instances
+        unsigned int            m_nThreads;                     ///< The number of threads used to compute cluster parameters
+        OutputTier              m_outputTier;                   ///< The output tier, controlling which products and derived quantities are produced
+        const LArPandoraGeometryTable *m_pGeometryTable;        ///< The precomputed geometry table (if null, a table is built when needed)
+        bool                    m_shouldProduceCompactSpacePoints; ///< Whether to write spacepoints as a single compact product, instead of recob::SpacePoints
+        bool                    m_shouldProduceHitOwnership;    ///< Whether to write the owning pfparticle of each hit, with its final-state and neutrino ancestry
+        bool                    m_shouldProduceParticleSummaries; ///< Whether to write the hierarchy summary, hit and spacepoint counts of each pfparticle
+        bool                    m_shouldProduceTracksAndShowers; ///< Whether to build tracks, showers and pc axes directly from the output pfos
+        unsigned int            m_minTrajectoryPoints;          ///< The minimum number of trajectory points for an output track
+        unsigned int            m_slidingFitHalfWindow;         ///< The sliding fit half window for the output track trajectories
+        bool                    m_useAllParticles;              ///< Whether to build both a track and a shower for every output pfo, rather than by pdg
+        double                  m_stitchingMaxDisplacement;     ///< The maximum displacement between the ends of daughter instance pfos to be stitched, in cm
+        double                  m_stitchingMinCosRelativeAngle; ///< The minimum cosine of the angle between daughter instance pfos to be stitched
+        unsigned int            m_stitchingMinHits;             ///< The minimum number of 3D hits for a daughter instance pfo to be stitched
     };
 
+    typedef std::unordered_map<const pandora::ParticleFlowObject*, pandora::PfoVector> PfoToPfoVectorMap;
+    typedef std::unordered_map<const pandora::ParticleFlowObject*, double> PfoToXShiftMap;
+    typedef std::unordered_map<const pandora::CaloHit*, double> CaloHitToXShiftMap;
+
+    /**
+     *  @brief  StitchedPfos class, describing the daughter instance pfos stitched across drift volume boundaries
+     */
+    class StitchedPfos
+    {
+    public:
+        PfoToPfoVectorMap       m_stitchedPfoMap;               ///< The pfos of each stitched group, keyed by the pfo representing the group in the output
+        PfoToXShiftMap          m_pfoXShiftMap;                 ///< The x shift of each pfo in a stitched group, and of its downstream pfos
+        CaloHitToXShiftMap      m_caloHitXShiftMap;             ///< The x shift of each 3D hit of the pfos in the x shift map
+    };
+
+    /**
+     *  @brief  Get the output tier from its (FHiCL) name
+     *
+     *  @param  name the name of the output tier: minimal, standard or full
+     *
+     *  @return the output tier
+     */
+    static OutputTier GetOutputTier(const std::string &name);
+
     /**
      *  @brief  Convert the Pandora PFOs into ART clusters and write into ART event
      *
      *  @param  settings the settings
-     *  @param  idToHitMap the mapping from Pandora hit ID to ART hit
+     *  @param  hitRegistry the registry of ART hits, by Pandora hit ID
      *  @param  evt the ART event
+     *
+     *  @return the number of output particles
+     */
+    static unsigned int ProduceArtOutput(const Settings &settings, const LArHitRegistry &hitRegistry, art::Event &evt);
+
+    /**
+     *  @brief  Collect all output pfos and their daughters, sorted by number of hits
+     *
+     *  @param  settings the settings
+     *  @param  pfoVector to receive the sorted vector of output pfos
      */
-    static void ProduceArtOutput(const Settings &settings, const IdToHitMap &idToHitMap, art::Event &evt);
+    static void CollectPfos(const Settings &settings, pandora::PfoVector &pfoVector);
+
+    /**
+     *  @brief  Stitch the primary track-like pfos of the daughter instances across drift volume boundaries, so that each stitched group is
+     *          output as a single particle. Pfos from volumes drifting in opposite directions are stitched with the T0 that joins their ends.
+     *
+     *          This is not equivalent to the stitching and cosmic-ray tagging of the LArMaster algorithm in a single instance. Each daughter
+     *          runs its full algorithm chain on its own volume, so a neutrino interaction crossing volumes is output as separate particles,
+     *          and only primary track-like pfos are joined here: their ends are taken from the principal axis of their 3D hits, groups are
+     *          formed greedily and each group takes the average T0 of its joins. The PFParticleComparison analyzer compares the output with
+     *          that of the standard single-instance path, run on the same hits.
+     *
+     *  @param  settings the settings
+     *  @param  hitRegistry the registry of ART hits, by Pandora hit ID
+     *  @param  pfoVector the output pfos, from which all but the representative pfo of each stitched group are removed
+     *  @param  stitchedPfos to receive the stitched groups and their x shifts
+     */
+    static void StitchDaughterPfos(const Settings &settings, const LArHitRegistry &hitRegistry, pandora::PfoVector &pfoVector, StitchedPfos &stitchedPfos);
 
     /**
      *  @brief Build a recob::Cluster object from an input vector of recob::Hit objects
@@ -63,31 +153,282 @@ public:
      */
     static recob::Cluster BuildCluster(const int id, const HitVector &hitVector, const HitList &isolatedHits, cluster::ClusterParamsAlgBase &algo);
 
+    /**
+     *  @brief Build a lightweight recob::Cluster object from an input vector of recob::Hit objects, without running a cluster parameter algorithm
+     *
+     *  @param id the id code for the cluster
+     *  @param hitVector the input vector of hits
+     *  @param isolatedHits the input list of isolated hits
+     *
+     *  Only the start and end points, the summed hit charges and the number of hits are filled; the charge, angle, opening,
+     *  width and density parameters are set to util::kBogusF.
+     */
+    static recob::Cluster BuildCluster(const int id, const HitVector &hitVector, const HitList &isolatedHits);
+
+    /**
+     *  @brief Build the recob::Cluster objects for a list of output clusters, with the cluster ids given by the indices in the output vector.
+     *         At the full output tier, the cluster parameter algorithm uses art services, so is run serially on the calling thread; below
+     *         it, the clusters are built in parallel. The results are independent of the number of threads.
+     *
+     *  @param settings the settings
+     *  @param clusterHitVectors the input vector of hits for each cluster
+     *  @param isolatedHitLists the input lists of isolated hits
+     *  @param isolatedHitIndices the index of the list of isolated hits for each cluster
+     *  @param outputClusters the output clusters, with one (placeholder) entry per cluster, to receive the built clusters
+     */
+    static void BuildClusters(const Settings &settings, const std::vector<HitVector> &clusterHitVectors, const std::vector<HitList> &isolatedHitLists,
+        const std::vector<unsigned int> &isolatedHitIndices, std::vector<recob::Cluster> &outputClusters);
+
     /**
      *  @brief Build a recob::SpacePoint object
      *
      *  @param id the id code for the spacepoint
      *  @param pCaloHit the input Pandora hit (3D)
+     *  @param xShift the shift in x position, non-zero only for the hits of stitched pfos
+     */
+    static recob::SpacePoint BuildSpacePoint(const int id, const pandora::CaloHit *const pCaloHit, const double xShift);
+
+    /**
+     *  @brief Build a recob::Track object
+     *
+     *  @param id the id code for the track
+     *  @param trackStateVector the vector of trajectory points for this track
+     */
+    static recob::Track BuildTrack(const int id, const lar_content::LArTrackStateVector &trackStateVector);
+
+    /**
+     *  @brief Build a recob::Shower object
+     *
+     *  @param larShowerPCA the lar shower pca parameters extracted from pandora
+     *  @param vertexPosition the shower vertex position
+     */
+    static recob::Shower BuildShower(const lar_content::LArShowerPCA &larShowerPCA, const pandora::CartesianVector &vertexPosition);
+
+    /**
+     *  @brief Build a recob::PCAxis object
+     *
+     *  @param larShowerPCA the lar shower pca parameters extracted from pandora
+     */
+    static recob::PCAxis BuildPCAxis(const lar_content::LArShowerPCA &larShowerPCA);
+
+    /**
+     *  @brief Lookup (representative) ART hit from an input Pandora hit
+     *
+     *  @param hitRegistry the registry of ART hits, by Pandora hit ID
+     *  @param pCaloHit the input Pandora hit (2D)
+     */
+    static art::Ptr<recob::Hit> GetHit(const LArHitRegistry &hitRegistry, const pandora::CaloHit *const pCaloHit);
+
+    /**
+     *  @brief Lookup all ART hits from an input Pandora hit, which has several if it was made by coalescing ART hits
+     *
+     *  @param hitRegistry the registry of ART hits, by Pandora hit ID
+     *  @param pCaloHit the input Pandora hit (2D)
+     *  @param hitVector to receive the ART hits
      */
-    static recob::SpacePoint BuildSpacePoint(const int id, const pandora::CaloHit *const pCaloHit);
+    static void GetHits(const LArHitRegistry &hitRegistry, const pandora::CaloHit *const pCaloHit, HitVector &hitVector);
 
     /**
-     *  @brief Lookup ART hit from an input Pandora hit
+     *  @brief Get the Pandora hit ID of an input Pandora hit
      *
-     *  @param idToHitMap the mapping between Pandora and ART hits
      *  @param pCaloHit the input Pandora hit (2D)
      */
-    static art::Ptr<recob::Hit> GetHit(const IdToHitMap &idToHitMap, const pandora::CaloHit *const pCaloHit);
+    static int GetHitId(const pandora::CaloHit *const pCaloHit);
 
     /**
-     *  @brief Convert X0 correction into T0 correction
+     *  @brief Convert X0 correction into T0 correction, using the drift constants in a precomputed geometry table
      *
+     *  @param geometryTable the precomputed geometry table
      *  @param hit the input ART hit
      *  @param pCaloHit the output Pandora hit
+     *  @param xShift the further shift in x position applied at output, non-zero only for the hits of stitched pfos
      *
      *  @return T0 relative to input hit in nanoseconds
      */
-    static double CalculateT0(const art::Ptr<recob::Hit> hit, const pandora::CaloHit *const pCaloHit);
+    static double CalculateT0(const LArPandoraGeometryTable &geometryTable, const art::Ptr<recob::Hit> hit, const pandora::CaloHit *const pCaloHit,
+        const double xShift);
+
+    /**
+     *  @brief Calculate the T0 of each output pfo, as the mean T0 of its 3D hits, with the pfos shared out between threads
+     *
+     *  @param settings the settings
+     *  @param hitRegistry the registry of ART hits, by Pandora hit ID
+     *  @param stitchedPfos the daughter instance pfos stitched across drift volume boundaries
+     *  @param pfoVector the output pfos
+     *  @param pfoT0s to receive the T0 of each pfo in nanoseconds, or zero if there is no significant T0
+     */
+    static void CalculateT0s(const Settings &settings, const LArHitRegistry &hitRegistry, const StitchedPfos &stitchedPfos, const pandora::PfoVector &pfoVector,
+        std::vector<double> &pfoT0s);
+
+private:
+    /**
+     *  @brief  ClusterEndPoints class
+     */
+    class ClusterEndPoints
+    {
+    public:
+        /**
+         *  @brief  Default constructor
+         */
+        ClusterEndPoints();
+
+        geo::View_t             m_view;                         ///< The view of the cluster hits
+        geo::PlaneID            m_planeID;                      ///< The plane id of the cluster hits
+        double                  m_startWire;                    ///< The start wire
+        double                  m_sigmaStartWire;               ///< The uncertainty on the start wire
+        double                  m_startTime;                    ///< The start time
+        double                  m_sigmaStartTime;               ///< The uncertainty on the start time
+        double                  m_endWire;                      ///< The end wire
+        double                  m_sigmaEndWire;                 ///< The uncertainty on the end wire
+        double                  m_endTime;                      ///< The end time
+        double                  m_sigmaEndTime;                 ///< The uncertainty on the end time
+    };
+
+    /**
+     *  @brief Get the view, plane and start and end points of a cluster, ignoring isolated hits for the start and end points
+     *
+     *  @param hitVector the input vector of hits
+     *  @param isolatedHits the input list of isolated hits
+     *
+     *  @return the cluster end points
+     */
+    static ClusterEndPoints GetClusterEndPoints(const HitVector &hitVector, const HitList &isolatedHits);
+
+    /**
+     *  @brief  StitchingCandidate class, describing a primary track-like daughter instance pfo that may be stitched to another
+     */
+    class StitchingCandidate
+    {
+    public:
+        /**
+         *  @brief  Constructor
+         *
+         *  @param  pPfo the address of the pfo
+         *  @param  volumeId the drift volume id of the daughter instance
+         *  @param  t0PerXShift the T0 per unit x shift in the drift volume, in ns per cm, with sign given by the drift direction
+         *  @param  direction the direction of the principal axis of the pfo 3D hits
+         *  @param  firstPosition the position of the 3D hit at the first end of the principal axis
+         *  @param  secondPosition the position of the 3D hit at the second end of the principal axis
+         */
+        StitchingCandidate(const pandora::ParticleFlowObject *const pPfo, const unsigned int volumeId, const double t0PerXShift,
+            const pandora::CartesianVector &direction, const pandora::CartesianVector &firstPosition, const pandora::CartesianVector &secondPosition);
+
+        const pandora::ParticleFlowObject  *m_pPfo;             ///< The address of the pfo
+        unsigned int                        m_volumeId;         ///< The drift volume id of the daughter instance
+        double                              m_t0PerXShift;      ///< The T0 per unit x shift in the drift volume, in ns per cm
+        pandora::CartesianVector            m_direction;        ///< The direction of the principal axis of the pfo 3D hits
+        pandora::CartesianVector            m_firstPosition;    ///< The position of the 3D hit at the first end of the principal axis
+        pandora::CartesianVector            m_secondPosition;   ///< The position of the 3D hit at the second end of the principal axis
+    };
+
+    /**
+     *  @brief  StitchingLink class, describing a possible link between the ends of two stitching candidates in different drift volumes
+     */
+    class StitchingLink
+    {
+    public:
+        unsigned int                        m_firstIndex;       ///< The index of the first candidate
+        unsigned int                        m_firstEnd;         ///< The linked end (zero for first, one for second) of the first candidate
+        unsigned int                        m_secondIndex;      ///< The index of the second candidate
+        unsigned int                        m_secondEnd;        ///< The linked end (zero for first, one for second) of the second candidate
+        double                              m_displacement;     ///< The displacement between the linked ends, in cm
+        bool                                m_hasT0;            ///< Whether the link measures a T0, joining volumes drifting in opposite directions
+        double                              m_t0;               ///< The T0 measured by the link, in ns
+    };
+
+    /**
+     *  @brief Get the pfos written as a single output particle: the pfo itself or, if it represents a stitched group, each pfo of the group
+     *
+     *  @param stitchedPfos the daughter instance pfos stitched across drift volume boundaries
+     *  @param pPfo the address of the output pfo
+     *  @param outputPfos to receive the pfos
+     */
+    static void GetOutputPfos(const StitchedPfos &stitchedPfos, const pandora::ParticleFlowObject *const pPfo, pandora::PfoVector &outputPfos);
+
+    /**
+     *  @brief Get the 3D hits written for a single output particle, sorted by position
+     *
+     *  @param stitchedPfos the daughter instance pfos stitched across drift volume boundaries
+     *  @param pPfo the address of the output pfo
+     *  @param caloHitVector3D to receive the 3D hits
+     */
+    static void GetOutputCaloHits3D(const StitchedPfos &stitchedPfos, const pandora::ParticleFlowObject *const pPfo, pandora::CaloHitVector &caloHitVector3D);
+
+    /**
+     *  @brief Get the x shift applied at output to the vertex of a pfo, non-zero only for stitched pfos
+     *
+     *  @param stitchedPfos the daughter instance pfos stitched across drift volume boundaries
+     *  @param pPfo the address of the pfo
+     */
+    static double GetXShift(const StitchedPfos &stitchedPfos, const pandora::ParticleFlowObject *const pPfo);
+
+    /**
+     *  @brief Get the x shift applied at output to a 3D hit, non-zero only for the hits of stitched pfos
+     *
+     *  @param stitchedPfos the daughter instance pfos stitched across drift volume boundaries
+     *  @param pCaloHit3D the address of the 3D hit
+     */
+    static double GetXShift(const StitchedPfos &stitchedPfos, const pandora::CaloHit *const pCaloHit3D);
+
+    /**
+     *  @brief Get the precomputed geometry table from the settings or, if there is none, build a local table
+     *
+     *  @param settings the settings
+     *  @param localGeometryTable the local table, built only if the settings hold no precomputed table
+     *
+     *  @return the geometry table
+     */
+    static const LArPandoraGeometryTable &GetGeometryTable(const Settings &settings, LArPandoraGeometryTable &localGeometryTable);
+
+    /**
+     *  @brief Record the output pfparticle that owns an ART hit
+     *
+     *  @param hit the ART hit
+     *  @param pfParticleIndex the index of the owning pfparticle in the output vector
+     *  @param hitOwnership the hit ownership to receive the owner
+     */
+    static void SetHitOwner(const art::Ptr<recob::Hit> &hit, const unsigned int pfParticleIndex, LArHitOwnership &hitOwnership);
+
+    /**
+     *  @brief Record the final-state and neutrino ancestors of each output pfparticle
+     *
+     *  @param particles the output pfparticles
+     *  @param hitOwnership the hit ownership to receive the ancestry
+     */
+    static void SetPFParticleAncestry(const std::vector<recob::PFParticle> &particles, LArHitOwnership &hitOwnership);
+
+    /**
+     *  @brief Build the hierarchy summary of each output pfparticle
+     *
+     *  @param pfParticleProductId the product id of the output pfparticle collection
+     *  @param particles the output pfparticles
+     *  @param nHitsU the number of hits in the U view of each pfparticle
+     *  @param nHitsV the number of hits in the V view of each pfparticle
+     *  @param nHitsW the number of hits in the W view of each pfparticle
+     *  @param nSpacePoints the number of 3D hits of each pfparticle
+     *  @param summaries to receive the summary of each pfparticle
+     */
+    static void BuildPFParticleSummaries(const art::ProductID &pfParticleProductId, const std::vector<recob::PFParticle> &particles,
+        const std::vector<unsigned int> &nHitsU, const std::vector<unsigned int> &nHitsV, const std::vector<unsigned int> &nHitsW,
+        const std::vector<unsigned int> &nSpacePoints, LArPFParticleSummaryVector &summaries);
+
+    /**
+     *  @brief Get the top-level ancestor, final-state ancestor and generation of each output pfparticle
+     *
+     *  @param particles the output pfparticles
+     *  @param rootIndices to receive the index of the top-level ancestor of each pfparticle
+     *  @param finalStateIndices to receive the index of the final-state ancestor of each pfparticle
+     *  @param generations to receive the generation of each pfparticle (first generation if primary)
+     */
+    static void GetPFParticleAncestry(const std::vector<recob::PFParticle> &particles, std::vector<unsigned int> &rootIndices,
+        std::vector<unsigned int> &finalStateIndices, std::vector<int> &generations);
+
+    /**
+     *  @brief Whether an output pfparticle is a neutrino
+     *
+     *  @param particle the output pfparticle
+     */
+    static bool IsNeutrino(const recob::PFParticle &particle);
 };
 
 } // namespace lar_pandora
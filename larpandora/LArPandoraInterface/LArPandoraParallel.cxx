@@ -0,0 +1,212 @@
+/**
+ *  @file   larpandora/LArPandoraInterface/LArPandoraParallel.cxx
+ *
+ *  @brief  Helper functions for distributing independent work items over a number of threads
+ */
+
+#include "larpandora/LArPandoraInterface/LArPandoraParallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+/**
+ *  @brief  ThreadPool class, holding worker threads that persist between calls, so that each parallel stage does not start its own threads
+ */
+class ThreadPool
+{
+public:
+    /**
+     *  @brief  Default constructor
+     */
+    ThreadPool();
+
+    /**
+     *  @brief  Destructor, stopping and joining the worker threads
+     */
+    ~ThreadPool();
+
+    /**
+     *  @brief  Call a function on a number of threads, including the calling thread, and wait for every call to return
+     *
+     *  @param  nThreads the number of threads, the pool growing if it holds fewer than nThreads - 1 worker threads
+     *  @param  function the function, which must not throw
+     */
+    void Run(const unsigned int nThreads, const std::function<void()> &function);
+
+private:
+    /**
+     *  @brief  The loop run by each worker thread, taking part in each call to Run until the pool is stopped
+     */
+    void Work();
+
+    std::mutex                      m_runMutex;         ///< The mutex serialising calls to Run
+    std::mutex                      m_mutex;            ///< The mutex protecting the state below
+    std::condition_variable         m_workAvailable;    ///< Signalled when a function is posted, or the pool is stopped
+    std::condition_variable         m_workDone;         ///< Signalled when the last worker thread returns from the posted function
+    std::vector<std::thread>        m_threads;          ///< The worker threads
+    const std::function<void()>    *m_pFunction;        ///< The posted function
+    unsigned int                    m_nPendingStarts;   ///< The number of worker threads still to start the posted function
+    unsigned int                    m_nActive;          ///< The number of worker threads running the posted function
+    bool                            m_shouldStop;       ///< Whether the worker threads should stop
+};
+
+// ATTN Set on every thread running a posted function, so that any nested ForEach call runs serially, rather than waiting on the pool
+thread_local bool isInThreadPool(false);
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+ThreadPool::ThreadPool() :
+    m_pFunction(nullptr),
+    m_nPendingStarts(0),
+    m_nActive(0),
+    m_shouldStop(false)
+{
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_shouldStop = true;
+    }
+
+    m_workAvailable.notify_all();
+
+    for (std::thread &thread : m_threads)
+        thread.join();
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void ThreadPool::Run(const unsigned int nThreads, const std::function<void()> &function)
+{
+    std::lock_guard<std::mutex> runLock(m_runMutex);
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        while (m_threads.size() + 1 < nThreads)
+            m_threads.emplace_back(&ThreadPool::Work, this);
+
+        m_pFunction = &function;
+        m_nPendingStarts = nThreads - 1;
+    }
+
+    m_workAvailable.notify_all();
+
+    // The calling thread takes a share of the work, rather than waiting idle
+    isInThreadPool = true;
+    function();
+    isInThreadPool = false;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_workDone.wait(lock, [this]() { return ((0 == m_nPendingStarts) && (0 == m_nActive)); });
+    m_pFunction = nullptr;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void ThreadPool::Work()
+{
+    isInThreadPool = true;
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (true)
+    {
+        m_workAvailable.wait(lock, [this]() { return (m_shouldStop || (m_nPendingStarts > 0)); });
+
+        if (m_shouldStop)
+            return;
+
+        --m_nPendingStarts;
+        ++m_nActive;
+        const std::function<void()> *const pFunction(m_pFunction);
+
+        lock.unlock();
+        (*pFunction)();
+        lock.lock();
+
+        if ((0 == --m_nActive) && (0 == m_nPendingStarts))
+            m_workDone.notify_all();
+    }
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+namespace lar_pandora
+{
+
+unsigned int LArPandoraParallel::GetNThreads(const unsigned int nRequestedThreads)
+{
+    if (nRequestedThreads > 0)
+        return nRequestedThreads;
+
+    // ATTN hardware_concurrency may return zero if the number of cores cannot be determined
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void LArPandoraParallel::ForEach(const unsigned int nItems, const unsigned int nThreads, const std::function<void(const unsigned int)> &function)
+{
+    const unsigned int nWorkers(std::min(nItems, std::max(1u, nThreads)));
+
+    if ((nWorkers <= 1) || isInThreadPool)
+    {
+        for (unsigned int iItem = 0; iItem < nItems; ++iItem)
+            function(iItem);
+
+        return;
+    }
+
+    std::atomic<unsigned int> nextItem(0);
+    std::atomic<bool> hasFailed(false);
+    std::exception_ptr pFirstException(nullptr);
+    std::mutex exceptionMutex;
+
+    const std::function<void()> worker([&]()
+    {
+        while (!hasFailed)
+        {
+            const unsigned int iItem(nextItem++);
+
+            if (iItem >= nItems)
+                break;
+
+            try
+            {
+                function(iItem);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(exceptionMutex);
+
+                if (!pFirstException)
+                    pFirstException = std::current_exception();
+
+                hasFailed = true;
+            }
+        }
+    });
+
+    // ATTN The pool is created on first use and grows to the largest number of threads requested; its threads are joined at exit
+    static ThreadPool threadPool;
+    threadPool.Run(nWorkers, worker);
+
+    if (pFirstException)
+        std::rethrow_exception(pFirstException);
+}
+
+} // namespace lar_pandora
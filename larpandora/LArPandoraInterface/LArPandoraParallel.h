@@ -0,0 +1,45 @@
+/**
+ *  @file   larpandora/LArPandoraInterface/LArPandoraParallel.h
+ *
+ *  @brief  Helper functions for distributing independent work items over a number of threads
+ */
+
+#ifndef LAR_PANDORA_PARALLEL_H
+#define LAR_PANDORA_PARALLEL_H 1
+
+#include <functional>
+
+namespace lar_pandora
+{
+
+/**
+ *  @brief  LArPandoraParallel class
+ */
+class LArPandoraParallel
+{
+public:
+    /**
+     *  @brief  Get the number of threads to use, given the number requested in the configuration
+     *
+     *  @param  nRequestedThreads the number of requested threads (zero requests one thread per available core)
+     *
+     *  @return the number of threads to use, always at least one
+     */
+    static unsigned int GetNThreads(const unsigned int nRequestedThreads);
+
+    /**
+     *  @brief  Call a function for every item index in the range [0, nItems), with the items shared out between a number of threads.
+     *          Items are claimed dynamically, so the function must not rely on the order in which items are processed. If any call
+     *          throws, no further items are started and the first exception is rethrown on the calling thread. The threads are taken
+     *          from a pool shared by all calls, and a call made from within another call processes its items serially.
+     *
+     *  @param  nItems the number of items
+     *  @param  nThreads the number of threads (if one, all items are processed in order on the calling thread)
+     *  @param  function the function to call for each item index
+     */
+    static void ForEach(const unsigned int nItems, const unsigned int nThreads, const std::function<void(const unsigned int)> &function);
+};
+
+} // namespace lar_pandora
+
+#endif // #ifndef LAR_PANDORA_PARALLEL_H
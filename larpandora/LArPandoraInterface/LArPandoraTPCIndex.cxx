@@ -0,0 +1,199 @@
+/**
+ *  @file   larpandora/LArPandoraInterface/LArPandoraTPCIndex.cxx
+ *
+ *  @brief  Spatial index of tpc bounding boxes, for fast classification of positions and mc trajectories as inside or outside the tpcs
+ */
+
+#include "art/Framework/Services/Registry/ServiceHandle.h"
+#include "cetlib/exception.h"
+
+#include "larcore/Geometry/Geometry.h"
+#include "larcorealg/Geometry/TPCGeo.h"
+
+#include "nusimdata/SimulationBase/MCParticle.h"
+
+#include "larpandora/LArPandoraInterface/LArPandoraTPCIndex.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace lar_pandora
+{
+
+LArPandoraTPCIndex::LArPandoraTPCIndex()
+{
+    for (unsigned int axis = 0; axis < 3; ++axis)
+    {
+        m_worldBox.m_min[axis] = 0.;
+        m_worldBox.m_max[axis] = 0.;
+        m_nCells[axis] = 0;
+        m_cellSize[axis] = 0.;
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void LArPandoraTPCIndex::Build()
+{
+    m_boxes.clear();
+    m_cellBoxes.clear();
+
+    art::ServiceHandle<geo::Geometry> theGeometry;
+
+    // ATTN Matches the default relative tolerance ("position wiggle") applied by Geometry::FindTPCAtPosition
+    const double wiggle(1. + 1.e-4);
+    double minExtent[3] = {std::numeric_limits<double>::max(), std::numeric_limits<double>::max(), std::numeric_limits<double>::max()};
+
+    for (unsigned int icstat = 0; icstat < theGeometry->Ncryostats(); ++icstat)
+    {
+        for (unsigned int itpc = 0; itpc < theGeometry->NTPC(icstat); ++itpc)
+        {
+            const geo::TPCGeo &theTpc(theGeometry->TPC(itpc, icstat));
+            const double halfExtent[3] = {theTpc.HalfWidth() * wiggle, theTpc.HalfHeight() * wiggle, 0.5 * theTpc.Length() * wiggle};
+
+            // Transform all eight corners, so that the world box is exact for any tpc orientation aligned with the world axes
+            Box box;
+
+            for (unsigned int axis = 0; axis < 3; ++axis)
+            {
+                box.m_min[axis] = std::numeric_limits<double>::max();
+                box.m_max[axis] = std::numeric_limits<double>::lowest();
+            }
+
+            for (unsigned int iCorner = 0; iCorner < 8; ++iCorner)
+            {
+                double localCoord[3] = {0., 0., 0.};
+                double worldCoord[3] = {0., 0., 0.};
+
+                for (unsigned int axis = 0; axis < 3; ++axis)
+                    localCoord[axis] = ((iCorner >> axis) & 1) ? halfExtent[axis] : -halfExtent[axis];
+
+                theTpc.LocalToWorld(localCoord, worldCoord);
+
+                for (unsigned int axis = 0; axis < 3; ++axis)
+                {
+                    box.m_min[axis] = std::min(box.m_min[axis], worldCoord[axis]);
+                    box.m_max[axis] = std::max(box.m_max[axis], worldCoord[axis]);
+                }
+            }
+
+            for (unsigned int axis = 0; axis < 3; ++axis)
+            {
+                minExtent[axis] = std::min(minExtent[axis], box.m_max[axis] - box.m_min[axis]);
+                m_worldBox.m_min[axis] = m_boxes.empty() ? box.m_min[axis] : std::min(m_worldBox.m_min[axis], box.m_min[axis]);
+                m_worldBox.m_max[axis] = m_boxes.empty() ? box.m_max[axis] : std::max(m_worldBox.m_max[axis], box.m_max[axis]);
+            }
+
+            m_boxes.push_back(box);
+        }
+    }
+
+    if (m_boxes.empty())
+        throw cet::exception("LArPandora") << " LArPandoraTPCIndex::Build --- the geometry contains no tpcs ";
+
+    // Size the grid cells to the smallest tpc along each axis, so each cell overlaps only a handful of tpcs
+    const unsigned int maxCellsPerAxis(256);
+
+    for (unsigned int axis = 0; axis < 3; ++axis)
+    {
+        const double worldExtent(m_worldBox.m_max[axis] - m_worldBox.m_min[axis]);
+        const double nCells((minExtent[axis] > std::numeric_limits<double>::epsilon()) ? std::ceil(worldExtent / minExtent[axis]) : 1.);
+        m_nCells[axis] = std::max(1u, static_cast<unsigned int>(std::min(static_cast<double>(maxCellsPerAxis), nCells)));
+    }
+
+    // ATTN Unevenly sized tpcs can still demand a very fine grid, so the total cell count is capped relative to the number of tpcs
+    const unsigned int maxCells(std::max(64u, 8u * static_cast<unsigned int>(m_boxes.size())));
+
+    while (m_nCells[0] * m_nCells[1] * m_nCells[2] > maxCells)
+    {
+        const unsigned int largestAxis(static_cast<unsigned int>(std::max_element(m_nCells, m_nCells + 3) - m_nCells));
+        m_nCells[largestAxis] = (m_nCells[largestAxis] + 1) / 2;
+    }
+
+    for (unsigned int axis = 0; axis < 3; ++axis)
+    {
+        const double worldExtent(m_worldBox.m_max[axis] - m_worldBox.m_min[axis]);
+        m_cellSize[axis] = (worldExtent > std::numeric_limits<double>::epsilon()) ? (worldExtent / m_nCells[axis]) : 1.;
+    }
+
+    m_cellBoxes.resize(m_nCells[0] * m_nCells[1] * m_nCells[2]);
+
+    for (unsigned int iBox = 0, nBoxes = m_boxes.size(); iBox < nBoxes; ++iBox)
+    {
+        const Box &box(m_boxes[iBox]);
+        unsigned int minCell[3], maxCell[3];
+
+        for (unsigned int axis = 0; axis < 3; ++axis)
+        {
+            minCell[axis] = this->GetCellIndex(axis, box.m_min[axis]);
+            maxCell[axis] = this->GetCellIndex(axis, box.m_max[axis]);
+        }
+
+        for (unsigned int ix = minCell[0]; ix <= maxCell[0]; ++ix)
+        {
+            for (unsigned int iy = minCell[1]; iy <= maxCell[1]; ++iy)
+            {
+                for (unsigned int iz = minCell[2]; iz <= maxCell[2]; ++iz)
+                    m_cellBoxes[(ix * m_nCells[1] + iy) * m_nCells[2] + iz].push_back(iBox);
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+bool LArPandoraTPCIndex::IsInTPC(const double x, const double y, const double z) const
+{
+    if (!this->IsBuilt())
+        throw cet::exception("LArPandora") << " LArPandoraTPCIndex::IsInTPC --- the tpc index has not been built ";
+
+    if (!m_worldBox.Contains(x, y, z))
+        return false;
+
+    const unsigned int cellIndex((this->GetCellIndex(0, x) * m_nCells[1] + this->GetCellIndex(1, y)) * m_nCells[2] + this->GetCellIndex(2, z));
+
+    for (const unsigned int iBox : m_cellBoxes[cellIndex])
+    {
+        if (m_boxes[iBox].Contains(x, y, z))
+            return true;
+    }
+
+    return false;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+bool LArPandoraTPCIndex::GetStartAndEndPoints(const simb::MCParticle &particle, int &startT, int &endT) const
+{
+    startT = -1; endT = -1;
+
+    const int numTrajectoryPoints(static_cast<int>(particle.NumberTrajectoryPoints()));
+
+    for (int nt = 0; nt < numTrajectoryPoints; ++nt)
+    {
+        if (!this->IsInTPC(particle.Vx(nt), particle.Vy(nt), particle.Vz(nt)))
+            continue;
+
+        endT = nt;
+
+        if (startT < 0)
+            startT = nt;
+    }
+
+    return (startT >= 0);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+unsigned int LArPandoraTPCIndex::GetCellIndex(const unsigned int axis, const double coordinate) const
+{
+    const double cellPosition((coordinate - m_worldBox.m_min[axis]) / m_cellSize[axis]);
+
+    if (cellPosition <= 0.)
+        return 0;
+
+    return std::min(m_nCells[axis] - 1, static_cast<unsigned int>(cellPosition));
+}
+
+} // namespace lar_pandora
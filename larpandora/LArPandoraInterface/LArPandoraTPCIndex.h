@@ -0,0 +1,115 @@
+/**
+ *  @file   larpandora/LArPandoraInterface/LArPandoraTPCIndex.h
+ *
+ *  @brief  Spatial index of tpc bounding boxes, for fast classification of positions and mc trajectories as inside or outside the tpcs
+ */
+
+#ifndef LAR_PANDORA_TPC_INDEX_H
+#define LAR_PANDORA_TPC_INDEX_H 1
+
+#include <vector>
+
+namespace simb {class MCParticle;}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+namespace lar_pandora
+{
+
+/**
+ *  @brief  LArPandoraTPCIndex class. The world bounding box of each tpc is stored in a uniform grid of cells, so a position is tested
+ *          against only the few tpcs overlapping its cell.
+ */
+class LArPandoraTPCIndex
+{
+public:
+    /**
+     *  @brief  Default constructor
+     */
+    LArPandoraTPCIndex();
+
+    /**
+     *  @brief  Build (or rebuild) the index from the current geometry
+     */
+    void Build();
+
+    /**
+     *  @brief  Whether the index has been built
+     */
+    bool IsBuilt() const;
+
+    /**
+     *  @brief  Whether a position lies inside any tpc, consistent with Geometry::FindTPCAtPosition for tpcs aligned with the world axes
+     *
+     *  @param  x the x coordinate
+     *  @param  y the y coordinate
+     *  @param  z the z coordinate
+     */
+    bool IsInTPC(const double x, const double y, const double z) const;
+
+    /**
+     *  @brief  Find the first and last trajectory points of an mc particle that lie inside any tpc, in a single pass over the trajectory
+     *
+     *  @param  particle the mc particle
+     *  @param  startT to receive the first trajectory point inside a tpc (-1 if there is none)
+     *  @param  endT to receive the last trajectory point inside a tpc (-1 if there is none)
+     *
+     *  @return whether any trajectory point lies inside a tpc
+     */
+    bool GetStartAndEndPoints(const simb::MCParticle &particle, int &startT, int &endT) const;
+
+private:
+    /**
+     *  @brief  Box class, an axis-aligned bounding box
+     */
+    class Box
+    {
+    public:
+        /**
+         *  @brief  Whether a position lies inside the box
+         *
+         *  @param  x the x coordinate
+         *  @param  y the y coordinate
+         *  @param  z the z coordinate
+         */
+        bool Contains(const double x, const double y, const double z) const;
+
+        double  m_min[3];   ///< The minimum x, y and z coordinates
+        double  m_max[3];   ///< The maximum x, y and z coordinates
+    };
+
+    typedef std::vector<Box> BoxList;
+    typedef std::vector<unsigned int> BoxIndexList;
+
+    /**
+     *  @brief  Get the grid cell index along an axis, clamped to the grid
+     *
+     *  @param  axis the axis
+     *  @param  coordinate the coordinate along the axis
+     */
+    unsigned int GetCellIndex(const unsigned int axis, const double coordinate) const;
+
+    BoxList                     m_boxes;            ///< The bounding box of each tpc
+    Box                         m_worldBox;         ///< The bounding box of all tpcs
+    unsigned int                m_nCells[3];        ///< The number of grid cells along x, y and z
+    double                      m_cellSize[3];      ///< The grid cell size along x, y and z
+    std::vector<BoxIndexList>   m_cellBoxes;        ///< The indices of the boxes overlapping each grid cell
+};
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline bool LArPandoraTPCIndex::IsBuilt() const
+{
+    return !m_boxes.empty();
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline bool LArPandoraTPCIndex::Box::Contains(const double x, const double y, const double z) const
+{
+    return ((x >= m_min[0]) && (x <= m_max[0]) && (y >= m_min[1]) && (y <= m_max[1]) && (z >= m_min[2]) && (z <= m_max[2]));
+}
+
+} // namespace lar_pandora
+
+#endif // #ifndef LAR_PANDORA_TPC_INDEX_H
@@ -7,6 +7,7 @@
 #include "art/Framework/Core/ModuleMacros.h"
 
 #include "larpandora/LArPandoraInterface/LArPandora.h"
+#include "larpandora/LArPandoraInterface/LArPandoraAlgorithmTiming.h"
 
 #include <string>
 
@@ -31,6 +32,8 @@ public:
      */
     ~StandardPandora();
 
+    void endJob();
+
 private:
     void CreatePandoraInstances();
     void ConfigurePandoraInstances();
@@ -38,12 +41,39 @@ private:
     void ResetPandoraInstances();
     void DeletePandoraInstances();
 
+    /**
+     *  @brief  Create a new pandora instance, with all lar content algorithms and plugins registered
+     *
+     *  @return the address of the new pandora instance
+     */
+    const pandora::Pandora *CreateNewPandora();
+
     /**
      *  @brief  Pass external steering parameters, read from fhicl parameter set, to LArMaster Pandora algorithm
      * 
      *  @param  pPandora the address of the relevant pandora instance
+     *  @param  shouldRunStitching whether the instance should run stitching
+     */
+    void ProvideExternalSteeringParameters(const pandora::Pandora *const pPandora, const bool shouldRunStitching) const;
+
+    /**
+     *  @brief  Find the full path of a configuration file in the FW search path
+     *
+     *  @param  configFile the configuration file name
+     *
+     *  @return the full configuration file path
+     */
+    std::string FindConfigFile(const std::string &configFile) const;
+
+    /**
+     *  @brief  Process the current event in a pandora instance, recording the time taken
+     *
+     *  @param  pPandora the address of the pandora instance
+     *  @param  instanceName the name of the instance, for the timing record
      */
-    void ProvideExternalSteeringParameters(const pandora::Pandora *const pPandora) const;
+    void ProcessEvent(const pandora::Pandora *const pPandora, const std::string &instanceName);
+
+    LArPandoraAlgorithmTiming   m_algorithmTiming;          ///< The wall time for each timed pandora algorithm and instance
 };
 
 DEFINE_ART_MODULE(StandardPandora)
@@ -63,13 +93,18 @@ DEFINE_ART_MODULE(StandardPandora)
 #include "larpandoracontent/LArPlugins/LArPseudoLayerPlugin.h"
 #include "larpandoracontent/LArPlugins/LArRotationalTransformationPlugin.h"
 
+#include "larpandora/LArPandoraInterface/LArPandoraParallel.h"
+
+#include <chrono>
 #include <iostream>
+#include <set>
 
 namespace lar_pandora
 {
 
 StandardPandora::StandardPandora(fhicl::ParameterSet const &pset) :
-    LArPandora(pset)
+    LArPandora(pset),
+    m_algorithmTiming(pset.get<bool>("EnableAlgorithmTiming", false), pset.get<double>("AlgorithmTimingMax", 60.))
 {
 }
 
@@ -82,38 +117,87 @@ StandardPandora::~StandardPandora()
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
-void StandardPandora::CreatePandoraInstances()
+void StandardPandora::endJob()
 {
-    m_pPrimaryPandora = new pandora::Pandora();
-    PANDORA_THROW_RESULT_IF(pandora::STATUS_CODE_SUCCESS, !=, LArContent::RegisterAlgorithms(*m_pPrimaryPandora));
-    PANDORA_THROW_RESULT_IF(pandora::STATUS_CODE_SUCCESS, !=, LArContent::RegisterBasicPlugins(*m_pPrimaryPandora));
+    LArPandora::endJob();
+    m_algorithmTiming.Report();
+}
 
-    // ATTN Potentially ill defined, unless coordinate system set up to ensure that all drift volumes have same wire angles and pitches
-    PANDORA_THROW_RESULT_IF(pandora::STATUS_CODE_SUCCESS, !=, PandoraApi::SetPseudoLayerPlugin(*m_pPrimaryPandora, new lar_content::LArPseudoLayerPlugin));
-    PANDORA_THROW_RESULT_IF(pandora::STATUS_CODE_SUCCESS, !=, PandoraApi::SetLArTransformationPlugin(*m_pPrimaryPandora, new lar_content::LArRotationalTransformationPlugin));
+//------------------------------------------------------------------------------------------------------------------------------------------
 
+void StandardPandora::CreatePandoraInstances()
+{
+    m_pPrimaryPandora = this->CreateNewPandora();
     MultiPandoraApi::AddPrimaryPandoraInstance(m_pPrimaryPandora);
+
+    if (!m_shouldRunDriftVolumesInParallel)
+        return;
+
+    std::set<unsigned int> volumeIds;
+
+    for (const LArDriftVolumeMap::value_type &driftVolumeEntry : m_driftVolumeMap)
+        volumeIds.insert(driftVolumeEntry.second.GetVolumeID());
+
+    if (volumeIds.empty())
+        throw cet::exception("StandardPandora") << " CreatePandoraInstances - no drift volumes found, geometry must be loaded before creating daughter instances";
+
+    for (const unsigned int volumeId : volumeIds)
+    {
+        const pandora::Pandora *const pDaughterPandora(this->CreateNewPandora());
+        MultiPandoraApi::AddDaughterPandoraInstance(m_pPrimaryPandora, pDaughterPandora);
+        m_daughterPandoraInstances[volumeId] = pDaughterPandora;
+    }
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
 void StandardPandora::ConfigurePandoraInstances()
 {
-    cet::search_path sp("FW_SEARCH_PATH");
-    std::string fullConfigFileName;
-
-    if (!sp.find_file(m_configFile, fullConfigFileName))
-        throw cet::exception("StandardPandora") << " ConfigurePrimaryPandoraInstance - Failed to find xml configuration file " << m_configFile << " in FW search path";
-
-    this->ProvideExternalSteeringParameters(m_pPrimaryPandora);
-    PANDORA_THROW_RESULT_IF(pandora::STATUS_CODE_SUCCESS, !=, PandoraApi::ReadSettings(*m_pPrimaryPandora, fullConfigFileName));
+    // ATTN When drift volumes run in parallel, the primary instance only holds the geometry and is never run
+    if (m_daughterPandoraInstances.empty())
+    {
+        this->ProvideExternalSteeringParameters(m_pPrimaryPandora, m_shouldRunStitching);
+        PANDORA_THROW_RESULT_IF(pandora::STATUS_CODE_SUCCESS, !=, PandoraApi::ReadSettings(*m_pPrimaryPandora, this->FindConfigFile(m_configFile)));
+        return;
+    }
+
+    const std::string fullDriftVolumeConfigFileName(this->FindConfigFile(m_driftVolumeConfigFile));
+
+    for (const VolumeIdToPandoraMap::value_type &daughterEntry : m_daughterPandoraInstances)
+    {
+        this->ProvideExternalSteeringParameters(daughterEntry.second, false);
+        PANDORA_THROW_RESULT_IF(pandora::STATUS_CODE_SUCCESS, !=, PandoraApi::ReadSettings(*daughterEntry.second, fullDriftVolumeConfigFileName));
+    }
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
 void StandardPandora::RunPandoraInstances()
 {
-    PANDORA_THROW_RESULT_IF(pandora::STATUS_CODE_SUCCESS, !=, PandoraApi::ProcessEvent(*m_pPrimaryPandora));
+    m_algorithmTiming.BeginEvent();
+
+    if (m_daughterPandoraInstances.empty())
+    {
+        this->ProcessEvent(m_pPrimaryPandora, "Primary");
+        m_algorithmTiming.EndEvent();
+        return;
+    }
+
+    std::vector<VolumeIdToPandoraMap::value_type> daughterEntries(m_daughterPandoraInstances.begin(), m_daughterPandoraInstances.end());
+
+    // ATTN Each daughter instance owns its own event, but the pandora sdk and lar content do not guarantee that ProcessEvent is reentrant
+    // across instances. The state shared between instances is the MultiPandoraApi instance map, written only when instances are created
+    // or deleted (on the module thread, never during ProcessEvent), and otherwise only read; visual monitoring, which uses ROOT, must be disabled.
+    // The instances are processed in turn unless concurrent processing is explicitly requested.
+    const unsigned int nThreads(m_shouldProcessDriftVolumesConcurrently ? LArPandoraParallel::GetNThreads(m_nThreads) : 1);
+
+    LArPandoraParallel::ForEach(daughterEntries.size(), nThreads, [this, &daughterEntries](const unsigned int index)
+    {
+        this->ProcessEvent(daughterEntries.at(index).second, "Volume" + std::to_string(daughterEntries.at(index).first));
+    });
+
+    // ATTN The per-event time histograms are filled on the module thread, once all daughter instances have finished
+    m_algorithmTiming.EndEvent();
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
@@ -121,22 +205,69 @@ void StandardPandora::RunPandoraInstances()
 void StandardPandora::ResetPandoraInstances()
 {
     PANDORA_THROW_RESULT_IF(pandora::STATUS_CODE_SUCCESS, !=, PandoraApi::Reset(*m_pPrimaryPandora));
+
+    for (const VolumeIdToPandoraMap::value_type &daughterEntry : m_daughterPandoraInstances)
+        PANDORA_THROW_RESULT_IF(pandora::STATUS_CODE_SUCCESS, !=, PandoraApi::Reset(*daughterEntry.second));
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
 void StandardPandora::DeletePandoraInstances()
 {
-    MultiPandoraApi::DeletePandoraInstances(m_pPrimaryPandora);
+    if (m_pPrimaryPandora)
+        MultiPandoraApi::DeletePandoraInstances(m_pPrimaryPandora);
+
+    m_daughterPandoraInstances.clear();
+    m_pPrimaryPandora = nullptr;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+const pandora::Pandora *StandardPandora::CreateNewPandora()
+{
+    const pandora::Pandora *const pPandora(new pandora::Pandora());
+    PANDORA_THROW_RESULT_IF(pandora::STATUS_CODE_SUCCESS, !=, LArContent::RegisterAlgorithms(*pPandora));
+    PANDORA_THROW_RESULT_IF(pandora::STATUS_CODE_SUCCESS, !=, LArContent::RegisterBasicPlugins(*pPandora));
+
+    // ATTN Always registered, so that settings files wrapping algorithms in LArPandoraTiming can be read whether or not timing is enabled
+    m_algorithmTiming.Register(*pPandora);
+
+    // ATTN Potentially ill defined, unless coordinate system set up to ensure that all drift volumes have same wire angles and pitches
+    PANDORA_THROW_RESULT_IF(pandora::STATUS_CODE_SUCCESS, !=, PandoraApi::SetPseudoLayerPlugin(*pPandora, new lar_content::LArPseudoLayerPlugin));
+    PANDORA_THROW_RESULT_IF(pandora::STATUS_CODE_SUCCESS, !=, PandoraApi::SetLArTransformationPlugin(*pPandora, new lar_content::LArRotationalTransformationPlugin));
+
+    return pPandora;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+std::string StandardPandora::FindConfigFile(const std::string &configFile) const
+{
+    cet::search_path sp("FW_SEARCH_PATH");
+    std::string fullConfigFileName;
+
+    if (!sp.find_file(configFile, fullConfigFileName))
+        throw cet::exception("StandardPandora") << " FindConfigFile - Failed to find xml configuration file " << configFile << " in FW search path";
+
+    return fullConfigFileName;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void StandardPandora::ProcessEvent(const pandora::Pandora *const pPandora, const std::string &instanceName)
+{
+    const std::chrono::steady_clock::time_point startTime(std::chrono::steady_clock::now());
+    PANDORA_THROW_RESULT_IF(pandora::STATUS_CODE_SUCCESS, !=, PandoraApi::ProcessEvent(*pPandora));
+    m_algorithmTiming.AddTime("ProcessEvent" + instanceName, std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count());
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
-void StandardPandora::ProvideExternalSteeringParameters(const pandora::Pandora *const pPandora) const
+void StandardPandora::ProvideExternalSteeringParameters(const pandora::Pandora *const pPandora, const bool shouldRunStitching) const
 {
     auto *const pEventSteeringParameters = new lar_content::MasterAlgorithm::ExternalSteeringParameters;
     pEventSteeringParameters->m_shouldRunAllHitsCosmicReco = m_shouldRunAllHitsCosmicReco;
-    pEventSteeringParameters->m_shouldRunStitching = m_shouldRunStitching;
+    pEventSteeringParameters->m_shouldRunStitching = shouldRunStitching;
     pEventSteeringParameters->m_shouldRunCosmicHitRemoval = m_shouldRunCosmicHitRemoval;
     pEventSteeringParameters->m_shouldRunSlicing = m_shouldRunSlicing;
     pEventSteeringParameters->m_shouldRunNeutrinoRecoOption = m_shouldRunNeutrinoRecoOption;
@@ -0,0 +1,236 @@
+/**
+ *  @file   larpandora/LArPandoraObjects/LArCompactSpacePoints.h
+ *
+ *  @brief  Compact, column-wise storage of the spacepoints of the output pfparticles, an alternative to recob::SpacePoint products
+ */
+
+#ifndef LAR_COMPACT_SPACE_POINTS_H
+#define LAR_COMPACT_SPACE_POINTS_H 1
+
+#include "canvas/Persistency/Provenance/ProductID.h"
+
+#include "cetlib/exception.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace lar_pandora
+{
+
+/**
+ *  @brief  LArCompactSpacePoints class
+ *
+ *  Each spacepoint has a float position, the index of its pfparticle in the pfparticle collection written by the same producer and the
+ *  keys of its hits in a single hit collection. The spacepoints of each pfparticle occupy a contiguous range, in pfparticle order.
+ */
+class LArCompactSpacePoints
+{
+public:
+    /**
+     *  @brief  Default constructor
+     */
+    LArCompactSpacePoints();
+
+    /**
+     *  @brief  Reserve space for a number of spacepoints
+     *
+     *  @param  nSpacePoints the number of spacepoints
+     *  @param  nHits the total number of hit keys
+     */
+    void Reserve(const unsigned int nSpacePoints, const unsigned int nHits);
+
+    /**
+     *  @brief  Set the product id of the hit collection to which the hit keys refer
+     *
+     *  @param  hitProductId the product id of the hit collection
+     */
+    void SetHitProductId(const art::ProductID &hitProductId);
+
+    /**
+     *  @brief  Add a spacepoint, which must not belong to an earlier pfparticle than the last spacepoint added
+     *
+     *  @param  x the x position
+     *  @param  y the y position
+     *  @param  z the z position
+     *  @param  pfParticleIndex the index of the pfparticle of the spacepoint
+     *  @param  hitKeys the keys of the hits of the spacepoint
+     */
+    void AddSpacePoint(const float x, const float y, const float z, const unsigned int pfParticleIndex, const std::vector<unsigned int> &hitKeys);
+
+    /**
+     *  @brief  Get the number of spacepoints
+     */
+    unsigned int GetNSpacePoints() const;
+
+    /**
+     *  @brief  Get the product id of the hit collection to which the hit keys refer
+     */
+    const art::ProductID &GetHitProductId() const;
+
+    /**
+     *  @brief  Get the x positions of all spacepoints
+     */
+    const std::vector<float> &GetX() const;
+
+    /**
+     *  @brief  Get the y positions of all spacepoints
+     */
+    const std::vector<float> &GetY() const;
+
+    /**
+     *  @brief  Get the z positions of all spacepoints
+     */
+    const std::vector<float> &GetZ() const;
+
+    /**
+     *  @brief  Get the pfparticle indices of all spacepoints
+     */
+    const std::vector<unsigned int> &GetPFParticleIndices() const;
+
+    /**
+     *  @brief  Get the range of spacepoints belonging to a pfparticle
+     *
+     *  @param  pfParticleIndex the index of the pfparticle
+     *  @param  firstSpacePoint to receive the index of the first spacepoint of the pfparticle
+     *  @param  endSpacePoint to receive the index one past the last spacepoint of the pfparticle
+     */
+    void GetPFParticleSpacePoints(const unsigned int pfParticleIndex, unsigned int &firstSpacePoint, unsigned int &endSpacePoint) const;
+
+    /**
+     *  @brief  Get the number of hits of a spacepoint
+     *
+     *  @param  spacePointIndex the index of the spacepoint
+     */
+    unsigned int GetNHits(const unsigned int spacePointIndex) const;
+
+    /**
+     *  @brief  Get the key of a hit of a spacepoint
+     *
+     *  @param  spacePointIndex the index of the spacepoint
+     *  @param  hitIndex the index of the hit within the spacepoint
+     */
+    unsigned int GetHitKey(const unsigned int spacePointIndex, const unsigned int hitIndex) const;
+
+private:
+    art::ProductID              m_hitProductId;         ///< The product id of the hit collection to which the hit keys refer
+    std::vector<float>          m_x;                    ///< The x position of each spacepoint
+    std::vector<float>          m_y;                    ///< The y position of each spacepoint
+    std::vector<float>          m_z;                    ///< The z position of each spacepoint
+    std::vector<unsigned int>   m_pfParticleIndices;    ///< The pfparticle index of each spacepoint
+    std::vector<unsigned int>   m_hitOffsets;           ///< The index of the first hit key of each spacepoint, with a final entry for the total
+    std::vector<unsigned int>   m_hitKeys;              ///< The hit keys, contiguous per spacepoint
+};
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline LArCompactSpacePoints::LArCompactSpacePoints() :
+    m_hitOffsets(1, 0)
+{
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline void LArCompactSpacePoints::Reserve(const unsigned int nSpacePoints, const unsigned int nHits)
+{
+    m_x.reserve(nSpacePoints);
+    m_y.reserve(nSpacePoints);
+    m_z.reserve(nSpacePoints);
+    m_pfParticleIndices.reserve(nSpacePoints);
+    m_hitOffsets.reserve(nSpacePoints + 1);
+    m_hitKeys.reserve(nHits);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline void LArCompactSpacePoints::SetHitProductId(const art::ProductID &hitProductId)
+{
+    m_hitProductId = hitProductId;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline void LArCompactSpacePoints::AddSpacePoint(const float x, const float y, const float z, const unsigned int pfParticleIndex,
+    const std::vector<unsigned int> &hitKeys)
+{
+    if (!m_pfParticleIndices.empty() && (pfParticleIndex < m_pfParticleIndices.back()))
+        throw cet::exception("LArPandora") << " LArCompactSpacePoints::AddSpacePoint --- spacepoints must be added in pfparticle order ";
+
+    m_x.push_back(x);
+    m_y.push_back(y);
+    m_z.push_back(z);
+    m_pfParticleIndices.push_back(pfParticleIndex);
+    m_hitKeys.insert(m_hitKeys.end(), hitKeys.begin(), hitKeys.end());
+    m_hitOffsets.push_back(m_hitKeys.size());
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline unsigned int LArCompactSpacePoints::GetNSpacePoints() const
+{
+    return m_x.size();
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline const art::ProductID &LArCompactSpacePoints::GetHitProductId() const
+{
+    return m_hitProductId;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline const std::vector<float> &LArCompactSpacePoints::GetX() const
+{
+    return m_x;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline const std::vector<float> &LArCompactSpacePoints::GetY() const
+{
+    return m_y;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline const std::vector<float> &LArCompactSpacePoints::GetZ() const
+{
+    return m_z;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline const std::vector<unsigned int> &LArCompactSpacePoints::GetPFParticleIndices() const
+{
+    return m_pfParticleIndices;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline void LArCompactSpacePoints::GetPFParticleSpacePoints(const unsigned int pfParticleIndex, unsigned int &firstSpacePoint, unsigned int &endSpacePoint) const
+{
+    const auto range(std::equal_range(m_pfParticleIndices.begin(), m_pfParticleIndices.end(), pfParticleIndex));
+    firstSpacePoint = range.first - m_pfParticleIndices.begin();
+    endSpacePoint = range.second - m_pfParticleIndices.begin();
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline unsigned int LArCompactSpacePoints::GetNHits(const unsigned int spacePointIndex) const
+{
+    return (m_hitOffsets.at(spacePointIndex + 1) - m_hitOffsets.at(spacePointIndex));
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline unsigned int LArCompactSpacePoints::GetHitKey(const unsigned int spacePointIndex, const unsigned int hitIndex) const
+{
+    if (hitIndex >= this->GetNHits(spacePointIndex))
+        throw cet::exception("LArPandora") << " LArCompactSpacePoints::GetHitKey --- hit index " << hitIndex << " out of range ";
+
+    return m_hitKeys[m_hitOffsets[spacePointIndex] + hitIndex];
+}
+
+} // namespace lar_pandora
+
+#endif // #ifndef LAR_COMPACT_SPACE_POINTS_H
@@ -0,0 +1,197 @@
+/**
+ *  @file   larpandora/LArPandoraObjects/LArHitOwnership.h
+ *
+ *  @brief  Mapping from the hits in a hit collection to the output pfparticles that own them, with their final-state and neutrino ancestry
+ */
+
+#ifndef LAR_HIT_OWNERSHIP_H
+#define LAR_HIT_OWNERSHIP_H 1
+
+#include "canvas/Persistency/Provenance/ProductID.h"
+
+#include "cetlib/exception.h"
+
+#include <limits>
+#include <vector>
+
+namespace lar_pandora
+{
+
+/**
+ *  @brief  LArHitOwnership class
+ *
+ *  The pfparticle indices refer to the pfparticle collection written by the same producer, and the hit keys to a single hit collection.
+ *  Each hit is owned by the pfparticle whose clusters contain it; hits that are not owned by any pfparticle have an invalid index.
+ */
+class LArHitOwnership
+{
+public:
+    // ATTN An enumerator rather than a static data member, so that it can be bound to references without an out-of-class definition
+    enum : unsigned int { InvalidIndex = std::numeric_limits<unsigned int>::max() };   ///< The index of a missing pfparticle
+
+    /**
+     *  @brief  Default constructor
+     */
+    LArHitOwnership();
+
+    /**
+     *  @brief  Set the product id of the hit collection to which the hit keys refer
+     *
+     *  @param  hitProductId the product id of the hit collection
+     */
+    void SetHitProductId(const art::ProductID &hitProductId);
+
+    /**
+     *  @brief  Set the final-state and neutrino ancestors of each pfparticle
+     *
+     *  @param  finalStateIndices the index of the final-state ancestor of each pfparticle
+     *  @param  neutrinoIndices the index of the neutrino ancestor of each pfparticle (invalid if none)
+     */
+    void SetPFParticleAncestry(const std::vector<unsigned int> &finalStateIndices, const std::vector<unsigned int> &neutrinoIndices);
+
+    /**
+     *  @brief  Set the pfparticle that owns a hit
+     *
+     *  @param  hitKey the key of the hit
+     *  @param  pfParticleIndex the index of the owning pfparticle
+     */
+    void SetPFParticleIndex(const unsigned int hitKey, const unsigned int pfParticleIndex);
+
+    /**
+     *  @brief  Get the product id of the hit collection to which the hit keys refer
+     */
+    const art::ProductID &GetHitProductId() const;
+
+    /**
+     *  @brief  Get the number of pfparticles
+     */
+    unsigned int GetNPFParticles() const;
+
+    /**
+     *  @brief  Whether a hit is owned by a pfparticle
+     *
+     *  @param  hitKey the key of the hit
+     */
+    bool HasPFParticle(const unsigned int hitKey) const;
+
+    /**
+     *  @brief  Get the index of the pfparticle that owns a hit (invalid if none)
+     *
+     *  @param  hitKey the key of the hit
+     */
+    unsigned int GetPFParticleIndex(const unsigned int hitKey) const;
+
+    /**
+     *  @brief  Get the index of the final-state ancestor of the pfparticle that owns a hit (invalid if none)
+     *
+     *  @param  hitKey the key of the hit
+     */
+    unsigned int GetFinalStatePFParticleIndex(const unsigned int hitKey) const;
+
+    /**
+     *  @brief  Get the index of the neutrino ancestor of the pfparticle that owns a hit (invalid if none)
+     *
+     *  @param  hitKey the key of the hit
+     */
+    unsigned int GetNeutrinoPFParticleIndex(const unsigned int hitKey) const;
+
+    /**
+     *  @brief  Get the index of the owning pfparticle of every hit, by hit key (hits beyond the end are not owned)
+     */
+    const std::vector<unsigned int> &GetPFParticleIndices() const;
+
+private:
+    art::ProductID              m_hitProductId;         ///< The product id of the hit collection to which the hit keys refer
+    std::vector<unsigned int>   m_pfParticleIndices;    ///< The index of the owning pfparticle of each hit, by hit key
+    std::vector<unsigned int>   m_finalStateIndices;    ///< The index of the final-state ancestor of each pfparticle
+    std::vector<unsigned int>   m_neutrinoIndices;      ///< The index of the neutrino ancestor of each pfparticle
+};
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline LArHitOwnership::LArHitOwnership()
+{
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline void LArHitOwnership::SetHitProductId(const art::ProductID &hitProductId)
+{
+    m_hitProductId = hitProductId;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline void LArHitOwnership::SetPFParticleAncestry(const std::vector<unsigned int> &finalStateIndices, const std::vector<unsigned int> &neutrinoIndices)
+{
+    if (finalStateIndices.size() != neutrinoIndices.size())
+        throw cet::exception("LArPandora") << " LArHitOwnership::SetPFParticleAncestry --- inconsistent numbers of pfparticles provided ";
+
+    m_finalStateIndices = finalStateIndices;
+    m_neutrinoIndices = neutrinoIndices;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline void LArHitOwnership::SetPFParticleIndex(const unsigned int hitKey, const unsigned int pfParticleIndex)
+{
+    if (hitKey >= m_pfParticleIndices.size())
+        m_pfParticleIndices.resize(hitKey + 1, InvalidIndex);
+
+    m_pfParticleIndices[hitKey] = pfParticleIndex;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline const art::ProductID &LArHitOwnership::GetHitProductId() const
+{
+    return m_hitProductId;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline unsigned int LArHitOwnership::GetNPFParticles() const
+{
+    return m_finalStateIndices.size();
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline bool LArHitOwnership::HasPFParticle(const unsigned int hitKey) const
+{
+    return (InvalidIndex != this->GetPFParticleIndex(hitKey));
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline unsigned int LArHitOwnership::GetPFParticleIndex(const unsigned int hitKey) const
+{
+    return ((hitKey < m_pfParticleIndices.size()) ? m_pfParticleIndices[hitKey] : InvalidIndex);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline unsigned int LArHitOwnership::GetFinalStatePFParticleIndex(const unsigned int hitKey) const
+{
+    const unsigned int pfParticleIndex(this->GetPFParticleIndex(hitKey));
+    return ((InvalidIndex != pfParticleIndex) ? m_finalStateIndices.at(pfParticleIndex) : InvalidIndex);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline unsigned int LArHitOwnership::GetNeutrinoPFParticleIndex(const unsigned int hitKey) const
+{
+    const unsigned int pfParticleIndex(this->GetPFParticleIndex(hitKey));
+    return ((InvalidIndex != pfParticleIndex) ? m_neutrinoIndices.at(pfParticleIndex) : InvalidIndex);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline const std::vector<unsigned int> &LArHitOwnership::GetPFParticleIndices() const
+{
+    return m_pfParticleIndices;
+}
+
+} // namespace lar_pandora
+
+#endif // #ifndef LAR_HIT_OWNERSHIP_H
@@ -0,0 +1,222 @@
+/**
+ *  @file   larpandora/LArPandoraObjects/LArPFParticleSummary.h
+ *
+ *  @brief  Precomputed summary of the position of a pfparticle in the pfparticle hierarchy, with its hit and spacepoint counts
+ */
+
+#ifndef LAR_PF_PARTICLE_SUMMARY_H
+#define LAR_PF_PARTICLE_SUMMARY_H 1
+
+#include "canvas/Persistency/Provenance/ProductID.h"
+
+#include <limits>
+#include <vector>
+
+namespace lar_pandora
+{
+
+/**
+ *  @brief  LArPFParticleSummary class
+ *
+ *  The summaries are written in the same order as the pfparticle collection written by the same producer, and the indices refer to that
+ *  collection, whose product id each summary records. The hierarchy conventions are those of the LArPandoraHelper navigation functions.
+ */
+class LArPFParticleSummary
+{
+public:
+    // ATTN An enumerator, as for LArHitOwnership::InvalidIndex
+    enum : unsigned int { InvalidIndex = std::numeric_limits<unsigned int>::max() };   ///< The index of a missing pfparticle
+
+    /**
+     *  @brief  Default constructor
+     */
+    LArPFParticleSummary();
+
+    /**
+     *  @brief  Constructor
+     *
+     *  @param  pfParticleProductId the product id of the pfparticle collection
+     *  @param  parentIndex the index of the parent pfparticle (invalid if primary)
+     *  @param  rootIndex the index of the top-level (primary) ancestor
+     *  @param  finalStateIndex the index of the final-state ancestor
+     *  @param  generation the generation in the hierarchy (first generation if primary)
+     *  @param  neutrinoPdgCode the pdg code of the parent neutrino (zero if none)
+     *  @param  nHitsU the number of hits in the U view
+     *  @param  nHitsV the number of hits in the V view
+     *  @param  nHitsW the number of hits in the W view
+     *  @param  nSpacePoints the number of spacepoints (3D hits)
+     */
+    LArPFParticleSummary(const art::ProductID &pfParticleProductId, const unsigned int parentIndex, const unsigned int rootIndex, const unsigned int finalStateIndex, const int generation,
+        const int neutrinoPdgCode, const unsigned int nHitsU, const unsigned int nHitsV, const unsigned int nHitsW, const unsigned int nSpacePoints);
+
+    /**
+     *  @brief  Get the product id of the pfparticle collection to which the indices refer
+     */
+    const art::ProductID &GetPFParticleProductId() const;
+
+    /**
+     *  @brief  Get the index of the parent pfparticle (invalid if primary)
+     */
+    unsigned int GetParentIndex() const;
+
+    /**
+     *  @brief  Get the index of the top-level (primary) ancestor
+     */
+    unsigned int GetRootIndex() const;
+
+    /**
+     *  @brief  Get the index of the final-state ancestor
+     */
+    unsigned int GetFinalStateIndex() const;
+
+    /**
+     *  @brief  Get the generation in the hierarchy (first generation if primary)
+     */
+    int GetGeneration() const;
+
+    /**
+     *  @brief  Get the pdg code of the parent neutrino (zero if none)
+     */
+    int GetNeutrinoPdgCode() const;
+
+    /**
+     *  @brief  Get the number of hits in the U view
+     */
+    unsigned int GetNHitsU() const;
+
+    /**
+     *  @brief  Get the number of hits in the V view
+     */
+    unsigned int GetNHitsV() const;
+
+    /**
+     *  @brief  Get the number of hits in the W view
+     */
+    unsigned int GetNHitsW() const;
+
+    /**
+     *  @brief  Get the number of spacepoints (3D hits)
+     */
+    unsigned int GetNSpacePoints() const;
+
+private:
+    art::ProductID  m_pfParticleProductId;  ///< The product id of the pfparticle collection to which the indices refer
+    unsigned int    m_parentIndex;          ///< The index of the parent pfparticle (invalid if primary)
+    unsigned int    m_rootIndex;            ///< The index of the top-level (primary) ancestor
+    unsigned int    m_finalStateIndex;      ///< The index of the final-state ancestor
+    int             m_generation;           ///< The generation in the hierarchy (first generation if primary)
+    int             m_neutrinoPdgCode;      ///< The pdg code of the parent neutrino (zero if none)
+    unsigned int    m_nHitsU;               ///< The number of hits in the U view
+    unsigned int    m_nHitsV;               ///< The number of hits in the V view
+    unsigned int    m_nHitsW;               ///< The number of hits in the W view
+    unsigned int    m_nSpacePoints;         ///< The number of spacepoints (3D hits)
+};
+
+typedef std::vector<LArPFParticleSummary> LArPFParticleSummaryVector;
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline LArPFParticleSummary::LArPFParticleSummary() :
+    m_parentIndex(InvalidIndex),
+    m_rootIndex(InvalidIndex),
+    m_finalStateIndex(InvalidIndex),
+    m_generation(0),
+    m_neutrinoPdgCode(0),
+    m_nHitsU(0),
+    m_nHitsV(0),
+    m_nHitsW(0),
+    m_nSpacePoints(0)
+{
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline LArPFParticleSummary::LArPFParticleSummary(const art::ProductID &pfParticleProductId, const unsigned int parentIndex,
+        const unsigned int rootIndex, const unsigned int finalStateIndex, const int generation, const int neutrinoPdgCode, const unsigned int nHitsU,
+        const unsigned int nHitsV, const unsigned int nHitsW, const unsigned int nSpacePoints) :
+    m_pfParticleProductId(pfParticleProductId),
+    m_parentIndex(parentIndex),
+    m_rootIndex(rootIndex),
+    m_finalStateIndex(finalStateIndex),
+    m_generation(generation),
+    m_neutrinoPdgCode(neutrinoPdgCode),
+    m_nHitsU(nHitsU),
+    m_nHitsV(nHitsV),
+    m_nHitsW(nHitsW),
+    m_nSpacePoints(nSpacePoints)
+{
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline const art::ProductID &LArPFParticleSummary::GetPFParticleProductId() const
+{
+    return m_pfParticleProductId;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline unsigned int LArPFParticleSummary::GetParentIndex() const
+{
+    return m_parentIndex;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline unsigned int LArPFParticleSummary::GetRootIndex() const
+{
+    return m_rootIndex;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline unsigned int LArPFParticleSummary::GetFinalStateIndex() const
+{
+    return m_finalStateIndex;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline int LArPFParticleSummary::GetGeneration() const
+{
+    return m_generation;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline int LArPFParticleSummary::GetNeutrinoPdgCode() const
+{
+    return m_neutrinoPdgCode;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline unsigned int LArPFParticleSummary::GetNHitsU() const
+{
+    return m_nHitsU;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline unsigned int LArPFParticleSummary::GetNHitsV() const
+{
+    return m_nHitsV;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline unsigned int LArPFParticleSummary::GetNHitsW() const
+{
+    return m_nHitsW;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline unsigned int LArPFParticleSummary::GetNSpacePoints() const
+{
+    return m_nSpacePoints;
+}
+
+} // namespace lar_pandora
+
+#endif // #ifndef LAR_PF_PARTICLE_SUMMARY_H
@@ -0,0 +1,115 @@
+/**
+ *  @file   larpandora/LArPandoraObjects/LArRejectedHits.h
+ *
+ *  @brief  The hits in a hit collection that were rejected by the lar pandora hit filter, and so never passed to pandora
+ */
+
+#ifndef LAR_REJECTED_HITS_H
+#define LAR_REJECTED_HITS_H 1
+
+#include "canvas/Persistency/Provenance/ProductID.h"
+
+#include "cetlib/exception.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace lar_pandora
+{
+
+/**
+ *  @brief  LArRejectedHits class
+ *
+ *  The hit keys refer to a single hit collection, and are held in increasing order.
+ */
+class LArRejectedHits
+{
+public:
+    /**
+     *  @brief  Default constructor
+     */
+    LArRejectedHits();
+
+    /**
+     *  @brief  Set the product id of the hit collection to which the hit keys refer
+     *
+     *  @param  hitProductId the product id of the hit collection
+     */
+    void SetHitProductId(const art::ProductID &hitProductId);
+
+    /**
+     *  @brief  Add a rejected hit
+     *
+     *  @param  hitKey the key of the hit, which must be larger than that of any hit already added
+     */
+    void AddHit(const unsigned int hitKey);
+
+    /**
+     *  @brief  Get the product id of the hit collection to which the hit keys refer
+     */
+    const art::ProductID &GetHitProductId() const;
+
+    /**
+     *  @brief  Whether a hit was rejected
+     *
+     *  @param  hitKey the key of the hit
+     */
+    bool IsRejected(const unsigned int hitKey) const;
+
+    /**
+     *  @brief  Get the keys of the rejected hits, in increasing order
+     */
+    const std::vector<unsigned int> &GetHitKeys() const;
+
+private:
+    art::ProductID              m_hitProductId;         ///< The product id of the hit collection to which the hit keys refer
+    std::vector<unsigned int>   m_hitKeys;              ///< The keys of the rejected hits, in increasing order
+};
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline LArRejectedHits::LArRejectedHits()
+{
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline void LArRejectedHits::SetHitProductId(const art::ProductID &hitProductId)
+{
+    m_hitProductId = hitProductId;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline void LArRejectedHits::AddHit(const unsigned int hitKey)
+{
+    if (!m_hitKeys.empty() && (hitKey <= m_hitKeys.back()))
+        throw cet::exception("LArPandora") << " LArRejectedHits::AddHit --- hit keys must be added in increasing order (key " << hitKey << ") ";
+
+    m_hitKeys.push_back(hitKey);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline const art::ProductID &LArRejectedHits::GetHitProductId() const
+{
+    return m_hitProductId;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline bool LArRejectedHits::IsRejected(const unsigned int hitKey) const
+{
+    return std::binary_search(m_hitKeys.begin(), m_hitKeys.end(), hitKey);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline const std::vector<unsigned int> &LArRejectedHits::GetHitKeys() const
+{
+    return m_hitKeys;
+}
+
+} // namespace lar_pandora
+
+#endif // #ifndef LAR_REJECTED_HITS_H
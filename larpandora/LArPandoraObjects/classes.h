@@ -0,0 +1,12 @@
+/**
+ *  @file   larpandora/LArPandoraObjects/classes.h
+ *
+ *  @brief  Dictionary headers for the lar pandora data products
+ */
+
+#include "canvas/Persistency/Common/Wrapper.h"
+
+#include "larpandora/LArPandoraObjects/LArCompactSpacePoints.h"
+#include "larpandora/LArPandoraObjects/LArHitOwnership.h"
+#include "larpandora/LArPandoraObjects/LArPFParticleSummary.h"
+#include "larpandora/LArPandoraObjects/LArRejectedHits.h"